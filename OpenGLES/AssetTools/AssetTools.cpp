@@ -0,0 +1,39 @@
+// AssetTools.cpp : Entry point of the offline asset conversion tools.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include "AssetTools.h"
+
+namespace {
+	struct Tool {
+		const char* name;
+		int (*run)(int argc, char** argv);
+		const char* usage;
+	};
+
+	const Tool TOOLS[] = {
+		{ "ktx", runKtxEncoder, "ktx " TEXTURE_OPTIONS_USAGE " input.bmp output.ktx" },
+		{ "pack", runPackBuilder, "pack " TEXTURE_OPTIONS_USAGE " output.pak inputs..." },
+	};
+	const int TOOL_COUNT = sizeof(TOOLS) / sizeof(TOOLS[0]);
+
+	void printUsage() {
+		printf("usage: AssetTools <command> [arguments]\n");
+		for (int i = 0; i < TOOL_COUNT; i++)
+			printf("  %s\n", TOOLS[i].usage);
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		printUsage();
+		return 1;
+	}
+	for (int i = 0; i < TOOL_COUNT; i++) {
+		if (strcmp(argv[1], TOOLS[i].name) == 0)
+			return TOOLS[i].run(argc - 2, argv + 2);
+	}
+	printUsage();
+	return 1;
+}
@@ -0,0 +1,46 @@
+#ifndef ASSET_TOOLS_H_INCLUDED
+#define ASSET_TOOLS_H_INCLUDED
+
+#include "imageloader.h"
+#include "ktx.h"
+#include "mipmap.h"
+#include "pixelformat.h"
+
+/* Offline asset conversion tools.  Every tool is a command of AssetTools.exe
+ * and gets the arguments that follow its name.  Returns the exit code.
+ */
+
+//ktx [texture options] input.bmp output.ktx
+int runKtxEncoder(int argc, char** argv);
+
+//pack [texture options] output.pak inputs...
+int runPackBuilder(int argc, char** argv);
+
+//How a BMP is turned into a GPU-ready texture
+struct TextureOptions {
+	TextureOptions();
+
+	bool compress;		//ETC1, otherwise uncompressed in format
+	PixelFormat format;
+	bool dither;		//For the 16-bit formats
+	bool mips;
+	MipFilter filter;
+	bool srgb;			//Filter mips in linear light
+	int threads;
+	const char* unknownFormat;	//A -format value that isn't a format, or NULL
+};
+
+//Usage text of the options parseTextureOption understands
+#define TEXTURE_OPTIONS_USAGE "[-threads N] [-format rgb888|rgb565|rgba4444|rgba5551 [-nodither]] [-mips [-kaiser] [-srgb]]"
+
+//Consumes argv[*i] (and its value) if it is a texture option.  An unknown
+//-format name is kept in unknownFormat for the caller to report.
+bool parseTextureOption(int argc, char** argv, int* i, TextureOptions* options);
+
+//"etc1" or the name given to -format
+const char* textureFormatName(const TextureOptions& options);
+
+//Encodes the image and, with mips set, its mip chain
+KTXTexture* buildTexture(const Image* image, const TextureOptions& options);
+
+#endif
@@ -0,0 +1,78 @@
+// KtxEncoder.cpp : Converts the 24-bit BMPs loadBMP reads into KTX files.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include "AssetTools.h"
+
+using namespace std;
+
+int runKtxEncoder(int argc, char** argv) {
+	TextureOptions options;
+	const char* input = NULL;
+	const char* output = NULL;
+	for (int i = 0; i < argc; i++) {
+		if (parseTextureOption(argc, argv, &i, &options))
+			continue;
+		else if (!input)
+			input = argv[i];
+		else if (!output)
+			output = argv[i];
+	}
+	if (options.unknownFormat)
+		printf("Unknown format %s\n", options.unknownFormat);
+	if (!input || !output || options.unknownFormat) {
+		printf("usage: AssetTools ktx " TEXTURE_OPTIONS_USAGE " input.bmp output.ktx\n");
+		return 1;
+	}
+
+	//loadBMP asserts on a missing file
+	Image* image = ifstream(input, ifstream::binary).is_open() ? loadBMP(input) : NULL;
+	if (!image) {
+		printf("Could not read %s\n", input);
+		return 1;
+	}
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	KTXTexture* texture = buildTexture(image, options);
+	double encodeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	if (!writeKTX(output, *texture)) {
+		printf("Could not write %s\n", output);
+		delete texture;
+		delete image;
+		return 1;
+	}
+
+	/* What the texture costs on the GPU.  Drivers keep GL_RGB/GL_UNSIGNED_BYTE
+	 * textures as 32-bit RGBX, so that is the uncompressed baseline; ETC1 is
+	 * sampled straight from its 4 bits per texel, which is also the memory
+	 * traffic of every texture cache miss.
+	 */
+	double texels = (double)image->width * image->height;
+	double rgbBytes = texels * 3;
+	double rgbxBytes = texels * 4;
+	double textureBytes = (double)texture->totalBytes();
+	if (!options.compress && options.format == PIXEL_RGB888)
+		textureBytes = textureBytes * 4 / 3;	//Stored as RGB, padded on the GPU
+	if (options.mips) {
+		//A full chain adds a third to every format
+		rgbBytes = rgbBytes * 4 / 3;
+		rgbxBytes = rgbxBytes * 4 / 3;
+	}
+	printf("%s: %dx%d %s, %d levels, encoded in %.1f ms\n", output, image->width, image->height,
+		textureFormatName(options), (int)texture->levels.size(), encodeMs);
+	printf("  RGB8 source      %10.0f bytes  24.0 bits/texel\n", rgbBytes);
+	printf("  RGBX8 on GPU     %10.0f bytes  32.0 bits/texel\n", rgbxBytes);
+	printf("  %-16s %10.0f bytes  %4.1f bits/texel\n", textureFormatName(options),
+		textureBytes, textureBytes * 8 / texels);
+	printf("  memory saved     %.1f%% (%.1fx smaller than RGBX8)\n",
+		100.0 * (1.0 - textureBytes / rgbxBytes), rgbxBytes / textureBytes);
+	printf("  sampling traffic %.1fx less per texel fetched from memory\n", rgbxBytes / textureBytes);
+
+	delete texture;
+	delete image;
+	return 0;
+}
@@ -0,0 +1,209 @@
+// PackBuilder.cpp : Bundles converted textures, shaders and other files into
+// one pack file that AssetPack maps at runtime.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "AssetTools.h"
+#include "assetpack.h"
+
+using namespace std;
+
+namespace {
+	struct PendingAsset {
+		string name;
+		unsigned long long hash;
+		PackAssetType type;
+		vector<char> data;
+	};
+
+	bool byHash(const PendingAsset& a, const PendingAsset& b) {
+		return a.hash < b.hash;
+	}
+
+	bool readFile(const char* path, vector<char>& data) {
+		ifstream input(path, ifstream::binary);
+		if (input.fail())
+			return false;
+		input.seekg(0, ios_base::end);
+		data.resize((size_t)input.tellg());
+		input.seekg(0, ios_base::beg);
+		if (!data.empty())
+			input.read(&data[0], data.size());
+		return !input.fail();
+	}
+
+	//loadBMP asserts on a missing file, so look before calling it
+	bool fileExists(const char* path) {
+		ifstream input(path, ifstream::binary);
+		return input.is_open();
+	}
+
+	//Lowercased extension including the dot, or ""
+	string extension(const string& path) {
+		size_t dot = path.find_last_of('.');
+		if (dot == string::npos || path.find_first_of("/\\", dot) != string::npos)
+			return "";
+		string ext = path.substr(dot);
+		for (size_t i = 0; i < ext.size(); i++)
+			ext[i] = (char)tolower((unsigned char)ext[i]);
+		return ext;
+	}
+
+	string baseName(const string& path) {
+		size_t slash = path.find_last_of("/\\");
+		return slash == string::npos ? path : path.substr(slash + 1);
+	}
+
+	bool isShaderSource(const string& ext) {
+		return ext == ".vert" || ext == ".frag" || ext == ".vsh" || ext == ".fsh" || ext == ".glsl";
+	}
+
+	bool convert(const char* path, const TextureOptions& options, PendingAsset& asset) {
+		string ext = extension(path);
+		asset.name = baseName(path);
+		asset.hash = packHash(asset.name.c_str());
+
+		if (ext == ".bmp") {
+			if (!fileExists(path))
+				return false;
+			Image* image = loadBMP(path);
+			KTXTexture* texture = buildTexture(image, options);
+			ostringstream output(ios_base::out | ios_base::binary);
+			bool ok = writeKTX(output, *texture);
+			string bytes = output.str();
+			asset.type = PACK_TEXTURE_KTX;
+			asset.data.assign(bytes.begin(), bytes.end());
+			delete texture;
+			delete image;
+			return ok;
+		}
+
+		if (!readFile(path, asset.data))
+			return false;
+		if (ext == ".ktx") {
+			KTXTexture* texture = asset.data.empty() ? NULL : loadKTX(&asset.data[0], asset.data.size());
+			delete texture;
+			asset.type = PACK_TEXTURE_KTX;
+			return texture != NULL;
+		}
+		if (isShaderSource(ext)) {
+			asset.type = PACK_SHADER_SOURCE;
+			asset.data.push_back('\0');
+		}
+		else if (ext == ".bin") {
+			//Written by a program binary dump: the GLenum format, then the binary
+			asset.type = PACK_SHADER_BINARY;
+		}
+		else {
+			asset.type = PACK_RAW;
+		}
+		return true;
+	}
+
+	unsigned int align(unsigned int offset) {
+		return (offset + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+	}
+
+	void writeUint(ofstream& output, unsigned int value) {
+		output.write((const char*)&value, 4);
+	}
+}
+
+int runPackBuilder(int argc, char** argv) {
+	TextureOptions options;
+	const char* output = NULL;
+	vector<const char*> inputs;
+	for (int i = 0; i < argc; i++) {
+		if (parseTextureOption(argc, argv, &i, &options))
+			continue;
+		else if (!output)
+			output = argv[i];
+		else
+			inputs.push_back(argv[i]);
+	}
+	if (options.unknownFormat)
+		printf("Unknown format %s\n", options.unknownFormat);
+	if (!output || inputs.empty() || options.unknownFormat) {
+		printf("usage: AssetTools pack " TEXTURE_OPTIONS_USAGE " output.pak inputs...\n");
+		return 1;
+	}
+
+	vector<PendingAsset> assets(inputs.size());
+	for (size_t i = 0; i < inputs.size(); i++) {
+		if (!convert(inputs[i], options, assets[i])) {
+			printf("Could not read %s\n", inputs[i]);
+			return 1;
+		}
+	}
+	sort(assets.begin(), assets.end(), byHash);
+	for (size_t i = 1; i < assets.size(); i++) {
+		if (assets[i].hash == assets[i - 1].hash) {
+			printf("%s and %s have the same name or hash\n", assets[i - 1].name.c_str(), assets[i].name.c_str());
+			return 1;
+		}
+	}
+
+	//Lay out the index, the names and the aligned payloads
+	unsigned int count = (unsigned int)assets.size();
+	unsigned int namesOffset = sizeof(PackHeader) + (PACK_BUCKETS + 1) * 4 + count * sizeof(PackEntry);
+	vector<PackEntry> entries(count);
+	unsigned int offset = namesOffset;
+	for (unsigned int i = 0; i < count; i++) {
+		entries[i].nameOffset = offset;
+		offset += (unsigned int)assets[i].name.size() + 1;
+	}
+	for (unsigned int i = 0; i < count; i++) {
+		offset = align(offset);
+		entries[i].hashLow = (unsigned int)assets[i].hash;
+		entries[i].hashHigh = (unsigned int)(assets[i].hash >> 32);
+		entries[i].type = assets[i].type;
+		entries[i].offset = offset;
+		entries[i].size = (unsigned int)assets[i].data.size();
+		offset += entries[i].size;
+	}
+
+	unsigned int buckets[PACK_BUCKETS + 1];
+	unsigned int entry = 0;
+	for (int b = 0; b <= PACK_BUCKETS; b++) {
+		while (entry < count && (int)(entries[entry].hashHigh >> 24) < b)
+			entry++;
+		buckets[b] = entry;
+	}
+
+	ofstream file(output, ofstream::binary);
+	if (file.fail()) {
+		printf("Could not write %s\n", output);
+		return 1;
+	}
+	PackHeader header = { PACK_MAGIC, PACK_VERSION, count, offset };
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)buckets, sizeof(buckets));
+	if (count)
+		file.write((const char*)&entries[0], count * sizeof(PackEntry));
+	for (unsigned int i = 0; i < count; i++)
+		file.write(assets[i].name.c_str(), assets[i].name.size() + 1);
+	const char zeros[PACK_ALIGNMENT] = { 0 };
+	for (unsigned int i = 0; i < count; i++) {
+		file.write(zeros, entries[i].offset - (unsigned int)file.tellp());
+		if (!assets[i].data.empty())
+			file.write(&assets[i].data[0], assets[i].data.size());
+	}
+	if (file.fail()) {
+		printf("Could not write %s\n", output);
+		return 1;
+	}
+	file.close();
+
+	printf("%s: %u assets, %u bytes\n", output, count, offset);
+	for (unsigned int i = 0; i < count; i++) {
+		const char* types[] = { "raw", "texture", "shader", "binary" };
+		printf("  %-24s %-8s %10u bytes\n", assets[i].name.c_str(), types[entries[i].type], entries[i].size);
+	}
+	return 0;
+}
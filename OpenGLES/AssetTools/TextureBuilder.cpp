@@ -0,0 +1,128 @@
+// TextureBuilder.cpp : Turns decoded BMPs into the KTX textures the tools write.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "AssetTools.h"
+#include "etcencoder.h"
+
+using namespace std;
+
+namespace {
+	struct FormatName {
+		const char* name;
+		PixelFormat format;
+	};
+
+	const FormatName FORMATS[] = {
+		{ "rgb888", PIXEL_RGB888 },
+		{ "rgb565", PIXEL_RGB565 },
+		{ "rgba4444", PIXEL_RGBA4444 },
+		{ "rgba5551", PIXEL_RGBA5551 },
+	};
+	const int FORMAT_COUNT = sizeof(FORMATS) / sizeof(FORMATS[0]);
+
+	//One uncompressed level, rows padded to the 4 bytes KTX requires
+	vector<char> packLevel(const Image* image, const TextureOptions& options) {
+		int texelBytes = pixelFormatSize(options.format);
+		int rowBytes = image->width * texelBytes;
+		int stride = (rowBytes + 3) & ~3;
+		vector<char> level(stride * image->height);
+
+		const char* source = image->pixels;
+		vector<unsigned short> texels;
+		if (options.format != PIXEL_RGB888) {
+			texels.resize(image->width * image->height);
+			convertRGB(image->pixels, image->width, image->height, options.format,
+				options.dither, &texels[0], options.threads);
+			source = (const char*)&texels[0];
+		}
+		for (int y = 0; y < image->height; y++)
+			memcpy(&level[stride * y], source + rowBytes * y, rowBytes);
+		return level;
+	}
+}
+
+TextureOptions::TextureOptions() :
+	compress(true), format(PIXEL_RGB888), dither(true), mips(false),
+	filter(MIP_FILTER_BOX), srgb(false), threads(0), unknownFormat(NULL) {
+}
+
+bool parseTextureOption(int argc, char** argv, int* i, TextureOptions* options) {
+	const char* arg = argv[*i];
+	if (strcmp(arg, "-threads") == 0 && *i + 1 < argc) {
+		options->threads = atoi(argv[++*i]);
+		return true;
+	}
+	if (strcmp(arg, "-format") == 0 && *i + 1 < argc) {
+		const char* name = argv[++*i];
+		int f = 0;
+		while (f < FORMAT_COUNT && strcmp(name, FORMATS[f].name) != 0)
+			f++;
+		if (f < FORMAT_COUNT) {
+			options->compress = false;
+			options->format = FORMATS[f].format;
+		}
+		else {
+			options->unknownFormat = name;
+		}
+		return true;
+	}
+	if (strcmp(arg, "-nodither") == 0)
+		options->dither = false;
+	else if (strcmp(arg, "-mips") == 0)
+		options->mips = true;
+	else if (strcmp(arg, "-kaiser") == 0)
+		options->filter = MIP_FILTER_KAISER;
+	else if (strcmp(arg, "-srgb") == 0)
+		options->srgb = true;
+	else
+		return false;
+	return true;
+}
+
+const char* textureFormatName(const TextureOptions& options) {
+	if (options.compress)
+		return "etc1";
+	for (int f = 0; f < FORMAT_COUNT; f++) {
+		if (FORMATS[f].format == options.format)
+			return FORMATS[f].name;
+	}
+	return "";
+}
+
+KTXTexture* buildTexture(const Image* image, const TextureOptions& options) {
+	//Levels are filtered from the RGB source, not from the encoded level
+	//above, so block artifacts and dither noise don't accumulate down the chain
+	vector<Image*> levels;
+	if (options.mips)
+		levels = generateMipChain(image, options.filter, options.srgb, options.threads);
+
+	KTXTexture* texture;
+	if (options.compress) {
+		texture = compressETC1(image, options.threads);
+		for (size_t i = 0; i < levels.size(); i++) {
+			texture->levels.push_back(vector<char>(etc1ImageSize(levels[i]->width, levels[i]->height)));
+			encodeETC1(levels[i]->pixels, levels[i]->width, levels[i]->height,
+				&texture->levels.back()[0], options.threads);
+		}
+	}
+	else {
+		texture = new KTXTexture();
+		texture->glType = pixelFormatGLType(options.format);
+		texture->glTypeSize = options.format == PIXEL_RGB888 ? 1 : 2;
+		texture->glFormat = pixelFormatGLFormat(options.format);
+		texture->glInternalFormat = texture->glFormat;
+		texture->glBaseInternalFormat = texture->glFormat;
+		texture->width = image->width;
+		texture->height = image->height;
+		texture->levels.push_back(packLevel(image, options));
+		for (size_t i = 0; i < levels.size(); i++)
+			texture->levels.push_back(packLevel(levels[i], options));
+	}
+
+	for (size_t i = 0; i < levels.size(); i++)
+		delete levels[i];
+	return texture;
+}
@@ -0,0 +1,2177 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <windows.h>
+#include <TCHAR.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include "imageloader.h"
+#include "textureloader.h"
+#include "shapes.h"
+#include "shapetables.h"
+#include "atlas.h"
+#include "spritebatch.h"
+#include "etcencoder.h"
+#include "mipmap.h"
+#include "pixelformat.h"
+#include "virtualtexture.h"
+#include "assetpack.h"
+#include "videotexture.h"
+#include "commandlist.h"
+#include "jobsystem.h"
+#include "transform.h"
+#include "framearena.h"
+#include "drawconstants.h"
+#include "renderqueue.h"
+#include "softrasterizer.h"
+#include "vectorpath.h"
+#include "triangulator.h"
+#include "sdffont.h"
+#include "textbatch.h"
+#include "perfhud.h"
+#include "blur.h"
+#include "texturemanager.h"
+#include "vertexformat.h"
+#include "meshoptimizer.h"
+/******************************************************************************
+Defines
+******************************************************************************/
+// Windows class name to register
+#define	WINDOW_CLASS _T("PVRShellClass")
+
+// Width and height of the window
+#define WINDOW_WIDTH	960
+#define WINDOW_HEIGHT	540
+
+// Index to bind the attributes to vertex shaders
+#define VERTEX_ARRAY	0
+#define TEXCOORD_ARRAY	1
+#define PI 3.14159
+
+// Repetitions of every scenario; warmup runs are timed but not reported in the stats
+#define BENCH_WARMUPS		3
+#define BENCH_REPETITIONS	10
+#define BENCH_OUTPUT		L"benchmark_results.json"
+#define BENCH_IMAGE			"blackbuck.bmp"
+#define BENCH_PACK			"assets.pak"
+
+// Draw-call throughput: small Polygon.cpp fans drawn one call each
+#define POLYGON_SIDES		7
+#define POLYGON_RADIUS		0.05f
+#define POLYGON_DRAWS		2000
+
+// Vertex throughput: Heart.cpp hearts with a much finer arc step
+#define HEART_RADIUS		0.3f
+#define HEART_INC_ANGLE		0.05f
+#define HEART_VERTEX_LIMIT	25000
+#define HEART_DRAWS			50
+
+// Vertex formats: the vertex throughput heart from a buffer, packed into each layout
+#define PACKED_DRAWS		50
+
+// Mesh optimization: a MESH_GRID x MESH_GRID bumpy grid as a shuffled triangle soup, optimized then drawn MESH_DRAWS times
+#define MESH_GRID			96
+#define MESH_DRAWS			20
+
+// Fill rate: fullscreen copies of the SourceCode.cpp textured quad
+#define FILL_LAYERS			20
+
+// Minification: the whole image shrunk onto every cell of a grid
+#define MINIFY_GRID			32
+
+// Virtual texture: a zoomed view panned across the image through a small cache
+#define VT_PAGE_SIZE		128
+#define VT_BUDGET			(2 << 20)
+#define VT_ZOOM				0.25f
+#define VT_FRAMES			60
+
+// Sprites: tiles cut from the BMP, drawn one texture each or through the atlas
+#define SPRITE_GRID			8
+#define SPRITE_COUNT		10000
+#define SPRITE_SIZE			0.04f
+
+// Command lists: a large scene of polygons, each with its own matrix, recorded on worker threads
+#define COMMAND_OBJECTS		20000
+
+// Job system scaling: the same work split over 1, 2, 4... jobs up to the pool size
+#define JOB_HEART_INC_ANGLE	0.01f
+#define JOB_HEART_LIMIT		120000
+#define JOB_TRANSFORMS		200000
+
+// Per-draw constants: one heptagon each, as triangles so the ES 2.0 path can batch them
+#define CONSTANT_OBJECTS	5000
+
+// Render queue: quads mixing two programs and RQ_TEXTURES tiles of the BMP, submitted in scene order
+#define RQ_OBJECTS			4000
+#define RQ_TEXTURES			8
+
+// Transient frame data: polygons of changing side counts, re-tessellated every frame
+#define FRAME_OBJECTS		2000
+#define FRAME_COUNT			10
+
+// Software rasterizer: tile size of the CPU backend rendering the draw_calls, vertices and fill_rate scenes
+#define SOFT_TILE_SIZE		64
+
+// Vector icons: Heart.cpp hearts as Bezier paths, filled with stencil-then-cover
+#define PATH_ICONS			1000
+#define PATH_ICON_RADIUS	0.02f
+
+// Triangulation: instances of TESS_SHAPES distinct stars, triangulated per instance or through the cache
+#define TESS_INSTANCES		2000
+#define TESS_SHAPES			16
+
+// Text: TEXT_GLYPHS SDF glyphs a frame at mixed sizes; BENCH_FONT is optional, the installed face is used without it
+#define TEXT_GLYPHS			10000
+#define BENCH_FONT			"font.ttf"
+#define BENCH_FONT_FACE		"Arial"
+
+// Performance overlay: HUD_FRAMES frames of 60 Hz stats fed to a PerfHud redrawing at 4 Hz, composited over the scene
+#define HUD_FRAMES			600
+
+// Blur: the image stretched to a 1080p target and blurred at BLUR_RADII by each method
+#define BLUR_WIDTH			1920
+#define BLUR_HEIGHT			1080
+#define BLUR_RADII			5
+
+// Texture budget: BUDGET_TEXTURES copies of the image through a TextureManager that fits BUDGET_RESIDENT of them
+#define BUDGET_TEXTURES		8
+#define BUDGET_RESIDENT		3
+#define BUDGET_FRAMES		30
+
+// Shape startup: the Heart.cpp heart built SHAPE_STARTUPS times by each method
+#define SHAPE_STARTUPS		1000
+#define SHAPE_INC_ANGLE		1
+
+// Upload and decode repeat the operation a few times per repetition
+#define UPLOAD_COUNT		10
+#define DECODE_COUNT		10
+
+// Video: frames streamed through a VideoTexture; BENCH_VIDEO is optional raw NV12
+#define VIDEO_FRAMES		30
+#define BENCH_VIDEO			"video.yuv"
+#define BENCH_VIDEO_WIDTH	1920
+#define BENCH_VIDEO_HEIGHT	1080
+/******************************************************************************
+Global variables
+******************************************************************************/
+
+// Variable set in the message handler to finish the demo
+bool	g_bDemoDone = false;
+
+// A named count reported with a scenario, such as state changes per frame
+struct BenchCounter
+{
+	const char*			name;
+	double				value;
+};
+
+// Timing and result of one benchmark scenario
+struct BenchResult
+{
+	const char*			name;
+	const char*			unit;		// unit of one work item, reported per second
+	double				workPerRep;	// work items done by one repetition
+	std::vector<double>	warmupMs;
+	std::vector<double>	samplesMs;
+	std::vector<BenchCounter> counters;
+};
+
+std::vector<BenchResult> g_results;
+
+/*!****************************************************************************
+@Function		WndProc
+@Input			hWnd		Handle to the window
+@Input			message		Specifies the message
+@Input			wParam		Additional message information
+@Input			lParam		Additional message information
+@Return		LRESULT		result code to OS
+@Description	Processes messages for the main window
+******************************************************************************/
+#ifndef NO_GDI
+LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+	switch (message)
+	{
+		// Handles the close message when a user clicks the quit icon of the window
+	case WM_CLOSE:
+		g_bDemoDone = true;
+		PostQuitMessage(0);
+		return 1;
+
+	default:
+		break;
+	}
+
+	// Calls the default window procedure for messages we did not handle
+	return DefWindowProc(hWnd, message, wParam, lParam);
+}
+#endif
+/*!****************************************************************************
+@Function		TestEGLError
+@Return		bool			true if no EGL error was detected
+@Description	Tests for an EGL error and prints it
+******************************************************************************/
+bool TestEGLError()
+{
+	EGLint iErr = eglGetError();
+	if (iErr != EGL_SUCCESS)
+	{
+		return false;
+	}
+	return true;
+}
+
+GLuint LoadShader(char *shaderSrc, GLenum type)
+{
+	GLuint shader;
+	GLint compiled;
+
+	// Create the shader object
+	shader = glCreateShader(type);
+	if (shader == 0)
+		return 0;
+	// Load the shader source
+	glShaderSource(shader, 1, (const char**)&shaderSrc, NULL);
+
+	// Compile the shader
+	glCompileShader(shader);
+	// Check the compile status
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (!compiled)
+	{
+		GLint infoLen = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
+
+		if (infoLen > 1)
+		{
+			char* infoLog = (char*)malloc(sizeof(char) * infoLen);
+			glGetShaderInfoLog(shader, infoLen, NULL, infoLog);
+			printf("Error compiling shader:\n%s\n", infoLog);
+			free(infoLog);
+		}
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+/*!****************************************************************************
+@Function		LoadProgram
+@Input			pszVertShader	Vertex shader source
+@Input			pszFragShader	Fragment shader source
+@Return		GLuint			Linked program, 0 on failure
+@Description	Builds a program with myVertex bound to VERTEX_ARRAY and myUV
+				bound to TEXCOORD_ARRAY
+******************************************************************************/
+GLuint LoadProgram(char* pszVertShader, char* pszFragShader)
+{
+	GLuint vertexShader = LoadShader(pszVertShader, GL_VERTEX_SHADER);
+	GLuint fragmentShader = LoadShader(pszFragShader, GL_FRAGMENT_SHADER);
+
+	GLuint uiProgramObject = glCreateProgram();
+	glAttachShader(uiProgramObject, fragmentShader);
+	glAttachShader(uiProgramObject, vertexShader);
+	glBindAttribLocation(uiProgramObject, VERTEX_ARRAY, "myVertex");
+	glBindAttribLocation(uiProgramObject, TEXCOORD_ARRAY, "myUV");
+	glLinkProgram(uiProgramObject);
+
+	// The program keeps the shaders alive for as long as it needs them
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint bLinked;
+	glGetProgramiv(uiProgramObject, GL_LINK_STATUS, &bLinked);
+	if (!bLinked)
+	{
+		glDeleteProgram(uiProgramObject);
+		return 0;
+	}
+	return uiProgramObject;
+}
+
+/*!****************************************************************************
+@Function		GetTimeMs
+@Return		double			Milliseconds from an arbitrary origin
+@Description	High resolution wall clock used for all measurements
+******************************************************************************/
+double GetTimeMs()
+{
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return (double)now.QuadPart * 1000.0 / (double)frequency.QuadPart;
+}
+
+/*!****************************************************************************
+@Function		CropImage
+@Input			image			Source image
+@Input			x, y			Bottom-left texel of the crop
+@Input			width, height	Size of the crop
+@Return		Image*			New image holding a copy of the texels
+******************************************************************************/
+Image* CropImage(const Image* image, int x, int y, int width, int height)
+{
+	char* pixels = new char[width * height * 3];
+	for (int row = 0; row < height; row++)
+	{
+		memcpy(pixels + row * width * 3,
+			image->pixels + ((y + row) * image->width + x) * 3, width * 3);
+	}
+	return new Image(pixels, width, height);
+}
+
+/*!****************************************************************************
+@Function		BuildHeartPath
+@Output			path			Path to fill with the outline
+@Input			radius			Half the side of the square
+@Description	The heart of tessellateHeart() as a path: the square with a
+				semicircle on its top and right edges, each quarter circle a
+				cubic Bezier.
+******************************************************************************/
+void BuildHeartPath(Path& path, float radius)
+{
+	float r = radius;
+	float k = 0.5523f * radius;
+	path.clear();
+	path.moveTo(-r, r);
+	path.lineTo(-r, -r);
+	path.lineTo(r, -r);
+	path.cubicTo(r + k, -r, 2 * r, -k, 2 * r, 0.0f);
+	path.cubicTo(2 * r, k, r + k, r, r, r);
+	path.cubicTo(r, r + k, k, 2 * r, 0.0f, 2 * r);
+	path.cubicTo(-k, 2 * r, -r, r + k, -r, r);
+	path.close();
+}
+
+/*!****************************************************************************
+@Function		RunScenario
+@Input			name			Scenario name written to the JSON output
+@Input			unit			Name of one unit of work
+@Input			workPerRep		Units of work done by one call of body
+@Input			body			Work to time
+@Description	Times BENCH_WARMUPS + BENCH_REPETITIONS calls of body.  The GL
+				pipeline is drained before and after every call so GPU work is
+				attributed to the repetition that issued it.
+******************************************************************************/
+template<class Body>
+void RunScenario(const char* name, const char* unit, double workPerRep, Body body)
+{
+	BenchResult result;
+	result.name = name;
+	result.unit = unit;
+	result.workPerRep = workPerRep;
+
+	for (int i = 0; i < BENCH_WARMUPS + BENCH_REPETITIONS; i++)
+	{
+		glFinish();
+		double start = GetTimeMs();
+		body();
+		glFinish();
+		double elapsed = GetTimeMs() - start;
+
+		if (i < BENCH_WARMUPS)
+			result.warmupMs.push_back(elapsed);
+		else
+			result.samplesMs.push_back(elapsed);
+	}
+	g_results.push_back(result);
+}
+
+/*!****************************************************************************
+@Function		AddCounter
+@Input			name			Counter name written to the JSON output
+@Input			value			Value of the counter
+@Description	Attaches a counter to the scenario run last
+******************************************************************************/
+void AddCounter(const char* name, double value)
+{
+	BenchCounter counter = { name, value };
+	g_results.back().counters.push_back(counter);
+}
+
+/*!****************************************************************************
+@Function		WriteResults
+@Input			pszPath			File to write
+@Return		bool			true if the file was written
+@Description	Writes g_results as JSON.  Every scenario carries its raw samples
+				together with min/median/mean/max and the median throughput, so
+				two runs can be diffed per field.
+******************************************************************************/
+bool WriteResults(const wchar_t* pszPath)
+{
+	FILE* file = NULL;
+	if (_wfopen_s(&file, pszPath, L"w") != 0 || !file)
+		return false;
+
+	const char* renderer = (const char*)glGetString(GL_RENDERER);
+	const char* version = (const char*)glGetString(GL_VERSION);
+	fprintf(file, "{\n");
+	fprintf(file, "  \"renderer\": \"%s\",\n", renderer ? renderer : "");
+	fprintf(file, "  \"version\": \"%s\",\n", version ? version : "");
+	fprintf(file, "  \"warmups\": %d,\n", BENCH_WARMUPS);
+	fprintf(file, "  \"repetitions\": %d,\n", BENCH_REPETITIONS);
+	fprintf(file, "  \"scenarios\": [\n");
+	for (size_t i = 0; i < g_results.size(); i++)
+	{
+		const BenchResult& result = g_results[i];
+		std::vector<double> sorted = result.samplesMs;
+		std::sort(sorted.begin(), sorted.end());
+
+		double mean = 0.0;
+		for (size_t j = 0; j < sorted.size(); j++)
+			mean += sorted[j];
+		mean /= sorted.size();
+		double median = sorted.size() % 2 ? sorted[sorted.size() / 2] :
+			0.5 * (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]);
+
+		fprintf(file, "    {\n");
+		fprintf(file, "      \"name\": \"%s\",\n", result.name);
+		fprintf(file, "      \"unit\": \"%s\",\n", result.unit);
+		fprintf(file, "      \"work_per_rep\": %.0f,\n", result.workPerRep);
+		fprintf(file, "      \"min_ms\": %.4f,\n", sorted.front());
+		fprintf(file, "      \"median_ms\": %.4f,\n", median);
+		fprintf(file, "      \"mean_ms\": %.4f,\n", mean);
+		fprintf(file, "      \"max_ms\": %.4f,\n", sorted.back());
+		fprintf(file, "      \"%s_per_sec\": %.1f,\n", result.unit,
+			median > 0.0 ? result.workPerRep * 1000.0 / median : 0.0);
+		fprintf(file, "      \"warmup_ms\": [");
+		for (size_t j = 0; j < result.warmupMs.size(); j++)
+			fprintf(file, "%s%.4f", j ? ", " : "", result.warmupMs[j]);
+		fprintf(file, "],\n");
+		fprintf(file, "      \"samples_ms\": [");
+		for (size_t j = 0; j < result.samplesMs.size(); j++)
+			fprintf(file, "%s%.4f", j ? ", " : "", result.samplesMs[j]);
+		fprintf(file, "]");
+		if (!result.counters.empty())
+		{
+			fprintf(file, ",\n      \"counters\": {");
+			for (size_t j = 0; j < result.counters.size(); j++)
+				fprintf(file, "%s\"%s\": %.0f", j ? ", " : "", result.counters[j].name, result.counters[j].value);
+			fprintf(file, "}");
+		}
+		fprintf(file, "\n");
+		fprintf(file, "    }%s\n", i + 1 < g_results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n");
+	fprintf(file, "}\n");
+	fclose(file);
+	return true;
+}
+
+/*!****************************************************************************
+@Function		wWinMain
+@Input			hInstance		Application instance from OS
+@Input			hPrevInstance	Always NULL
+@Input			lpCmdLine		Optional path of the JSON file to write
+@Input			nCmdShow		Specifies how the window is to be shown
+@Return		int				result code to OS
+@Description	Runs every benchmark scenario once and writes the results
+******************************************************************************/
+int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
+	_In_opt_ HINSTANCE hPrevInstance,
+	_In_ LPWSTR    lpCmdLine,
+	_In_ int       nCmdShow)
+{
+	// Windows variables
+	HWND				hWnd = 0;
+	HDC					hDC = 0;
+
+	// EGL variables
+	EGLDisplay			eglDisplay = 0;
+	EGLConfig			eglConfig = 0;
+	EGLSurface			eglSurface = 0;
+	EGLContext			eglContext = 0;
+	EGLNativeWindowType	eglWindow = 0;
+
+	// Flat colour shaders of Heart.cpp and Polygon.cpp
+	char* pszColorFragShader = "\
+		void main (void)\
+		{\
+		    gl_FragColor = vec4(1.0, 0.0, 0.0 ,0.0);\
+		}";
+	char* pszColorVertShader = "\
+		attribute highp vec4	myVertex;\
+		uniform mediump mat4	myPMVMatrix;\
+		void main(void)\
+		{\
+			gl_Position = myPMVMatrix * myVertex ;\
+		}";
+
+	// Textured shaders of SourceCode.cpp
+	char* pszTexFragShader = "\
+		uniform sampler2D sampler2d;\
+		varying mediump vec2	myTexCoord;\
+		void main (void)\
+		{\
+		    gl_FragColor = texture2D(sampler2d,myTexCoord);\
+		}";
+	char* pszTexVertShader = "\
+		attribute highp vec4	myVertex;\
+		attribute mediump vec4	myUV;\
+		uniform mediump mat4	myPMVMatrix;\
+		varying mediump vec2	myTexCoord;\
+		void main(void)\
+		{\
+			gl_Position = myPMVMatrix * myVertex;\
+			myTexCoord = myUV.st;\
+		}";
+
+	const wchar_t* pszOutput = (lpCmdLine && lpCmdLine[0]) ? lpCmdLine : BENCH_OUTPUT;
+
+#ifndef NO_GDI
+	// Register the windows class
+	WNDCLASS sWC;
+	sWC.style = CS_HREDRAW | CS_VREDRAW;
+	sWC.lpfnWndProc = WndProc;
+	sWC.cbClsExtra = 0;
+	sWC.cbWndExtra = 0;
+	sWC.hInstance = hInstance;
+	sWC.hIcon = 0;
+	sWC.hCursor = 0;
+	sWC.lpszMenuName = 0;
+	sWC.hbrBackground = (HBRUSH)GetStockObject(WHITE_BRUSH);
+	sWC.lpszClassName = WINDOW_CLASS;
+	unsigned int nWidth = WINDOW_WIDTH;
+	unsigned int nHeight = WINDOW_HEIGHT;
+
+	ATOM registerClass = RegisterClass(&sWC);
+	if (!registerClass)
+	{
+		MessageBox(0, _T("Failed to register the window class"), _T("Error"), MB_OK | MB_ICONEXCLAMATION);
+	}
+
+	// Create the eglWindow
+	RECT	sRect;
+	SetRect(&sRect, 0, 0, nWidth, nHeight);
+	AdjustWindowRectEx(&sRect, WS_CAPTION | WS_SYSMENU, false, 0);
+	hWnd = CreateWindow(WINDOW_CLASS, _T("Benchmark"), WS_VISIBLE | WS_SYSMENU,
+		0, 0, nWidth, nHeight, NULL, NULL, hInstance, NULL);
+	eglWindow = hWnd;
+
+	// Get the associated device context
+	hDC = GetDC(hWnd);
+	if (!hDC)
+	{
+		MessageBox(0, _T("Failed to create the device context"), _T("Error"), MB_OK | MB_ICONEXCLAMATION);
+		goto cleanup;
+	}
+#endif
+
+	eglDisplay = eglGetDisplay(hDC);
+
+	if (eglDisplay == EGL_NO_DISPLAY)
+		eglDisplay = eglGetDisplay((EGLNativeDisplayType)EGL_DEFAULT_DISPLAY);
+
+	EGLint iMajorVersion, iMinorVersion;
+	if (!eglInitialize(eglDisplay, &iMajorVersion, &iMinorVersion))
+	{
+#ifndef NO_GDI
+		MessageBox(0, _T("eglInitialize() failed."), _T("Error"), MB_OK | MB_ICONEXCLAMATION);
+#endif
+		goto cleanup;
+	}
+
+	eglBindAPI(EGL_OPENGL_ES_API);
+	if (!TestEGLError())
+	{
+		goto cleanup;
+	}
+
+	const EGLint pi32ConfigAttribs[] =
+	{
+		EGL_LEVEL,				0,
+		EGL_SURFACE_TYPE,		EGL_WINDOW_BIT,
+		EGL_RENDERABLE_TYPE,	EGL_OPENGL_ES2_BIT,
+		EGL_NATIVE_RENDERABLE,	EGL_FALSE,
+		EGL_DEPTH_SIZE,			EGL_DONT_CARE,
+		EGL_STENCIL_SIZE,		8,
+		EGL_NONE
+	};
+
+	int iConfigs;
+	if (!eglChooseConfig(eglDisplay, pi32ConfigAttribs, &eglConfig, 1, &iConfigs) || (iConfigs != 1))
+	{
+#ifndef NO_GDI
+		MessageBox(0, _T("eglChooseConfig() failed."), _T("Error"), MB_OK | MB_ICONEXCLAMATION);
+#endif
+		goto cleanup;
+	}
+
+	eglSurface = eglCreateWindowSurface(eglDisplay, eglConfig, eglWindow, NULL);
+
+	if (eglSurface == EGL_NO_SURFACE)
+	{
+		eglGetError();
+		eglSurface = eglCreateWindowSurface(eglDisplay, eglConfig, NULL, NULL);
+	}
+
+	if (!TestEGLError())
+	{
+		goto cleanup;
+	}
+
+	// ES 3.0 where available, for the uniform buffer scenarios; everything else runs on either
+	EGLint ai32ContextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+	eglContext = eglCreateContext(eglDisplay, eglConfig, NULL, ai32ContextAttribs);
+	if (eglContext == EGL_NO_CONTEXT)
+	{
+		eglGetError();
+		ai32ContextAttribs[1] = 2;
+		eglContext = eglCreateContext(eglDisplay, eglConfig, NULL, ai32ContextAttribs);
+	}
+	if (!TestEGLError())
+	{
+		goto cleanup;
+	}
+
+	eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext);
+	if (!TestEGLError())
+	{
+		goto cleanup;
+	}
+
+	// Benchmarks must not be throttled by the display refresh
+	eglSwapInterval(eglDisplay, 0);
+
+	GLuint colorProgram = LoadProgram(pszColorVertShader, pszColorFragShader);
+	GLuint texProgram = LoadProgram(pszTexVertShader, pszTexFragShader);
+	if (!colorProgram || !texProgram)
+	{
+		goto cleanup;
+	}
+	GLint colorMatrix = glGetUniformLocation(colorProgram, "myPMVMatrix");
+	GLint texMatrix = glGetUniformLocation(texProgram, "myPMVMatrix");
+
+	EGLint surfaceWidth, surfaceHeight;
+	eglQuerySurface(eglDisplay, eglSurface, EGL_WIDTH, &surfaceWidth);
+	eglQuerySurface(eglDisplay, eglSurface, EGL_HEIGHT, &surfaceHeight);
+	glViewport(0, 0, surfaceWidth, surfaceHeight);
+	glClearColor(0.6f, 0.8f, 1.0f, 1.0f);
+	glEnableVertexAttribArray(VERTEX_ARRAY);
+
+	/*
+		Draw-call throughput.
+		Every draw is one Polygon.cpp fan at its own position, so each call
+		carries a matrix upload as the demos do.
+	*/
+	{
+		GLfloat afPolygon[2 * POLYGON_SIDES];
+		tessellatePolygon(afPolygon, 2 * POLYGON_SIDES, POLYGON_SIDES, POLYGON_RADIUS);
+
+		RunScenario("draw_calls", "draws", POLYGON_DRAWS, [&]()
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			glUseProgram(colorProgram);
+			glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 0, afPolygon);
+			for (int i = 0; i < POLYGON_DRAWS; i++)
+			{
+				float matrix[] =
+				{
+					1.0f,0.0f,0.0f,0.0f,
+					0.0f,1.0f,0.0f,0.0f,
+					0.0f,0.0f,1.0f,0.0f,
+					(i % 40) * 0.05f - 0.975f, (i / 40 % 40) * 0.05f - 0.975f,0.0f,1.0f
+				};
+				glUniformMatrix4fv(colorMatrix, 1, GL_FALSE, matrix);
+				glDrawArrays(GL_TRIANGLE_FAN, 0, POLYGON_SIDES);
+			}
+		});
+	}
+
+	/*
+		Vertex throughput.
+		One heart tessellated at HEART_INC_ANGLE instead of 1 degree, drawn
+		HEART_DRAWS times from client memory like Heart.cpp.
+	*/
+	{
+		std::vector<GLfloat> afHeart(HEART_VERTEX_LIMIT * 3);
+		GLint countVert = tessellateHeart(&afHeart[0], (int)afHeart.size(), HEART_RADIUS, HEART_INC_ANGLE);
+
+		float scale = 1.0f;
+		float angle = -45.0f;
+		float matrix[] =
+		{
+			scale * cosf(angle*PI / 180.0f), -scale * sinf(angle*PI / 180.0f),0.0f,0.0f,
+			scale * sinf(angle*PI / 180.0f), scale * cosf(angle*PI / 180.0f),0.0f,0.0f,
+			0.0f,0.0f,scale,0.0f,
+			0.0f,0.0f,0.0f,1.0f
+		};
+
+		RunScenario("vertices", "vertices", (double)HEART_DRAWS * (countVert / 3), [&]()
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			glUseProgram(colorProgram);
+			glUniformMatrix4fv(colorMatrix, 1, GL_FALSE, matrix);
+			glVertexAttribPointer(VERTEX_ARRAY, 3, GL_FLOAT, GL_FALSE, 0, &afHeart[0]);
+			for (int i = 0; i < HEART_DRAWS; i++)
+			{
+				glDrawArrays(GL_TRIANGLE_FAN, 0, countVert / 3);
+			}
+		});
+	}
+
+	/*
+		Vertex formats.
+		The same heart as vertex throughput, drawn PACKED_DRAWS times from a
+		vertex buffer: as uploaded by Heart.cpp (3 floats, 12 bytes a
+		vertex), then packed to 2 normalized shorts fitted to its bounds and
+		to 2 half floats, 4 bytes each.  Fitted positions draw with the
+		decode folded into the matrix.
+	*/
+	{
+		std::vector<GLfloat> afHeart(HEART_VERTEX_LIMIT * 3);
+		int heartVertices = tessellateHeart(&afHeart[0], (int)afHeart.size(), HEART_RADIUS, HEART_INC_ANGLE) / 3;
+
+		float matrix[] =
+		{
+			cosf(-45.0f*PI / 180.0f), -sinf(-45.0f*PI / 180.0f),0.0f,0.0f,
+			sinf(-45.0f*PI / 180.0f), cosf(-45.0f*PI / 180.0f),0.0f,0.0f,
+			0.0f,0.0f,1.0f,0.0f,
+			0.0f,0.0f,0.0f,1.0f
+		};
+
+		VertexLayout floats;
+		floats.add(VERTEX_ARRAY, 3, ATTRIB_FLOAT);
+		VertexLayout layouts[3];
+		layouts[0].add(VERTEX_ARRAY, 3, ATTRIB_FLOAT);
+		layouts[1].add(VERTEX_ARRAY, 2, ATTRIB_SHORT_NORM, true);
+		layouts[2].add(VERTEX_ARRAY, 2, ATTRIB_HALF);
+		const char* names[3] = { "vertex_format_float", "vertex_format_short", "vertex_format_half" };
+
+		GLuint buffer;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		for (int n = 0; n < 3; n++)
+		{
+			if (!attribFormatSupported(layouts[n].attrib(0).format))
+				continue;
+			PackedMesh mesh;
+			packMesh(&afHeart[0], heartVertices, floats, layouts[n], &mesh);
+			glBufferData(GL_ARRAY_BUFFER, mesh.bytes(), &mesh.data[0], GL_STATIC_DRAW);
+			GLfloat decoded[16];
+			mesh.decodeMatrix(0, matrix, decoded);
+
+			RunScenario(names[n], "vertices", (double)PACKED_DRAWS * heartVertices, [&]()
+			{
+				glClear(GL_COLOR_BUFFER_BIT);
+				glUseProgram(colorProgram);
+				glUniformMatrix4fv(colorMatrix, 1, GL_FALSE, decoded);
+				mesh.layout.apply(0);
+				for (int i = 0; i < PACKED_DRAWS; i++)
+				{
+					glDrawArrays(GL_TRIANGLE_FAN, 0, heartVertices);
+				}
+			});
+			AddCounter("bytes_per_vertex", mesh.layout.stride());
+			AddCounter("bytes_saved", (double)mesh.savedBytes());
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+	}
+
+	/*
+		Mesh optimization.
+		A grid of MESH_GRID x MESH_GRID quads with a bumpy z, written as a
+		soup of unshared vertices in shuffled triangle order, the worst case
+		of an exported mesh.  Each pass of meshoptimizer.h is timed on its
+		own from the output of the one before, then the welded soup and the
+		optimized mesh are drawn MESH_DRAWS times from buffers.  The draws
+		report the ACMR and ATVR of their index order for a 16 vertex FIFO.
+	*/
+	{
+		std::vector<GLfloat> soup;
+		std::vector<int> order(2 * MESH_GRID * MESH_GRID);
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = (int)i;
+		unsigned int seed = 1;
+		for (size_t i = order.size() - 1; i > 0; i--)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			std::swap(order[i], order[(seed >> 8) % (i + 1)]);
+		}
+		for (size_t t = 0; t < order.size(); t++)
+		{
+			int quad = order[t] / 2;
+			int corners[2][3][2] = { { { 0, 0 }, { 1, 0 }, { 1, 1 } }, { { 0, 0 }, { 1, 1 }, { 0, 1 } } };
+			for (int j = 0; j < 3; j++)
+			{
+				int x = quad % MESH_GRID + corners[order[t] % 2][j][0];
+				int y = quad / MESH_GRID + corners[order[t] % 2][j][1];
+				soup.push_back(x * 1.8f / MESH_GRID - 0.9f);
+				soup.push_back(y * 1.8f / MESH_GRID - 0.9f);
+				soup.push_back(0.2f * sinf(x * 0.3f) * cosf(y * 0.2f));
+			}
+		}
+		int soupVertices = (int)soup.size() / 3;
+		int indexCount = soupVertices;
+		double triangles = indexCount / 3.0;
+		std::vector<GLushort> soupIndices(indexCount);
+		for (int i = 0; i < indexCount; i++)
+			soupIndices[i] = (GLushort)i;
+
+		//Every pass works on a copy of the previous one's output
+		std::vector<GLfloat> welded, vertices;
+		std::vector<GLushort> weldedIndices, indices;
+		std::vector<int> clusters;
+		int weldedVertices = 0, vertexCount = 0;
+		RunScenario("mesh_deduplicate", "triangles", triangles, [&]()
+		{
+			welded = soup;
+			weldedIndices = soupIndices;
+			weldedVertices = deduplicateVertices(&welded[0], soupVertices, 3 * sizeof(GLfloat),
+				&weldedIndices[0], indexCount);
+		});
+		AddCounter("vertices", weldedVertices);
+		RunScenario("mesh_vertex_cache", "triangles", triangles, [&]()
+		{
+			indices = weldedIndices;
+			optimizeVertexCache(&indices[0], indexCount, weldedVertices, MESH_CACHE_SIZE, &clusters);
+		});
+		AddCounter("clusters", (double)clusters.size() - 1);
+		std::vector<GLushort> cacheIndices = indices;
+		RunScenario("mesh_overdraw", "triangles", triangles, [&]()
+		{
+			indices = cacheIndices;
+			optimizeOverdraw(&indices[0], indexCount, clusters, &welded[0], 3, 3 * sizeof(GLfloat), weldedVertices);
+		});
+		std::vector<GLushort> overdrawIndices = indices;
+		RunScenario("mesh_vertex_fetch", "triangles", triangles, [&]()
+		{
+			vertices = welded;
+			indices = overdrawIndices;
+			vertexCount = optimizeVertexFetch(&vertices[0], weldedVertices, 3 * sizeof(GLfloat), &indices[0], indexCount);
+		});
+
+		float matrix[] =
+		{
+			1.0f,0.0f,0.0f,0.0f,
+			0.0f,1.0f,0.0f,0.0f,
+			0.0f,0.0f,1.0f,0.0f,
+			0.0f,0.0f,0.0f,1.0f
+		};
+		GLuint buffers[2];
+		glGenBuffers(2, buffers);
+		for (int optimized = 0; optimized < 2; optimized++)
+		{
+			const std::vector<GLfloat>& drawnVertices = optimized ? vertices : welded;
+			const std::vector<GLushort>& drawnIndices = optimized ? indices : weldedIndices;
+			int drawnCount = optimized ? vertexCount : weldedVertices;
+			glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+			glBufferData(GL_ARRAY_BUFFER, drawnCount * 3 * sizeof(GLfloat), &drawnVertices[0], GL_STATIC_DRAW);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLushort), &drawnIndices[0], GL_STATIC_DRAW);
+
+			RunScenario(optimized ? "mesh_draw_optimized" : "mesh_draw_welded", "triangles", MESH_DRAWS * triangles, [&]()
+			{
+				glClear(GL_COLOR_BUFFER_BIT);
+				glUseProgram(colorProgram);
+				glUniformMatrix4fv(colorMatrix, 1, GL_FALSE, matrix);
+				glVertexAttribPointer(VERTEX_ARRAY, 3, GL_FLOAT, GL_FALSE, 0, 0);
+				for (int i = 0; i < MESH_DRAWS; i++)
+				{
+					glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, 0);
+				}
+			});
+			float acmr, atvr;
+			analyzeVertexCache(&drawnIndices[0], indexCount, drawnCount, MESH_CACHE_SIZE, &acmr, &atvr);
+			AddCounter("acmr", acmr);
+			AddCounter("atvr", atvr);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		glDeleteBuffers(2, buffers);
+	}
+
+	Image* image = loadBMP(BENCH_IMAGE);
+
+	/*
+		Fill rate.
+		The SourceCode.cpp quad stretched over the whole surface and drawn
+		FILL_LAYERS times with blending off, once from the RGB texture, once
+		converted to dithered RGB565 and once compressed to ETC1, which cut
+		the bytes fetched per texel from 4 (RGBX) to 2 and 0.5.
+	*/
+	{
+		GLfloat afQuad[] = { -1.0f,  1.0f, 0.0f,  // Position 0
+			0.0f,  1.0f,        // TexCoord 0
+			-1.0f, -1.0f, 0.0f,  // Position 1
+			0.0f,  0.0f,        // TexCoord 1
+			1.0f, -1.0f, 0.0f,  // Position 2
+			1.0f,  0.0f,        // TexCoord 2
+			1.0f,  1.0f, 0.0f,  // Position 3
+			1.0f,  1.0f         // TexCoord 3
+		};
+		float identity[] =
+		{
+			1.0f,0.0f,0.0f,0.0f,
+			0.0f,1.0f,0.0f,0.0f,
+			0.0f,0.0f,1.0f,0.0f,
+			0.0f,0.0f,0.0f,1.0f
+		};
+		auto fill = [&](GLuint textureId)
+		{
+			glUseProgram(texProgram);
+			glUniform1i(glGetUniformLocation(texProgram, "sampler2d"), 0);
+			glUniformMatrix4fv(texMatrix, 1, GL_FALSE, identity);
+			glBindTexture(GL_TEXTURE_2D, textureId);
+			glEnableVertexAttribArray(TEXCOORD_ARRAY);
+			glVertexAttribPointer(VERTEX_ARRAY, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), afQuad);
+			glVertexAttribPointer(TEXCOORD_ARRAY, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), &afQuad[3]);
+			for (int i = 0; i < FILL_LAYERS; i++)
+			{
+				glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+			}
+			glDisableVertexAttribArray(TEXCOORD_ARRAY);
+		};
+		double fillPixels = (double)FILL_LAYERS * surfaceWidth * surfaceHeight;
+
+		GLuint textureId = loadTexture(image);
+		RunScenario("fill_rate", "pixels", fillPixels, [&]() { fill(textureId); });
+		glDeleteTextures(1, &textureId);
+
+		GLuint rgb565TextureId = loadTexture(image, PIXEL_RGB565);
+		RunScenario("fill_rate_rgb565", "pixels", fillPixels, [&]() { fill(rgb565TextureId); });
+		glDeleteTextures(1, &rgb565TextureId);
+
+		KTXTexture* etc1 = compressETC1(image);
+		GLuint etcTextureId = loadTexture(etc1);
+		if (etcTextureId)
+		{
+			RunScenario("fill_rate_etc1", "pixels", fillPixels, [&]() { fill(etcTextureId); });
+			glDeleteTextures(1, &etcTextureId);
+		}
+		delete etc1;
+	}
+
+	/*
+		Minification.
+		The image drawn whole into every cell of a MINIFY_GRID^2 grid, so each
+		pixel covers many texels.  Without mips neighbouring pixels fetch
+		texels far apart and miss the texture cache; with a mip chain they
+		read the small level.  The CPU chains are timed on their own too.
+	*/
+	{
+		float identity[] =
+		{
+			1.0f,0.0f,0.0f,0.0f,
+			0.0f,1.0f,0.0f,0.0f,
+			0.0f,0.0f,1.0f,0.0f,
+			0.0f,0.0f,0.0f,1.0f
+		};
+		std::vector<GLfloat> grid;
+		float cell = 2.0f / MINIFY_GRID;
+		for (int i = 0; i < MINIFY_GRID * MINIFY_GRID; i++)
+		{
+			float x = (i % MINIFY_GRID) * cell - 1.0f;
+			float y = (i / MINIFY_GRID) * cell - 1.0f;
+			GLfloat afCell[] = { x, y + cell, 0.0f, 0.0f, 1.0f,
+				x, y, 0.0f, 0.0f, 0.0f,
+				x + cell, y, 0.0f, 1.0f, 0.0f,
+				x, y + cell, 0.0f, 0.0f, 1.0f,
+				x + cell, y, 0.0f, 1.0f, 0.0f,
+				x + cell, y + cell, 0.0f, 1.0f, 1.0f };
+			grid.insert(grid.end(), afCell, afCell + 30);
+		}
+		auto minify = [&](GLuint textureId)
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			glUseProgram(texProgram);
+			glUniform1i(glGetUniformLocation(texProgram, "sampler2d"), 0);
+			glUniformMatrix4fv(texMatrix, 1, GL_FALSE, identity);
+			glBindTexture(GL_TEXTURE_2D, textureId);
+			glEnableVertexAttribArray(TEXCOORD_ARRAY);
+			glVertexAttribPointer(VERTEX_ARRAY, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), &grid[0]);
+			glVertexAttribPointer(TEXCOORD_ARRAY, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), &grid[3]);
+			for (int i = 0; i < FILL_LAYERS; i++)
+			{
+				glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(grid.size() / 5));
+			}
+			glDisableVertexAttribArray(TEXCOORD_ARRAY);
+		};
+		double minifyPixels = (double)FILL_LAYERS * surfaceWidth * surfaceHeight;
+
+		GLuint textureId = loadTexture(image);
+		RunScenario("minified_no_mips", "pixels", minifyPixels, [&]() { minify(textureId); });
+		glDeleteTextures(1, &textureId);
+
+		textureId = loadTexture(image, MIPMAP_BOX);
+		RunScenario("minified_mips", "pixels", minifyPixels, [&]() { minify(textureId); });
+		glDeleteTextures(1, &textureId);
+
+		//RGB bytes of levels 1..n, the ones generateMipChain writes
+		double chainBytes = 0;
+		for (int w = image->width, h = image->height; w > 1 || h > 1; )
+		{
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+			chainBytes += (double)w * h * 3;
+		}
+		RunScenario("mip_chain_box", "bytes", chainBytes, [&]()
+		{
+			std::vector<Image*> levels = generateMipChain(image, MIP_FILTER_BOX, false);
+			for (size_t i = 0; i < levels.size(); i++)
+				delete levels[i];
+		});
+		RunScenario("mip_chain_kaiser_srgb", "bytes", chainBytes, [&]()
+		{
+			std::vector<Image*> levels = generateMipChain(image, MIP_FILTER_KAISER, true);
+			for (size_t i = 0; i < levels.size(); i++)
+				delete levels[i];
+		});
+	}
+
+	/*
+		Virtual texture.
+		A fullscreen view showing VT_ZOOM of the image panned diagonally
+		across it, streaming pages into a VT_BUDGET cache each frame, as a
+		photo larger than GL_MAX_TEXTURE_SIZE would be shown.
+	*/
+	{
+		float identity[] =
+		{
+			1.0f,0.0f,0.0f,0.0f,
+			0.0f,1.0f,0.0f,0.0f,
+			0.0f,0.0f,1.0f,0.0f,
+			0.0f,0.0f,0.0f,1.0f
+		};
+		VirtualTexture virtualTexture(VT_PAGE_SIZE, VT_BUDGET);
+		if (virtualTexture.init(image))
+		{
+			RunScenario("virtual_texture_pan", "frames", VT_FRAMES, [&]()
+			{
+				for (int i = 0; i < VT_FRAMES; i++)
+				{
+					float u0 = (1.0f - VT_ZOOM) * i / (VT_FRAMES - 1);
+					virtualTexture.update(u0, u0, u0 + VT_ZOOM, u0 + VT_ZOOM);
+					virtualTexture.draw(identity, -1.0f, -1.0f, 2.0f, 2.0f, u0, u0, u0 + VT_ZOOM, u0 + VT_ZOOM);
+				}
+			});
+		}
+	}
+
+	/*
+		Sprites.
+		SPRITE_COUNT small quads using SPRITE_GRID^2 different images, first
+		with one texture, bind and draw per sprite as SourceCode.cpp does,
+		then packed into an atlas and drawn through a SpriteBatch.
+	*/
+	{
+		std::vector<Image*> tiles;
+		int tileWidth = image->width / SPRITE_GRID;
+		int tileHeight = image->height / SPRITE_GRID;
+		for (int i = 0; i < SPRITE_GRID * SPRITE_GRID; i++)
+		{
+			tiles.push_back(CropImage(image, (i % SPRITE_GRID) * tileWidth,
+				(i / SPRITE_GRID) * tileHeight, tileWidth, tileHeight));
+		}
+
+		std::vector<GLuint> tileTextures;
+		TextureAtlas atlas(1024, 1024);
+		for (size_t i = 0; i < tiles.size(); i++)
+		{
+			tileTextures.push_back(loadTexture(tiles[i]));
+			atlas.add(tiles[i]);
+		}
+		atlas.build();
+		atlas.upload();
+
+		float identity[] =
+		{
+			1.0f,0.0f,0.0f,0.0f,
+			0.0f,1.0f,0.0f,0.0f,
+			0.0f,0.0f,1.0f,0.0f,
+			0.0f,0.0f,0.0f,1.0f
+		};
+
+		RunScenario("sprites_unbatched", "sprites", SPRITE_COUNT, [&]()
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			glUseProgram(texProgram);
+			glUniform1i(glGetUniformLocation(texProgram, "sampler2d"), 0);
+			glEnableVertexAttribArray(TEXCOORD_ARRAY);
+			for (int i = 0; i < SPRITE_COUNT; i++)
+			{
+				float x = (i % 50) * SPRITE_SIZE - 1.0f;
+				float y = (i / 50 % 50) * SPRITE_SIZE - 1.0f;
+				GLfloat afQuad[] = { x, y + SPRITE_SIZE, 0.0f, 0.0f, 1.0f,
+					x, y, 0.0f, 0.0f, 0.0f,
+					x + SPRITE_SIZE, y, 0.0f, 1.0f, 0.0f,
+					x + SPRITE_SIZE, y + SPRITE_SIZE, 0.0f, 1.0f, 1.0f };
+				glUniformMatrix4fv(texMatrix, 1, GL_FALSE, identity);
+				glBindTexture(GL_TEXTURE_2D, tileTextures[i % tileTextures.size()]);
+				glVertexAttribPointer(VERTEX_ARRAY, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), afQuad);
+				glVertexAttribPointer(TEXCOORD_ARRAY, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), &afQuad[3]);
+				glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+			}
+			glDisableVertexAttribArray(TEXCOORD_ARRAY);
+		});
+
+		SpriteBatch batch(SPRITE_COUNT);
+		if (batch.init())
+		{
+			RunScenario("sprites_batched", "sprites", SPRITE_COUNT, [&]()
+			{
+				glClear(GL_COLOR_BUFFER_BIT);
+				batch.begin(identity);
+				for (int i = 0; i < SPRITE_COUNT; i++)
+				{
+					float x = (i % 50) * SPRITE_SIZE - 1.0f;
+					float y = (i / 50 % 50) * SPRITE_SIZE - 1.0f;
+					batch.draw(atlas, i % atlas.regionCount(), x, y, SPRITE_SIZE, SPRITE_SIZE);
+				}
+				batch.end();
+			});
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			glDisableVertexAttribArray(TEXCOORD_ARRAY);
+		}
+
+		glDeleteTextures((GLsizei)tileTextures.size(), &tileTextures[0]);
+		for (size_t i = 0; i < tiles.size(); i++)
+			delete tiles[i];
+	}
+
+	/*
+		Texture upload bandwidth.
+		loadTexture on the decoded BMP; the upload is only complete once
+		glFinish returns, which RunScenario waits for.
+	*/
+	{
+		RunScenario("texture_upload", "bytes", (double)UPLOAD_COUNT * image->width * image->height * 3, [&]()
+		{
+			for (int i = 0; i < UPLOAD_COUNT; i++)
+			{
+				GLuint textureId = loadTexture(image);
+				glDeleteTextures(1, &textureId);
+			}
+		});
+	}
+
+	/*
+		16-bit conversion and upload.
+		convertRGB to dithered RGB565 on the CPU, then loadTexture uploading
+		the converted texels, measured in bytes of RGB source.
+	*/
+	{
+		double imageBytes = (double)image->width * image->height * 3;
+		std::vector<unsigned short> texels(image->width * image->height);
+		RunScenario("rgb565_convert", "bytes", imageBytes, [&]()
+		{
+			convertRGB(image->pixels, image->width, image->height, PIXEL_RGB565, true, &texels[0]);
+		});
+		RunScenario("texture_upload_rgb565", "bytes", UPLOAD_COUNT * imageBytes, [&]()
+		{
+			for (int i = 0; i < UPLOAD_COUNT; i++)
+			{
+				GLuint textureId = loadTexture(image, PIXEL_RGB565);
+				glDeleteTextures(1, &textureId);
+			}
+		});
+	}
+
+	/*
+		BMP decode.
+		loadBMP from disk, measured in bytes of decoded RGB.
+	*/
+	{
+		RunScenario("bmp_decode", "bytes", (double)DECODE_COUNT * image->width * image->height * 3, [&]()
+		{
+			for (int i = 0; i < DECODE_COUNT; i++)
+			{
+				delete loadBMP(BENCH_IMAGE);
+			}
+		});
+	}
+
+	/*
+		Per-draw constants.
+		CONSTANT_OBJECTS heptagons, each with its own matrix and colour.
+		constants_uniform sets them with glUniform* before every draw as the
+		demos do; constants_uniform_array packs a batch of objects into one
+		uniform array upload and draw (ES 2.0); constants_ubo_ring pushes
+		them all into a UniformRing and selects each with glBindBufferRange
+		(ES 3.0 contexts only).
+	*/
+	{
+		char* pszUniformVertShader = "\
+			attribute highp vec4	myVertex;\
+			uniform mediump mat4	myPMVMatrix;\
+			void main(void)\
+			{\
+				gl_Position = myPMVMatrix * myVertex;\
+			}";
+		char* pszUniformFragShader = "\
+			uniform lowp vec4	myColor;\
+			void main (void)\
+			{\
+				gl_FragColor = myColor;\
+			}";
+		char* pszBlockVertShader = "#version 300 es\n\
+			in highp vec4	myVertex;\n\
+			layout(std140) uniform DrawConstants\n\
+			{\n\
+				mediump mat4	myPMVMatrix;\n\
+				lowp vec4		myColor;\n\
+			};\n\
+			flat out lowp vec4	myTint;\n\
+			void main(void)\n\
+			{\n\
+				gl_Position = myPMVMatrix * myVertex;\n\
+				myTint = myColor;\n\
+			}";
+		char* pszBlockFragShader = "#version 300 es\n\
+			flat in lowp vec4	myTint;\n\
+			out lowp vec4		fragColor;\n\
+			void main (void)\n\
+			{\n\
+				fragColor = myTint;\n\
+			}";
+
+		// The fan of Polygon.cpp split into triangles
+		GLfloat afPolygon[2 * POLYGON_SIDES];
+		tessellatePolygon(afPolygon, 2 * POLYGON_SIDES, POLYGON_SIDES, POLYGON_RADIUS);
+		GLfloat afTriangles[6 * (POLYGON_SIDES - 2)];
+		for (int t = 0; t < POLYGON_SIDES - 2; t++)
+		{
+			int corners[] = { 0, t + 1, t + 2 };
+			for (int c = 0; c < 3; c++)
+			{
+				afTriangles[6 * t + 2 * c] = afPolygon[2 * corners[c]];
+				afTriangles[6 * t + 2 * c + 1] = afPolygon[2 * corners[c] + 1];
+			}
+		}
+		int triangleVertices = 3 * (POLYGON_SIDES - 2);
+
+		std::vector<DrawConstants> constants(CONSTANT_OBJECTS);
+		for (int i = 0; i < CONSTANT_OBJECTS; i++)
+		{
+			Transform2D transform = { (i % 70) * (2.0f / 70) - 0.985f, (i / 70 % 70) * (2.0f / 70) - 0.985f, i * 0.37f, 0.3f };
+			transformMatrix(transform, constants[i].matrix);
+			constants[i].color[0] = (i % 7) / 6.0f;
+			constants[i].color[1] = (i % 11) / 10.0f;
+			constants[i].color[2] = (i % 13) / 12.0f;
+			constants[i].color[3] = 1.0f;
+		}
+
+		GLuint meshBuffer;
+		glGenBuffers(1, &meshBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(afTriangles), afTriangles, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		GLuint uniformProgram = LoadProgram(pszUniformVertShader, pszUniformFragShader);
+		if (uniformProgram)
+		{
+			GLint matrixLocation = glGetUniformLocation(uniformProgram, "myPMVMatrix");
+			GLint colorLocation = glGetUniformLocation(uniformProgram, "myColor");
+			RunScenario("constants_uniform", "draws", CONSTANT_OBJECTS, [&]()
+			{
+				glClear(GL_COLOR_BUFFER_BIT);
+				glUseProgram(uniformProgram);
+				glBindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+				glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 0, 0);
+				for (int i = 0; i < CONSTANT_OBJECTS; i++)
+				{
+					glUniformMatrix4fv(matrixLocation, 1, GL_FALSE, constants[i].matrix);
+					glUniform4fv(colorLocation, 1, constants[i].color);
+					glDrawArrays(GL_TRIANGLES, 0, triangleVertices);
+				}
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+			});
+			glDeleteProgram(uniformProgram);
+		}
+
+		ConstantArrayBatch arrayBatch;
+		if (arrayBatch.init(afTriangles, triangleVertices))
+		{
+			RunScenario("constants_uniform_array", "draws", CONSTANT_OBJECTS, [&]()
+			{
+				glClear(GL_COLOR_BUFFER_BIT);
+				arrayBatch.draw(&constants[0], CONSTANT_OBJECTS);
+			});
+		}
+
+		// Room for every object even at a 512 byte offset alignment
+		UniformRing ring(CONSTANT_OBJECTS * 512);
+		GLuint blockProgram = UniformRing::supported() ? LoadProgram(pszBlockVertShader, pszBlockFragShader) : 0;
+		if (blockProgram && ring.init() && UniformRing::bindBlock(blockProgram, "DrawConstants", 0))
+		{
+			std::vector<GLintptr> offsets(CONSTANT_OBJECTS);
+			RunScenario("constants_ubo_ring", "draws", CONSTANT_OBJECTS, [&]()
+			{
+				ring.beginFrame();
+				for (int i = 0; i < CONSTANT_OBJECTS; i++)
+					offsets[i] = ring.push(&constants[i], sizeof(DrawConstants));
+				ring.flush();
+
+				glClear(GL_COLOR_BUFFER_BIT);
+				glUseProgram(blockProgram);
+				glBindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+				glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 0, 0);
+				for (int i = 0; i < CONSTANT_OBJECTS; i++)
+				{
+					ring.bind(0, offsets[i], sizeof(DrawConstants));
+					glDrawArrays(GL_TRIANGLES, 0, triangleVertices);
+				}
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				ring.endFrame();
+			});
+		}
+		glDeleteProgram(blockProgram);
+		glDeleteBuffers(1, &meshBuffer);
+		glEnableVertexAttribArray(VERTEX_ARRAY);
+	}
+
+	/*
+		Render queue.
+		RQ_OBJECTS quads, a quarter of them translucent, each either flat
+		coloured or textured with one of RQ_TEXTURES tiles, submitted in an
+		order unrelated to their state.  render_queue_unsorted executes them
+		as submitted, render_queue_sorted radix sorts the keys first; both
+		report their program and texture switches per frame.
+	*/
+	{
+		std::vector<GLuint> textures;
+		for (int i = 0; i < RQ_TEXTURES; i++)
+		{
+			Image* tile = CropImage(image, (i % 4) * image->width / 4, (i / 4) * image->height / 4,
+				image->width / 4, image->height / 4);
+			textures.push_back(loadTexture(tile));
+			delete tile;
+		}
+
+		// x, y, u, v
+		GLfloat afQuad[] = { -0.02f, 0.02f, 0.0f, 1.0f,
+			-0.02f, -0.02f, 0.0f, 0.0f,
+			0.02f, -0.02f, 1.0f, 0.0f,
+			0.02f, 0.02f, 1.0f, 1.0f };
+
+		std::vector<GLfloat> matrices(16 * RQ_OBJECTS);
+		std::vector<QueuedDraw> scene(RQ_OBJECTS);
+		std::vector<float> depths(RQ_OBJECTS);
+		for (int i = 0; i < RQ_OBJECTS; i++)
+		{
+			// A cheap hash spreads the state over the scene order
+			unsigned int h = (unsigned int)i * 2654435761u;
+			Transform2D transform = { (i % 64) / 32.0f - 0.98f, (i / 64 % 64) / 32.0f - 0.98f, 0.0f, 1.0f };
+			transformMatrix(transform, &matrices[16 * i]);
+
+			bool textured = (h >> 8) % 3 != 0;
+			QueuedDraw& draw = scene[i];
+			draw.program = textured ? texProgram : colorProgram;
+			draw.texture = textured ? textures[(h >> 12) % RQ_TEXTURES] : 0;
+			draw.matrixLocation = textured ? texMatrix : colorMatrix;
+			draw.matrix = &matrices[16 * i];
+			draw.vertices = afQuad;
+			draw.texCoords = textured ? &afQuad[2] : NULL;
+			draw.size = 2;
+			draw.stride = 4 * sizeof(GLfloat);
+			draw.mode = GL_TRIANGLE_FAN;
+			draw.first = 0;
+			draw.count = 4;
+			depths[i] = ((h >> 16) & 0xff) / 255.0f;
+		}
+
+		RenderQueue queue(RQ_OBJECTS);
+		GLBackend backend;
+		const char* names[] = { "render_queue_unsorted", "render_queue_sorted" };
+		for (int sorted = 0; sorted < 2; sorted++)
+		{
+			RunScenario(names[sorted], "draws", RQ_OBJECTS, [&]()
+			{
+				glClear(GL_COLOR_BUFFER_BIT);
+				queue.clear();
+				for (int i = 0; i < RQ_OBJECTS; i++)
+					queue.submit(0, i % 4 == 0, depths[i], scene[i]);
+				if (sorted)
+					queue.sort();
+				backend.invalidate();
+				queue.execute(backend);
+				backend.disableVertexArray(TEXCOORD_ARRAY);
+			});
+			AddCounter("program_switches", queue.programSwitches());
+			AddCounter("texture_switches", queue.textureSwitches());
+		}
+
+		glDeleteTextures((GLsizei)textures.size(), &textures[0]);
+		glEnableVertexAttribArray(VERTEX_ARRAY);
+	}
+
+	/*
+		Transient frame data.
+		FRAME_COUNT frames of FRAME_OBJECTS polygons whose side counts change
+		every frame: each frame tessellates them, stages their matrices and
+		records and replays a draw list.  frame_alloc_arena takes all of it
+		from a FrameArena, frame_alloc_heap from new[] and vectors as code
+		without the arena would.
+	*/
+	{
+		GLBackend backend;
+		auto buildFrame = [&](int frame, GLfloat** vertices, Transform2D* transforms)
+		{
+			for (int i = 0; i < FRAME_OBJECTS; i++)
+			{
+				int sides = 3 + (i + frame) % 30;
+				tessellatePolygon(vertices[i], polygonFloatCount(sides), sides, POLYGON_RADIUS);
+				Transform2D transform = { (i % 50) * 0.04f - 0.98f, (i / 50 % 50) * 0.04f - 0.98f, frame * 3.0f, 1.0f };
+				transforms[i] = transform;
+			}
+		};
+		auto recordFrame = [&](int frame, CommandList& list, GLfloat** vertices, const GLfloat* matrices)
+		{
+			list.useProgram(colorProgram);
+			for (int i = 0; i < FRAME_OBJECTS; i++)
+			{
+				list.vertexArray(VERTEX_ARRAY, 2, GL_FLOAT, false, 0, vertices[i]);
+				list.uniformMatrix4(colorMatrix, matrices + 16 * i);
+				list.drawArrays(GL_TRIANGLE_FAN, 0, 3 + (i + frame) % 30);
+			}
+		};
+
+		FrameArena frameArena;
+		CommandList frameList(&frameArena);
+		int frame = 0;
+		RunScenario("frame_alloc_arena", "frames", FRAME_COUNT, [&]()
+		{
+			for (int f = 0; f < FRAME_COUNT; f++, frame++)
+			{
+				frameArena.beginFrame();
+				GLfloat** vertices = frameArena.allocate<GLfloat*>(FRAME_OBJECTS);
+				for (int i = 0; i < FRAME_OBJECTS; i++)
+					vertices[i] = frameArena.allocate<GLfloat>(polygonFloatCount(3 + (i + frame) % 30));
+				Transform2D* transforms = frameArena.allocate<Transform2D>(FRAME_OBJECTS);
+				GLfloat* matrices = frameArena.allocate<GLfloat>(16 * FRAME_OBJECTS);
+				buildFrame(frame, vertices, transforms);
+				computeTransforms(transforms, FRAME_OBJECTS, matrices, 1);
+
+				frameList.reset();
+				recordFrame(frame, frameList, vertices, matrices);
+				glClear(GL_COLOR_BUFFER_BIT);
+				backend.invalidate();
+				frameList.replay(backend);
+			}
+		});
+
+		RunScenario("frame_alloc_heap", "frames", FRAME_COUNT, [&]()
+		{
+			for (int f = 0; f < FRAME_COUNT; f++, frame++)
+			{
+				std::vector<GLfloat*> vertices(FRAME_OBJECTS);
+				for (int i = 0; i < FRAME_OBJECTS; i++)
+					vertices[i] = new GLfloat[polygonFloatCount(3 + (i + frame) % 30)];
+				std::vector<Transform2D> transforms(FRAME_OBJECTS);
+				std::vector<GLfloat> matrices(16 * FRAME_OBJECTS);
+				buildFrame(frame, &vertices[0], &transforms[0]);
+				computeTransforms(&transforms[0], FRAME_OBJECTS, &matrices[0], 1);
+
+				CommandList* list = new CommandList();
+				recordFrame(frame, *list, &vertices[0], &matrices[0]);
+				glClear(GL_COLOR_BUFFER_BIT);
+				backend.invalidate();
+				list->replay(backend);
+				delete list;
+				for (int i = 0; i < FRAME_OBJECTS; i++)
+					delete[] vertices[i];
+			}
+		});
+	}
+
+	/*
+		Job system scaling.
+		Work ported onto the job system, run with 1, 2, 4... jobs up to
+		the size of the pool: BMP decode, a heart of JOB_HEART_INC_ANGLE
+		steps, and the matrices of JOB_TRANSFORMS objects.
+	*/
+	{
+		const char* decodeNames[] = { "jobs_bmp_decode_1t", "jobs_bmp_decode_2t", "jobs_bmp_decode_4t",
+			"jobs_bmp_decode_8t", "jobs_bmp_decode_16t" };
+		const char* heartNames[] = { "jobs_heart_1t", "jobs_heart_2t", "jobs_heart_4t",
+			"jobs_heart_8t", "jobs_heart_16t" };
+		const char* transformNames[] = { "jobs_transforms_1t", "jobs_transforms_2t", "jobs_transforms_4t",
+			"jobs_transforms_8t", "jobs_transforms_16t" };
+
+		std::vector<GLfloat> afHeart(JOB_HEART_LIMIT);
+		int heartVertices = tessellateHeart(&afHeart[0], JOB_HEART_LIMIT, HEART_RADIUS, JOB_HEART_INC_ANGLE) / 3;
+
+		std::vector<Transform2D> transforms(JOB_TRANSFORMS);
+		for (int i = 0; i < JOB_TRANSFORMS; i++)
+		{
+			Transform2D transform = { (i % 400) * 0.005f - 1.0f, (i / 400 % 400) * 0.005f - 1.0f, i * 0.37f, 1.0f };
+			transforms[i] = transform;
+		}
+		std::vector<GLfloat> matrices(16 * JOB_TRANSFORMS);
+
+		int threads = 1;
+		for (int n = 0; n < 5 && threads <= jobSystem().threadCount(); n++, threads *= 2)
+		{
+			RunScenario(decodeNames[n], "bytes", (double)image->width * image->height * 3, [&]()
+			{
+				delete loadBMP(BENCH_IMAGE, threads);
+			});
+			RunScenario(heartNames[n], "vertices", heartVertices, [&]()
+			{
+				tessellateHeart(&afHeart[0], JOB_HEART_LIMIT, HEART_RADIUS, JOB_HEART_INC_ANGLE, threads);
+			});
+			RunScenario(transformNames[n], "matrices", JOB_TRANSFORMS, [&]()
+			{
+				computeTransforms(&transforms[0], JOB_TRANSFORMS, &matrices[0], threads);
+			});
+		}
+	}
+
+	/*
+		Pack loading.
+		Only when BENCH_PACK was built with "AssetTools pack ... blackbuck.bmp":
+		mapping the pack, then DECODE_COUNT lookups plus KTX parses of the
+		texture out of the mapping, to compare against bmp_decode.
+	*/
+	{
+		AssetPack pack;
+		if (pack.open(BENCH_PACK))
+		{
+			pack.close();
+			RunScenario("pack_open", "opens", 1, [&]()
+			{
+				pack.open(BENCH_PACK);
+				pack.close();
+			});
+
+			pack.open(BENCH_PACK);
+			PackAsset asset;
+			if (pack.find(BENCH_IMAGE, &asset))
+			{
+				RunScenario("pack_texture_load", "bytes", (double)DECODE_COUNT * asset.size, [&]()
+				{
+					for (int i = 0; i < DECODE_COUNT; i++)
+					{
+						PackAsset found;
+						pack.find(BENCH_IMAGE, &found);
+						delete loadKTX(found.data, found.size);
+					}
+				});
+			}
+		}
+	}
+
+	/*
+		Video streaming.
+		VIDEO_FRAMES synthetic frames uploaded and drawn fullscreen through a
+		VideoTexture at 1080p and 4K, measured in bytes of YUV uploaded, so
+		the sustained rate can be compared against the frame rate of a clip
+		times yuvFrameSize.  When BENCH_VIDEO exists its frames are played
+		the same way, file reads included.
+	*/
+	{
+		float identity[] =
+		{
+			1.0f,0.0f,0.0f,0.0f,
+			0.0f,1.0f,0.0f,0.0f,
+			0.0f,0.0f,1.0f,0.0f,
+			0.0f,0.0f,0.0f,1.0f
+		};
+		struct { const char* name; int width; int height; YuvLayout layout; } videos[] =
+		{
+			{ "video_upload_1080p_nv12", 1920, 1080, YUV_NV12 },
+			{ "video_upload_1080p_i420", 1920, 1080, YUV_I420 },
+			{ "video_upload_4k_nv12", 3840, 2160, YUV_NV12 }
+		};
+		for (int v = 0; v < (int)(sizeof(videos) / sizeof(videos[0])); v++)
+		{
+			VideoTexture video(videos[v].width, videos[v].height, videos[v].layout);
+			if (!video.init())
+				continue;
+
+			//A gradient, so the planes aren't trivially compressible by the driver
+			std::vector<unsigned char> frame(yuvFrameSize(videos[v].width, videos[v].height));
+			for (size_t i = 0; i < frame.size(); i++)
+				frame[i] = (unsigned char)(i * 7 + i / 4096);
+
+			RunScenario(videos[v].name, "bytes", (double)VIDEO_FRAMES * frame.size(), [&]()
+			{
+				for (int i = 0; i < VIDEO_FRAMES; i++)
+				{
+					video.upload(&frame[0]);
+					video.draw(identity, -1.0f, -1.0f, 2.0f, 2.0f);
+				}
+			});
+		}
+
+		RawVideoFile file;
+		VideoTexture video(BENCH_VIDEO_WIDTH, BENCH_VIDEO_HEIGHT, YUV_NV12);
+		if (file.open(BENCH_VIDEO, BENCH_VIDEO_WIDTH, BENCH_VIDEO_HEIGHT) && file.nextFrame() && video.init())
+		{
+			RunScenario("video_file_playback", "frames", VIDEO_FRAMES, [&]()
+			{
+				for (int i = 0; i < VIDEO_FRAMES; i++)
+				{
+					video.upload(file.nextFrame());
+					video.draw(identity, -1.0f, -1.0f, 2.0f, 2.0f);
+				}
+			});
+		}
+	}
+
+	/*
+		Command lists.
+		COMMAND_OBJECTS polygon fans, each with a matrix built from its own
+		rotation and position.  command_inline computes and draws them on
+		this thread as the demos do; command_record_<n>t only records them
+		into one CommandList per job over n jobs on the shared job system,
+		to show how the CPU side of a frame scales with cores; command_replay submits the
+		recorded lists in order through a GLBackend.
+	*/
+	{
+		GLfloat afPolygon[2 * POLYGON_SIDES];
+		tessellatePolygon(afPolygon, 2 * POLYGON_SIDES, POLYGON_SIDES, POLYGON_RADIUS);
+
+		// Matrix of object i, rotated about its own centre
+		auto objectMatrix = [](int i, float* matrix)
+		{
+			float a = i * 0.37f;
+			float c = cosf(a), s = sinf(a);
+			float x = (i % 150) * (2.0f / 150) - 1.0f;
+			float y = (i / 150 % 150) * (2.0f / 150) - 1.0f;
+			float m[] =
+			{
+				c, s, 0.0f, 0.0f,
+				-s, c, 0.0f, 0.0f,
+				0.0f, 0.0f, 1.0f, 0.0f,
+				x, y, 0.0f, 1.0f
+			};
+			memcpy(matrix, m, sizeof(m));
+		};
+
+		RunScenario("command_inline", "draws", COMMAND_OBJECTS, [&]()
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			glUseProgram(colorProgram);
+			glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 0, afPolygon);
+			for (int i = 0; i < COMMAND_OBJECTS; i++)
+			{
+				float matrix[16];
+				objectMatrix(i, matrix);
+				glUniformMatrix4fv(colorMatrix, 1, GL_FALSE, matrix);
+				glDrawArrays(GL_TRIANGLE_FAN, 0, POLYGON_SIDES);
+			}
+		});
+
+		std::vector<CommandList> lists(jobSystem().threadCount());
+		auto record = [&](CommandList* list, int first, int last)
+		{
+			list->reset();
+			list->useProgram(colorProgram);
+			list->vertexArray(VERTEX_ARRAY, 2, GL_FLOAT, false, 0, afPolygon);
+			for (int i = first; i < last; i++)
+			{
+				float matrix[16];
+				objectMatrix(i, matrix);
+				list->uniformMatrix4(colorMatrix, matrix);
+				list->drawArrays(GL_TRIANGLE_FAN, 0, POLYGON_SIDES);
+			}
+		};
+
+		const char* recordNames[] = { "command_record_1t", "command_record_2t", "command_record_4t",
+			"command_record_8t", "command_record_16t" };
+		int threads = 1;
+		for (int n = 0; n < 5 && threads <= (int)lists.size(); n++, threads *= 2)
+		{
+			RunScenario(recordNames[n], "draws", COMMAND_OBJECTS, [&]()
+			{
+				// One list per job; the pool's workers are already running
+				parallelRanges(threads, threads, [&](int first, int last)
+				{
+					for (int t = first; t < last; t++)
+						record(&lists[t], COMMAND_OBJECTS * t / threads, COMMAND_OBJECTS * (t + 1) / threads);
+				});
+			});
+		}
+
+		// The lists now hold the scene split over the largest thread count measured
+		int recorded = threads / 2;
+		GLBackend backend;
+		RunScenario("command_replay", "draws", COMMAND_OBJECTS, [&]()
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			backend.invalidate();
+			for (int t = 0; t < recorded; t++)
+				lists[t].replay(backend);
+		});
+	}
+
+	/*
+		Software rasterizer.
+		The draw_calls, vertices and fill_rate scenes replayed through a
+		SoftwareBackend the size of the surface, flushed once per
+		repetition.  On a host whose GLES comes from Mesa, the GL scenarios
+		above measure llvmpipe on the same work.
+	*/
+	{
+		SoftwareBackend soft(surfaceWidth, surfaceHeight, SOFT_TILE_SIZE);
+		SoftProgram colorShading = { colorMatrix, -1, { 1.0f, 0.0f, 0.0f, 0.0f }, false };
+		SoftProgram texShading = { texMatrix, -1, { 0.0f, 0.0f, 0.0f, 0.0f }, true };
+		soft.defineProgram(colorProgram, colorShading);
+		soft.defineProgram(texProgram, texShading);
+		soft.defineTexture(1, image);
+
+		GLfloat afPolygon[2 * POLYGON_SIDES];
+		tessellatePolygon(afPolygon, 2 * POLYGON_SIDES, POLYGON_SIDES, POLYGON_RADIUS);
+		RunScenario("soft_draw_calls", "draws", POLYGON_DRAWS, [&]()
+		{
+			soft.clear(0.6f, 0.8f, 1.0f, 1.0f);
+			soft.useProgram(colorProgram);
+			soft.vertexArray(VERTEX_ARRAY, 2, GL_FLOAT, false, 0, afPolygon);
+			for (int i = 0; i < POLYGON_DRAWS; i++)
+			{
+				float matrix[] =
+				{
+					1.0f,0.0f,0.0f,0.0f,
+					0.0f,1.0f,0.0f,0.0f,
+					0.0f,0.0f,1.0f,0.0f,
+					(i % 40) * 0.05f - 0.975f, (i / 40 % 40) * 0.05f - 0.975f,0.0f,1.0f
+				};
+				soft.uniformMatrix4(colorMatrix, matrix);
+				soft.drawArrays(GL_TRIANGLE_FAN, 0, POLYGON_SIDES);
+			}
+			soft.flush();
+		});
+
+		std::vector<GLfloat> afHeart(HEART_VERTEX_LIMIT * 3);
+		GLint countVert = tessellateHeart(&afHeart[0], (int)afHeart.size(), HEART_RADIUS, HEART_INC_ANGLE);
+		float angle = -45.0f;
+		float heartMatrix[] =
+		{
+			cosf(angle*PI / 180.0f), -sinf(angle*PI / 180.0f),0.0f,0.0f,
+			sinf(angle*PI / 180.0f), cosf(angle*PI / 180.0f),0.0f,0.0f,
+			0.0f,0.0f,1.0f,0.0f,
+			0.0f,0.0f,0.0f,1.0f
+		};
+		RunScenario("soft_vertices", "vertices", (double)HEART_DRAWS * (countVert / 3), [&]()
+		{
+			soft.clear(0.6f, 0.8f, 1.0f, 1.0f);
+			soft.useProgram(colorProgram);
+			soft.uniformMatrix4(colorMatrix, heartMatrix);
+			soft.vertexArray(VERTEX_ARRAY, 3, GL_FLOAT, false, 0, &afHeart[0]);
+			for (int i = 0; i < HEART_DRAWS; i++)
+			{
+				soft.drawArrays(GL_TRIANGLE_FAN, 0, countVert / 3);
+			}
+			soft.flush();
+		});
+
+		GLfloat afQuad[] = { -1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+			-1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+			1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+			1.0f, 1.0f, 0.0f, 1.0f, 1.0f };
+		float identity[] =
+		{
+			1.0f,0.0f,0.0f,0.0f,
+			0.0f,1.0f,0.0f,0.0f,
+			0.0f,0.0f,1.0f,0.0f,
+			0.0f,0.0f,0.0f,1.0f
+		};
+		RunScenario("soft_fill_rate", "pixels", (double)FILL_LAYERS * surfaceWidth * surfaceHeight, [&]()
+		{
+			soft.useProgram(texProgram);
+			soft.uniformMatrix4(texMatrix, identity);
+			soft.bindTexture(0, 1);
+			soft.vertexArray(VERTEX_ARRAY, 3, GL_FLOAT, false, 5 * sizeof(GLfloat), afQuad);
+			soft.vertexArray(TEXCOORD_ARRAY, 2, GL_FLOAT, false, 5 * sizeof(GLfloat), &afQuad[3]);
+			for (int i = 0; i < FILL_LAYERS; i++)
+			{
+				soft.drawArrays(GL_TRIANGLE_FAN, 0, 4);
+			}
+			soft.flush();
+		});
+	}
+
+	/*
+		Vector icons.
+		PATH_ICONS hearts of PATH_ICON_RADIUS, each with its own matrix.
+		path_icons_stencil fills one cached Bezier path with stencil-then-
+		cover; path_icons_cpu tessellates every heart on the CPU each frame
+		at Heart.cpp's 1 degree step and draws it as a fan.
+	*/
+	{
+		auto iconMatrix = [](int i, float* matrix)
+		{
+			float m[] =
+			{
+				PATH_ICON_RADIUS,0.0f,0.0f,0.0f,
+				0.0f,PATH_ICON_RADIUS,0.0f,0.0f,
+				0.0f,0.0f,1.0f,0.0f,
+				(i % 40) * 0.05f - 0.975f, (i / 40 % 40) * 0.05f - 0.975f,0.0f,1.0f
+			};
+			memcpy(matrix, m, sizeof(m));
+		};
+		GLfloat red[] = { 1.0f, 0.0f, 0.0f, 1.0f };
+
+		PathRenderer paths;
+		Path heart;
+		BuildHeartPath(heart, 1.0f);
+		if (paths.init())
+		{
+			int iconVertices = 0;
+			RunScenario("path_icons_stencil", "icons", PATH_ICONS, [&]()
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+				paths.begin(surfaceWidth, surfaceHeight);
+				for (int i = 0; i < PATH_ICONS; i++)
+				{
+					float matrix[16];
+					iconMatrix(i, matrix);
+					iconVertices = paths.fill(heart, matrix, red);
+				}
+				paths.end();
+			});
+			AddCounter("vertices_per_icon", iconVertices);
+			AddCounter("flattens", heart.flattenCount());
+		}
+
+		std::vector<GLfloat> afHeart(heartFloatCount(1.0f));
+		RunScenario("path_icons_cpu", "icons", PATH_ICONS, [&]()
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			glUseProgram(colorProgram);
+			for (int i = 0; i < PATH_ICONS; i++)
+			{
+				float matrix[16];
+				iconMatrix(i, matrix);
+				GLint countVert = tessellateHeart(&afHeart[0], (int)afHeart.size(), 1.0f, 1.0f, 1);
+				glUniformMatrix4fv(colorMatrix, 1, GL_FALSE, matrix);
+				glVertexAttribPointer(VERTEX_ARRAY, 3, GL_FLOAT, GL_FALSE, 0, &afHeart[0]);
+				glDrawArrays(GL_TRIANGLE_FAN, 0, countVert / 3);
+			}
+		});
+		AddCounter("vertices_per_icon", afHeart.size() / 3.0);
+	}
+
+	/*
+		Triangulation.
+		TESS_INSTANCES stars of 5 to 5 + TESS_SHAPES points, as a scene of
+		icons would repeat a few outlines.  tessellation_uncached runs the
+		ear clipper for every instance; tessellation_cached looks the
+		outline up in a TessellationCache, so each shape is triangulated
+		once over all repetitions.  Both draw the resulting triangle lists.
+	*/
+	{
+		std::vector<GLfloat> afStars(TESS_SHAPES * starFloatCount(5 + TESS_SHAPES));
+		std::vector<int> starOffsets;
+		for (int shape = 0, offset = 0; shape < TESS_SHAPES; shape++)
+		{
+			starOffsets.push_back(offset);
+			offset += tessellateStar(&afStars[offset], (int)afStars.size() - offset, 5 + shape, 0.02f, 0.008f);
+		}
+		std::vector<GLushort> indices;
+		TessellationCache cache;
+
+		for (int cached = 0; cached < 2; cached++)
+		{
+			RunScenario(cached ? "tessellation_cached" : "tessellation_uncached", "shapes", TESS_INSTANCES, [&]()
+			{
+				glClear(GL_COLOR_BUFFER_BIT);
+				glUseProgram(colorProgram);
+				for (int i = 0; i < TESS_INSTANCES; i++)
+				{
+					int shape = i % TESS_SHAPES;
+					const GLfloat* outline = &afStars[starOffsets[shape]];
+					int contours[] = { 0, 2 * (5 + shape) };
+					const GLushort* triangles;
+					GLsizei count;
+					if (cached)
+					{
+						const Tessellation& tessellation = cache.get(outline, contours, 1);
+						triangles = &tessellation.indices[0];
+						count = (GLsizei)tessellation.indices.size();
+					}
+					else
+					{
+						count = 3 * triangulate(outline, contours, 1, indices);
+						triangles = &indices[0];
+					}
+					float matrix[] =
+					{
+						1.0f,0.0f,0.0f,0.0f,
+						0.0f,1.0f,0.0f,0.0f,
+						0.0f,0.0f,1.0f,0.0f,
+						(i % 40) * 0.05f - 0.975f, (i / 40 % 40) * 0.05f - 0.975f,0.0f,1.0f
+					};
+					glUniformMatrix4fv(colorMatrix, 1, GL_FALSE, matrix);
+					glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 0, outline);
+					glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_SHORT, triangles);
+				}
+			});
+		}
+		AddCounter("cache_hits", cache.hitCount());
+		AddCounter("cache_misses", cache.missCount());
+	}
+
+	/*
+		Text.
+		The SDF atlas is built on a worker thread, as a demo would while it
+		shows its first frames, then text_glyphs lays out and draws
+		TEXT_GLYPHS glyphs in lines of 40 at sizes from 8 to 40 pixels, all
+		from the one atlas.  sdf_font_build times a whole atlas build, and
+		hud_overlay the performance overlay drawn with the same font.
+	*/
+	{
+		SdfFont font;
+		bool fontBuilt = false;
+		std::thread builder([&]()
+		{
+			fontBuilt = font.build(BENCH_FONT, BENCH_FONT_FACE) || font.build(NULL, BENCH_FONT_FACE);
+		});
+		builder.join();
+
+		TextBatch text;
+		if (fontBuilt && text.init())
+		{
+			font.upload();
+			const char* line = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcd";
+			int lines = TEXT_GLYPHS / (int)strlen(line);
+			float pixels[] =
+			{
+				2.0f / surfaceWidth,0.0f,0.0f,0.0f,
+				0.0f,2.0f / surfaceHeight,0.0f,0.0f,
+				0.0f,0.0f,1.0f,0.0f,
+				-1.0f,-1.0f,0.0f,1.0f
+			};
+			int drawCalls = 0;
+			RunScenario("text_glyphs", "glyphs", lines * strlen(line), [&]()
+			{
+				glClear(GL_COLOR_BUFFER_BIT);
+				text.begin(pixels, surfaceWidth, surfaceHeight);
+				for (int i = 0; i < lines; i++)
+				{
+					float size = 8.0f + (i % 17) * 2.0f;
+					text.draw(font, line, (float)(i / 40 % 4) * surfaceWidth / 4, (float)(i % 40) * surfaceHeight / 40, size, 0xff000000);
+				}
+				drawCalls = text.end();
+			});
+			AddCounter("draw_calls", drawCalls);
+			AddCounter("atlas_pages", font.atlas().pageCount());
+
+			RunScenario("sdf_font_build", "glyphs", font.atlas().regionCount(), [&]()
+			{
+				SdfFont rebuilt;
+				rebuilt.build(BENCH_FONT, BENCH_FONT_FACE) || rebuilt.build(NULL, BENCH_FONT_FACE);
+			});
+
+			/*
+				The overlay's own cost per frame: recording a sample, the
+				occasional redraw of its texture and the composite.  The
+				clear is left out of the timing by doing it once.
+			*/
+			PerfHud hud;
+			if (hud.init(&font))
+			{
+				glClear(GL_COLOR_BUFFER_BIT);
+				int firstRedraw = hud.redrawCount();
+				RunScenario("hud_overlay", "frames", HUD_FRAMES, [&]()
+				{
+					for (int i = 0; i < HUD_FRAMES; i++)
+					{
+						FrameStats stats = { 1000.0f / 60.0f + (i % 7) * 0.5f, POLYGON_DRAWS, HEART_VERTEX_LIMIT, (size_t)64 << 20, 3 * POLYGON_DRAWS };
+						hud.frame(stats);
+						hud.draw(8, surfaceHeight - hud.height() - 8, surfaceWidth, surfaceHeight);
+					}
+				});
+				AddCounter("redraws_per_frame", (double)(hud.redrawCount() - firstRedraw) / ((BENCH_WARMUPS + BENCH_REPETITIONS) * HUD_FRAMES));
+			}
+		}
+	}
+
+	/*
+		Blur.
+		The image is blurred into an offscreen 1080p target at radii from 4
+		to 64 pixels: through the dual Kawase pyramid, the separable
+		Gaussian with linear sampling, and the naive Gaussian that fetches
+		every texel of the kernel.  Kawase costs about the same at every
+		radius, the Gaussians grow with it.
+	*/
+	{
+		GLuint blurTexture, blurFramebuffer;
+		glGenTextures(1, &blurTexture);
+		glBindTexture(GL_TEXTURE_2D, blurTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, BLUR_WIDTH, BLUR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glGenFramebuffers(1, &blurFramebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, blurFramebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, blurTexture, 0);
+		bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		KawaseBlur kawase(BLUR_WIDTH, BLUR_HEIGHT);
+		GaussianBlur gaussian(BLUR_WIDTH, BLUR_HEIGHT, true);
+		GaussianBlur naive(BLUR_WIDTH, BLUR_HEIGHT, false);
+		GLuint source = loadTexture(image);
+		if (complete && kawase.init() && gaussian.init() && naive.init())
+		{
+			const float radii[BLUR_RADII] = { 4.0f, 8.0f, 16.0f, 32.0f, 64.0f };
+			const char* kawaseNames[BLUR_RADII] = { "blur_kawase_r4", "blur_kawase_r8", "blur_kawase_r16",
+				"blur_kawase_r32", "blur_kawase_r64" };
+			const char* gaussianNames[BLUR_RADII] = { "blur_gaussian_r4", "blur_gaussian_r8", "blur_gaussian_r16",
+				"blur_gaussian_r32", "blur_gaussian_r64" };
+			const char* naiveNames[BLUR_RADII] = { "blur_naive_r4", "blur_naive_r8", "blur_naive_r16",
+				"blur_naive_r32", "blur_naive_r64" };
+			double blurPixels = (double)BLUR_WIDTH * BLUR_HEIGHT;
+			for (int n = 0; n < BLUR_RADII; n++)
+			{
+				float radius = radii[n];
+				RunScenario(kawaseNames[n], "pixels", blurPixels, [&]() { kawase.apply(source, radius, blurFramebuffer); });
+				int levels;
+				float offset;
+				kawase.levelsFor(radius, &levels, &offset);
+				AddCounter("levels", levels);
+
+				RunScenario(gaussianNames[n], "pixels", blurPixels, [&]() { gaussian.apply(source, radius, blurFramebuffer); });
+				AddCounter("fetches_per_pixel", 2 * gaussian.tapCount(radius));
+
+				RunScenario(naiveNames[n], "pixels", blurPixels, [&]() { naive.apply(source, radius, blurFramebuffer); });
+				AddCounter("fetches_per_pixel", 2 * naive.tapCount(radius));
+			}
+		}
+		glDeleteTextures(1, &source);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, surfaceWidth, surfaceHeight);
+		glDeleteFramebuffers(1, &blurFramebuffer);
+		glDeleteTextures(1, &blurTexture);
+	}
+
+	/*
+		Shape startup.
+		The heart Heart.cpp shows, built as it was at startup with a sin and
+		cos per vertex (shape_heart_libm), by tessellateHeart() reading the
+		whole-degree table (shape_heart_lut), and copied out of the
+		HeartTable the compiler built (shape_heart_table), which the demo
+		itself uses in place without even the copy.  shape_polygons
+		tessellates every polygon Polygon.cpp can show.
+	*/
+	{
+		static constexpr HeartTable<SHAPE_INC_ANGLE> heart(HEART_RADIUS);
+		GLfloat afShape[HeartTable<SHAPE_INC_ANGLE>::FLOATS];
+		volatile GLfloat sink = 0.0f;
+
+		RunScenario("shape_heart_libm", "shapes", SHAPE_STARTUPS, [&]()
+		{
+			for (int n = 0; n < SHAPE_STARTUPS; n++)
+			{
+				int count = 0;
+				const GLfloat square[] = { -HEART_RADIUS, HEART_RADIUS, -HEART_RADIUS, -HEART_RADIUS,
+					HEART_RADIUS, -HEART_RADIUS, HEART_RADIUS, HEART_RADIUS };
+				for (int i = 0; i < 8; i += 2)
+				{
+					afShape[count++] = square[i];
+					afShape[count++] = square[i + 1];
+					afShape[count++] = 0.0f;
+				}
+				for (int i = 0; i <= 180; i += SHAPE_INC_ANGLE)
+				{
+					afShape[count++] = HEART_RADIUS*cos(i*PI / 180.0f);
+					afShape[count++] = HEART_RADIUS + HEART_RADIUS*sin(i*PI / 180.0f);
+					afShape[count++] = 0.0f;
+				}
+				for (int i = -90; i <= 90; i += SHAPE_INC_ANGLE)
+				{
+					afShape[count++] = HEART_RADIUS + HEART_RADIUS*cos(i*PI / 180.0f);
+					afShape[count++] = HEART_RADIUS*sin(i*PI / 180.0f);
+					afShape[count++] = 0.0f;
+				}
+				sink = afShape[n % count];
+			}
+		});
+		RunScenario("shape_heart_lut", "shapes", SHAPE_STARTUPS, [&]()
+		{
+			for (int n = 0; n < SHAPE_STARTUPS; n++)
+			{
+				int count = tessellateHeart(afShape, HeartTable<SHAPE_INC_ANGLE>::FLOATS, HEART_RADIUS, SHAPE_INC_ANGLE, 1);
+				sink = afShape[n % count];
+			}
+		});
+		RunScenario("shape_heart_table", "shapes", SHAPE_STARTUPS, [&]()
+		{
+			for (int n = 0; n < SHAPE_STARTUPS; n++)
+			{
+				memcpy(afShape, heart.vertices, sizeof(heart.vertices));
+				sink = afShape[n % HeartTable<SHAPE_INC_ANGLE>::FLOATS];
+			}
+		});
+		AddCounter("vertices_per_shape", HeartTable<SHAPE_INC_ANGLE>::VERTICES);
+
+		GLfloat afPolygon[2 * 64];
+		RunScenario("shape_polygons", "shapes", SHAPE_STARTUPS * 62.0, [&]()
+		{
+			for (int n = 0; n < SHAPE_STARTUPS; n++)
+			{
+				for (int sides = 3; sides <= 64; sides++)
+					tessellatePolygon(afPolygon, 2 * 64, sides, POLYGON_RADIUS);
+				sink = afPolygon[n % 6];
+			}
+		});
+	}
+
+	/*
+		Texture budget.
+		BUDGET_TEXTURES copies of the image loaded through a TextureManager
+		whose budget holds BUDGET_RESIDENT of them.  Every frame binds the
+		next two in turn, so the least recently used are evicted and
+		reloaded as the window moves.  The manager's counters are reported
+		after the last frame.
+	*/
+	{
+		TextureManager textures;
+		std::vector<TextureHandle> handles;
+		for (int i = 0; i < BUDGET_TEXTURES; i++)
+		{
+			TextureHandle handle = textures.load(BENCH_IMAGE, PIXEL_RGB565);
+			if (handle == INVALID_TEXTURE)
+				break;
+			handles.push_back(handle);
+			if (i == 0)
+				textures.setBudget(BUDGET_RESIDENT * textures.currentBytes());
+		}
+		if (!handles.empty())
+		{
+			int frame = 0;
+			RunScenario("texture_budget", "frames", BUDGET_FRAMES, [&]()
+			{
+				for (int i = 0; i < BUDGET_FRAMES; i++, frame++)
+				{
+					textures.beginFrame();
+					textures.bind(handles[frame % handles.size()]);
+					textures.bind(handles[(frame + 1) % handles.size()]);
+				}
+			});
+			AddCounter("current_bytes", (double)textures.currentBytes());
+			AddCounter("peak_bytes", (double)textures.peakBytes());
+			AddCounter("evicted_bytes", (double)textures.evictedBytes());
+			AddCounter("evictions", textures.evictionCount());
+			AddCounter("reloads", textures.reloadCount());
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	delete image;
+
+	WriteResults(pszOutput);
+
+	glDeleteProgram(colorProgram);
+	glDeleteProgram(texProgram);
+
+cleanup:
+	eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglTerminate(eglDisplay);
+
+#ifndef NO_GDI
+	// Release the device context
+	if (hDC) ReleaseDC(hWnd, hDC);
+	// Destroy the eglWindow
+	if (hWnd) DestroyWindow(hWnd);
+#endif
+	return 0;
+}
@@ -6,6 +6,10 @@
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 #include "imageloader.h"
+#include "shapetables.h"
+#include "texturemanager.h"
+#include "dynamicresolution.h"
+#include "blur.h"
 /******************************************************************************
 Defines
 ******************************************************************************/
@@ -21,17 +25,19 @@ Defines
 #define PI 3.14159
 #define RADIUS 0.3
 
-#define VERTEX_LIMIT	1500
-#define START_TOP		0.0f
-#define END_TOP			180.0f
-#define START_RIGHT		-90.0f
-#define END_RIGHT		90.0f
 #define INC_ANGLE		1
 #define SCALE_RESET			1.0f
 #define COUNT_RESET			0
 #define SCALE_AFTER_FRAME	20
 #define SCALE_FACTOR		1.005f
 #define SCALE_LIMIT			1.3f
+// Frame budget of the dynamic resolution and the sharpening of its upscale
+#define TARGET_FRAME_MS		(1000.0f / 60.0f)
+#define MIN_RESOLUTION		0.5f
+#define UPSCALE_SHARPNESS	0.5f
+// Blur radius in pixels, stepped with the up and down keys
+#define BLUR_RADIUS_STEP	8.0f
+#define BLUR_RADIUS_LIMIT	128.0f
 /******************************************************************************
 Global variables
 ******************************************************************************/
@@ -40,6 +46,20 @@ Global variables
 bool	g_bDemoDone = false;
 float angle = -45.0f;
 
+// Owns the render target texture, freed at cleanup
+TextureManager g_textures;
+GLuint g_fboA = 0;
+
+// Renders the scene below the window resolution when frames run over budget, freed at cleanup
+DynamicResolution* g_pResolution = NULL;
+// Sharpened or plain bilinear upscale, toggled with the space bar
+bool bSharpen = true;
+
+// Blurs the upscaled frame on its way to the window when the radius is above 0
+KawaseBlur* g_pBlur = NULL;
+GLuint g_fboPost = 0;
+float blurRadius = 0.0f;
+
 /*!****************************************************************************
 @Function		WndProc
 @Input			hWnd		Handle to the window
@@ -61,6 +81,22 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 		return 1;
 	case WM_KEYDOWN:
 	{
+		switch (wParam)
+		{
+		case VK_SPACE:
+			bSharpen = !bSharpen;
+			break;
+		case VK_UP:
+			if (blurRadius < BLUR_RADIUS_LIMIT)
+				blurRadius += BLUR_RADIUS_STEP;
+			break;
+		case VK_DOWN:
+			if (blurRadius > 0.0f)
+				blurRadius -= BLUR_RADIUS_STEP;
+			break;
+		default:
+			break;
+		}
 		break;
 	}
 
@@ -72,6 +108,22 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 	return DefWindowProc(hWnd, message, wParam, lParam);
 }
 #endif
+/*!****************************************************************************
+@Function		GetTimeMs
+@Return		double			Milliseconds from an arbitrary origin
+@Description	High resolution wall clock timing the frames
+******************************************************************************/
+double GetTimeMs()
+{
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return (double)now.QuadPart * 1000.0 / (double)frequency.QuadPart;
+}
+
 /*!****************************************************************************
 @Function		TestEGLError
 @Return		bool			true if no EGL error was detected
@@ -319,28 +371,10 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 	// First gets the location of that variable in the shader using its name
 	int i32Location = glGetUniformLocation(uiProgramObject, "myPMVMatrix");
 
-	GLfloat afVertices[VERTEX_LIMIT] = { -RADIUS,  RADIUS, 0.0f,  // Position 0
-		-RADIUS, -RADIUS, 0.0f,		// Position 1
-		RADIUS, -RADIUS, 0.0f,		// Position 2
-		RADIUS,  RADIUS, 0.0f,		// Position 3
-	};
-
-	GLint countVert = 12;
-
-	for (float i = START_TOP; i <= END_TOP; i += INC_ANGLE)
-	{
-		afVertices[countVert++] = RADIUS*cos(i*PI / 180.0f);
-		afVertices[countVert++] = RADIUS + RADIUS*sin(i*PI / 180.0f);
-		afVertices[countVert++] = 0;
-	}
-
-	GLfloat cfVertices[500];
-	for (float i = START_RIGHT; i <= END_RIGHT; i += INC_ANGLE)
-	{
-		afVertices[countVert++] = RADIUS + RADIUS*cos(i*PI / 180.0f);
-		afVertices[countVert++] = RADIUS*sin(i*PI / 180.0f);
-		afVertices[countVert++] = 0;
-	}
+	// Built by the compiler, so there is nothing to tessellate at startup
+	static constexpr HeartTable<INC_ANGLE> heart(RADIUS);
+	const GLfloat* afVertices = heart.vertices;
+	GLint countVert = HeartTable<INC_ANGLE>::FLOATS;
 
 	float scale = SCALE_RESET;
 	int count = COUNT_RESET;
@@ -351,20 +385,12 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 		0.0f,0.0f,scale,0.0f,
 		0.0f,0.0f,0.0f,1.0f
 	};
-	GLuint fboA;
 	GLuint textureA;
 	glEnable(GL_TEXTURE_2D);
-	glGenTextures(1, &textureA);
-	glBindTexture(GL_TEXTURE_2D, textureA);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, 256, 0, GL_RGBA,
-		GL_UNSIGNED_BYTE, NULL);
-
-	glGenFramebuffers(1, &fboA);
-	glBindFramebuffer(GL_FRAMEBUFFER, fboA);
+	textureA = g_textures.texture(g_textures.createRenderTarget(256, 256));
+
+	glGenFramebuffers(1, &g_fboA);
+	glBindFramebuffer(GL_FRAMEBUFFER, g_fboA);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
 		GL_TEXTURE_2D, textureA, 0);
 
@@ -377,15 +403,61 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 	// Load the vertex position
 	glVertexAttribPointer(VERTEX_ARRAY, 3, GL_FLOAT, GL_FALSE, 0, afVertices);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, countVert / 3);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	/*
+		Every frame the heart is drawn into the dynamic resolution target at
+		whatever size the last frames allowed, then scaled up to the window.
+		The resolution follows the GPU time when the driver can measure it,
+		and the CPU time otherwise.
+	*/
+	g_pResolution = new DynamicResolution(WINDOW_HEIGHT, WINDOW_HEIGHT, TARGET_FRAME_MS, MIN_RESOLUTION);
+	if (!g_pResolution->init(&g_textures))
+	{
+		goto cleanup;
+	}
+
+	/*
+		With a blur the upscale goes to a window sized target instead, and
+		the blur chain writes the window from there.
+	*/
+	g_pBlur = new KawaseBlur(WINDOW_HEIGHT, WINDOW_HEIGHT);
+	GLuint postTexture = g_textures.texture(g_textures.createRenderTarget(WINDOW_HEIGHT, WINDOW_HEIGHT));
+	glGenFramebuffers(1, &g_fboPost);
+	glBindFramebuffer(GL_FRAMEBUFFER, g_fboPost);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, postTexture, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (!g_pBlur->init(&g_textures))
+	{
+		goto cleanup;
+	}
 	for (; ;)
 	{
-		//glClear(GL_COLOR_BUFFER_BIT);
+		if (g_bDemoDone) break;
+
+		double dFrameStart = GetTimeMs();
+		g_textures.beginFrame();
+		g_pResolution->begin();
+		glClear(GL_COLOR_BUFFER_BIT);
 		if (!TestEGLError())
 		{
 			goto cleanup;
 		}
+		glUseProgram(uiProgramObject);
+		glVertexAttribPointer(VERTEX_ARRAY, 3, GL_FLOAT, GL_FALSE, 0, afVertices);
+		glDrawArrays(GL_TRIANGLE_FAN, 0, countVert / 3);
 
-
+		g_pResolution->setSharpness(bSharpen ? UPSCALE_SHARPNESS : 0.0f);
+		if (blurRadius > 0.0f)
+		{
+			g_pResolution->end(g_fboPost);
+			g_pBlur->apply(postTexture, blurRadius, 0);
+		}
+		else
+		{
+			g_pResolution->end();
+		}
+		g_pResolution->endTiming();
+		double dWorkMs = GetTimeMs() - dFrameStart;
 
 		EGLint iErr = eglGetError();
 		if (iErr != EGL_SUCCESS)
@@ -403,16 +475,20 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 		{
 			goto cleanup;
 		}
-	}
+
+		// Without GPU timing a GPU bound frame only shows in the wait to swap
+		g_pResolution->update((float)(g_pResolution->gpuTimed() ? dWorkMs : GetTimeMs() - dFrameStart));
 
 #ifndef NO_GDI
-	// Managing the window messages
-	MSG msg;
-	PeekMessage(&msg, hWnd, NULL, NULL, PM_REMOVE);
-	TranslateMessage(&msg);
-	DispatchMessage(&msg);
-	//}
+		// Managing the window messages
+		MSG msg;
+		while (PeekMessage(&msg, hWnd, NULL, NULL, PM_REMOVE))
+		{
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+		}
 #endif
+	}
 
 	// Frees the OpenGL handles for the program and the 2 shaders
 	glDeleteProgram(uiProgramObject);
@@ -420,6 +496,14 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 	glDeleteShader(vertexShader);
 
 cleanup:
+	// Frees the framebuffer and its texture while the context is still current
+	glDeleteFramebuffers(1, &g_fboA);
+	glDeleteFramebuffers(1, &g_fboPost);
+	// The blur and the scaler stop tracking their textures in g_textures first
+	delete g_pBlur;
+	delete g_pResolution;
+	g_textures.clear();
+
 	eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
 	eglTerminate(eglDisplay);
 
@@ -3,9 +3,14 @@
 #include <windows.h>
 #include <TCHAR.h>
 #include <math.h>
+#include <atomic>
+#include <thread>
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 #include "imageloader.h"
+#include "shapetables.h"
+#include "triplebuffer.h"
+#include "transform.h"
 /******************************************************************************
 Defines
 ******************************************************************************/
@@ -21,25 +26,34 @@ Defines
 #define PI 3.14159
 #define RADIUS 0.3
 
-#define VERTEX_LIMIT	1500
-#define START_TOP		0.0f
-#define END_TOP			180.0f
-#define START_RIGHT		-90.0f
-#define END_RIGHT		90.0f
 #define INC_ANGLE		1
 #define SCALE_RESET			1.0f
 #define COUNT_RESET			0
 #define SCALE_AFTER_FRAME	20
 #define SCALE_FACTOR		1.005f
 #define SCALE_LIMIT			1.3f
+// The animation advances at a fixed rate, independent of how fast frames are shown
+#define UPDATE_INTERVAL_MS	16
+// Steps run at most in one go after a stall, such as dragging the window
+#define MAX_CATCH_UP_STEPS	10
 /******************************************************************************
 Global variables
 ******************************************************************************/
 
-// Variable set in the message handler to finish the demo
-bool	g_bDemoDone = false;
+// Variable set in the message handler, or by the render thread on an EGL error, to finish the demo
+std::atomic<bool>	g_bDemoDone(false);
 float angle = -45.0f;
 
+// Everything the render thread needs to draw one frame, written by the update thread
+struct HeartFrame
+{
+	GLfloat pmvMatrix[16];
+};
+
+// Frames handed from the update thread (WinMain) to the render thread
+TripleBuffer<HeartFrame> g_frames;
+std::thread g_renderThread;
+
 /*!****************************************************************************
 @Function		WndProc
 @Input			hWnd		Handle to the window
@@ -61,6 +75,21 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 		return 1;
 	case WM_KEYDOWN:
 	{
+		switch (wParam)
+		{
+		case VK_RIGHT:
+		{
+			angle += 5;
+			break;
+		}
+		case VK_LEFT:
+		{
+			angle -= 5;
+			break;
+		}
+		default:
+			break;
+		}
 		break;
 	}
 
@@ -72,6 +101,22 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 	return DefWindowProc(hWnd, message, wParam, lParam);
 }
 #endif
+/*!****************************************************************************
+@Function		GetTimeMs
+@Return		double			Milliseconds from an arbitrary origin
+@Description	High resolution wall clock pacing the animation steps
+******************************************************************************/
+double GetTimeMs()
+{
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return (double)now.QuadPart * 1000.0 / (double)frequency.QuadPart;
+}
+
 /*!****************************************************************************
 @Function		TestEGLError
 @Return		bool			true if no EGL error was detected
@@ -121,6 +166,64 @@ GLuint LoadShader(char *shaderSrc, GLenum type)
 	return shader;
 }
 
+/*!****************************************************************************
+@Function		RenderThread
+@Input			eglDisplay		Display of the surface
+@Input			eglSurface		Window surface to draw to
+@Input			eglContext		Context, not current on any other thread
+@Input			i32Location		Location of myPMVMatrix in the bound program
+@Input			afVertices		Heart triangle fan
+@Input			countVert		Number of floats in afVertices
+@Description	Draws the latest frame published in g_frames and swaps, until
+				the demo is done.  Only this thread touches GL, so a blocked
+				eglSwapBuffers holds up neither input nor the animation.
+******************************************************************************/
+void RenderThread(EGLDisplay eglDisplay, EGLSurface eglSurface, EGLContext eglContext,
+	int i32Location, const GLfloat* afVertices, GLint countVert)
+{
+	eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext);
+	if (!TestEGLError())
+	{
+		g_bDemoDone = true;
+		return;
+	}
+
+	bool bHasFrame = false;
+	while (!g_bDemoDone)
+	{
+		// Nothing new means the update thread is slower than the display; show the last frame again
+		if (g_frames.acquire())
+			bHasFrame = true;
+
+		glClear(GL_COLOR_BUFFER_BIT);
+		if (bHasFrame)
+		{
+			glUniformMatrix4fv(i32Location, 1, GL_FALSE, g_frames.front().pmvMatrix);
+
+			// Pass the vertex data
+			glEnableVertexAttribArray(VERTEX_ARRAY);
+
+			// Load the vertex position
+			glVertexAttribPointer(VERTEX_ARRAY, 3, GL_FLOAT, GL_FALSE, 0, afVertices);
+
+			glDrawArrays(GL_TRIANGLE_FAN, 0, countVert / 3);
+		}
+
+		/*
+		Swap Buffers.
+		Brings to the native display the current render surface.
+		*/
+		eglSwapBuffers(eglDisplay, eglSurface);
+		if (eglGetError() != EGL_SUCCESS)
+		{
+			g_bDemoDone = true;
+		}
+	}
+
+	// Hand the context back so WinMain can free the GL objects
+	eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
 /*!****************************************************************************
 @Function		WinMain
 @Input			hInstance		Application instance from OS
@@ -319,97 +422,78 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 	// First gets the location of that variable in the shader using its name
 	int i32Location = glGetUniformLocation(uiProgramObject, "myPMVMatrix");
 
-	GLfloat afVertices[VERTEX_LIMIT] = { -RADIUS,  RADIUS, 0.0f,  // Position 0
-		-RADIUS, -RADIUS, 0.0f,		// Position 1
-		RADIUS, -RADIUS, 0.0f,		// Position 2
-		RADIUS,  RADIUS, 0.0f,		// Position 3
-	};
-
-	GLint countVert = 12;
-
-	for (float i = START_TOP; i <= END_TOP; i += INC_ANGLE)
-	{
-		afVertices[countVert++] = RADIUS*cos(i*PI / 180.0f);
-		afVertices[countVert++] = RADIUS + RADIUS*sin(i*PI / 180.0f);
-		afVertices[countVert++] = 0;
-	}
+	// Built by the compiler, so there is nothing to tessellate at startup
+	static constexpr HeartTable<INC_ANGLE> heart(RADIUS);
+	const GLfloat* afVertices = heart.vertices;
+	GLint countVert = HeartTable<INC_ANGLE>::FLOATS;
 
-	GLfloat cfVertices[500];
-	for (float i = START_RIGHT; i <= END_RIGHT; i += INC_ANGLE)
-	{
-		afVertices[countVert++] = RADIUS + RADIUS*cos(i*PI / 180.0f);
-		afVertices[countVert++] = RADIUS*sin(i*PI / 180.0f);
-		afVertices[countVert++] = 0;
-	}
+	/*
+	The render thread takes over the context; this thread keeps the window
+	messages and the animation going at UPDATE_INTERVAL_MS per step, however
+	long the GPU takes to show each frame.
+	*/
+	eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	g_renderThread = std::thread(RenderThread, eglDisplay, eglSurface, eglContext,
+		i32Location, (const GLfloat*)afVertices, countVert);
 
 	float scale = SCALE_RESET;
 	int count = COUNT_RESET;
+	double dNextStep = GetTimeMs();
 	for (; ;)
 	{
 		if (g_bDemoDone == true)
 			break;
 
-		count++;
-		if (count == SCALE_AFTER_FRAME)
+		/*
+		Runs every step that has come due since the last pass.  Sleep rounds
+		up to the system timer tick, about 15.6 ms unless something raised
+		its resolution, so it can't pace the steps by itself.
+		*/
+		double dNow = GetTimeMs();
+		if (dNow - dNextStep > MAX_CATCH_UP_STEPS * UPDATE_INTERVAL_MS)
 		{
-			scale = scale * SCALE_FACTOR;
-			if (scale >= SCALE_LIMIT)
-			{
-				scale = SCALE_RESET;
-			}
-			count = COUNT_RESET;
+			dNextStep = dNow;
 		}
-
-
-		float pfzIdentity[] =
+		bool bStepped = false;
+		for (; dNextStep <= dNow; dNextStep += UPDATE_INTERVAL_MS)
 		{
-			scale * cos(angle*PI / 180.0f), -scale * sin(angle*PI / 180.0f),0.0f,0.0f,
-			scale * sin(angle*PI / 180.0f), scale * cos(angle*PI / 180.0f),0.0f,0.0f,
-			0.0f,0.0f,scale,0.0f,
-			0.0f,0.0f,0.0f,1.0f
-		};
-
-		glClear(GL_COLOR_BUFFER_BIT);
-		if (!TestEGLError())
-		{
-			goto cleanup;
+			count++;
+			if (count == SCALE_AFTER_FRAME)
+			{
+				scale = scale * SCALE_FACTOR;
+				if (scale >= SCALE_LIMIT)
+				{
+					scale = SCALE_RESET;
+				}
+				count = COUNT_RESET;
+			}
+			bStepped = true;
 		}
-		glUniformMatrix4fv(i32Location, 1, GL_FALSE, pfzIdentity);
-
-		// Pass the vertex data
-		glEnableVertexAttribArray(VERTEX_ARRAY);
-
-		// Load the vertex position
-		glVertexAttribPointer(VERTEX_ARRAY, 3, GL_FLOAT, GL_FALSE, 0, afVertices);
 
-		glDrawArrays(GL_TRIANGLE_FAN, 0, countVert / 3);
-
-		EGLint iErr = eglGetError();
-		if (iErr != EGL_SUCCESS)
+		if (bStepped)
 		{
-			goto cleanup;
+			Transform2D transform = { 0.0f, 0.0f, angle, scale };
+			transformMatrix(transform, g_frames.back().pmvMatrix);
+			g_frames.publish();
 		}
 
-		/*
-		Swap Buffers.
-		Brings to the native display the current render surface.
-		*/
-		eglSwapBuffers(eglDisplay, eglSurface);
-		iErr = eglGetError();
-		if (iErr != EGL_SUCCESS)
-		{
-			goto cleanup;
-		}
 #ifndef NO_GDI
 		// Managing the window messages
 		MSG msg;
-		PeekMessage(&msg, hWnd, NULL, NULL, PM_REMOVE);
-		TranslateMessage(&msg);
-		DispatchMessage(&msg);
-		//}
+		while (PeekMessage(&msg, hWnd, NULL, NULL, PM_REMOVE))
+		{
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+		}
 #endif
+		// Wait for the next step; oversleeping is caught up on above
+		double dWaitMs = dNextStep - GetTimeMs();
+		Sleep(dWaitMs > 0.0 ? (DWORD)dWaitMs : 0);
 	}
 
+	g_renderThread.join();
+	eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext);
+
 	// Frees the OpenGL handles for the program and the 2 shaders
 	glDeleteProgram(uiProgramObject);
 	glDeleteShader(fragmentShader);
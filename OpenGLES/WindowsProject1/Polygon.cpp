@@ -5,6 +5,13 @@
 #include <math.h>
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
+#include "shapes.h"
+#include "framearena.h"
+#include "triangulator.h"
+#include "sdffont.h"
+#include "perfhud.h"
+#include "texturemanager.h"
+#include "commandlist.h"
 
 /******************************************************************************
  Defines
@@ -20,6 +27,11 @@
 #define VERTEX_ARRAY	0
 #define PI 3.14159
 #define RADIUS 0.5
+#define MIN_SIDES 3
+#define MAX_SIDES 64
+#define STAR_INNER_RADIUS 0.2
+// Installed face the performance overlay is written in
+#define HUD_FONT_FACE "Arial"
 /******************************************************************************
  Global variables
 ******************************************************************************/
@@ -27,6 +39,29 @@
 // Variable set in the message handler to finish the demo
 bool	g_bDemoDone = false;
 
+// Sides of the regular polygon, changed with the up and down keys
+GLint nPolygon = 7;
+
+// Draws a star of nPolygon points instead, toggled with the space bar
+bool bStar = false;
+
+// Transient data of the current frame, the tessellated polygon
+FrameArena g_frameArena;
+
+// Triangulations of the outlines drawn so far, one per shape and side count
+TessellationCache g_tessellationCache;
+
+// Performance overlay and its font, toggled with F1; NULL if the font failed
+SdfFont* g_pHudFont = NULL;
+PerfHud* g_pHud = NULL;
+bool bHud = true;
+
+// Accounts the overlay's textures, whose size the overlay shows
+TextureManager* g_pTextures = NULL;
+
+// Issues the polygon's draw and counts its draws and binds for the overlay
+GLBackend g_backend;
+
 /*!****************************************************************************
  @Function		WndProc
  @Input			hWnd		Handle to the window
@@ -46,6 +81,29 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 			g_bDemoDone = true;
 			PostQuitMessage(0);
 			return 1;
+		case WM_KEYDOWN:
+		{
+			switch (wParam)
+			{
+			case VK_UP:
+				if (nPolygon < MAX_SIDES)
+					nPolygon++;
+				break;
+			case VK_DOWN:
+				if (nPolygon > MIN_SIDES)
+					nPolygon--;
+				break;
+			case VK_SPACE:
+				bStar = !bStar;
+				break;
+			case VK_F1:
+				bHud = !bHud;
+				break;
+			default:
+				break;
+			}
+			break;
+		}
 
 		default:
 			break;
@@ -55,6 +113,22 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 	return DefWindowProc(hWnd, message, wParam, lParam);
 }
 #endif
+/*!****************************************************************************
+ @Function		GetTimeMs
+ @Return		double			Milliseconds from an arbitrary origin
+ @Description	High resolution wall clock timing the frames for the overlay
+******************************************************************************/
+double GetTimeMs()
+{
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return (double)now.QuadPart * 1000.0 / (double)frequency.QuadPart;
+}
+
 /*!****************************************************************************
  @Function		TestEGLError
  @Return		bool			true if no EGL error was detected
@@ -286,45 +360,104 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, TCHAR *lpCmdLin
 	// The colours are passed per channel (red,green,blue,alpha) as float values from 0.0 to 1.0
 	glClearColor(0.6f, 0.8f, 1.0f, 1.0f);
 		
-	// Interleaved vertex data
-	GLfloat afVertices[100];
-	GLint count=0;
-	GLint nPolygon =7;// Sides of regular polygon
-	GLfloat side=2*RADIUS*sin(PI/nPolygon);
-
-	afVertices[count++]=-RADIUS*sin(PI/nPolygon);
-	afVertices[count++]=-RADIUS*cos(PI/nPolygon);
-	for(float i=0; i<=360-(360/nPolygon); i+=360/nPolygon)
-	{
-		afVertices[count] = afVertices[count++-2] + side*cos(i*PI/180);
-		afVertices[count] = afVertices[count++-2] + side*sin(i*PI/180);
-	}
 	//Set a viewport
 	 glViewport(0, 0, WINDOW_HEIGHT, WINDOW_HEIGHT);
+
+	/*
+		The overlay's font is rasterized once at start up.  Without the
+		face the demo runs as before, just without the overlay.
+	*/
+	g_pTextures = new TextureManager();
+	g_pHudFont = new SdfFont();
+	if (g_pHudFont->build(NULL, HUD_FONT_FACE))
+	{
+		g_pHudFont->upload();
+		for (int page = 0; page < g_pHudFont->atlas().pageCount(); page++)
+		{
+			const TextureAtlas& atlas = g_pHudFont->atlas();
+			g_pTextures->track(atlas.pageTexture(page), atlas.page(page)->width,
+				atlas.page(page)->height, atlas.channelCount() == 1 ? 1 : 4);
+		}
+		g_pHud = new PerfHud();
+		if (!g_pHud->init(g_pHudFont, g_pTextures))
+		{
+			delete g_pHud;
+			g_pHud = NULL;
+		}
+	}
+	double dFrameStart = GetTimeMs();
 	// Draws a triangle for 800 frames
 	for(int i = 0; i < 800000; ++i)
 	{
 		// Check if the message handler finished the demo
 		if (g_bDemoDone) break;
 
+		/*
+			Tessellate the outline for this frame into the frame arena, which
+			recycles the memory of the frame before last, so changing the
+			number of sides needs no fixed size array and no heap allocation.
+			The star is concave, so a fan can't draw it; the outline goes
+			through the tessellation cache, which only triangulates a shape
+			the first time it is seen.
+		*/
+		g_frameArena.beginFrame();
+		g_pTextures->beginFrame();
+		GLint countFloats = bStar ? starFloatCount(nPolygon) : polygonFloatCount(nPolygon);
+		GLfloat* afVertices = g_frameArena.allocate<GLfloat>(countFloats);
+		if (bStar)
+		{
+			tessellateStar(afVertices, countFloats, nPolygon, RADIUS, STAR_INNER_RADIUS);
+		}
+		else
+		{
+			tessellatePolygon(afVertices, countFloats, nPolygon, RADIUS);
+		}
+		int aiContours[] = { 0, countFloats / 2 };
+		const Tessellation& tessellation = g_tessellationCache.get(afVertices, aiContours, 1);
+
 		glClear(GL_COLOR_BUFFER_BIT);
 		if (!TestEGLError())
 		{
 			goto cleanup;
 		}
 		/*
-			Enable the custom vertex attribute at index VERTEX_ARRAY.
+			The overlay binds its own program and buffers, so the backend
+			forgets what it had bound, which also restarts its counts for
+			this frame.  Client-side vertex and index pointers need both
+			buffer bindings at 0.
+		*/
+		g_backend.invalidate();
+		g_backend.useProgram(uiProgramObject);
+		g_backend.bindBuffer(GL_ARRAY_BUFFER, 0);
+		g_backend.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		/*
+			Enable the custom vertex attribute at index VERTEX_ARRAY and set
+			the vertex data to it.
 			We previously binded that index to the variable in our shader "vec4 MyVertex;"
 		*/
-		glEnableVertexAttribArray(VERTEX_ARRAY);
+		g_backend.vertexArray(VERTEX_ARRAY, 2, GL_FLOAT, false, 0, &tessellation.vertices[0]);
 
-		// Sets the vertex data to this attribute index
-		glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 0, afVertices);
+		/*
+			Draws the indexed triangle list from the pointers previously given.
+		*/
+		g_backend.drawElements(GL_TRIANGLES, (int)tessellation.indices.size(), GL_UNSIGNED_SHORT, &tessellation.indices[0]);
 
 		/*
-			Draws a non-indexed triangle array from the pointers previously given.
+			Feed the overlay the time since the previous frame started,
+			which includes the wait in eglSwapBuffers, and what this frame
+			drew.  It only redraws its texture a few times a second.
 		*/
-		glDrawArrays(GL_TRIANGLE_FAN, 0, nPolygon);
+		if (g_pHud)
+		{
+			double dNow = GetTimeMs();
+			FrameStats stats = { (float)(dNow - dFrameStart), g_backend.drawCount(), (int)tessellation.indices.size() / 3,
+				g_pTextures->currentBytes(), g_backend.bindCount() };
+			dFrameStart = dNow;
+			g_pHud->frame(stats);
+			if (bHud)
+				g_pHud->draw(8, WINDOW_HEIGHT - g_pHud->height() - 8, WINDOW_HEIGHT, WINDOW_HEIGHT);
+		}
 		EGLint iErr = eglGetError();
 		if (iErr != EGL_SUCCESS)
 		{
@@ -356,6 +489,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, TCHAR *lpCmdLin
 	glDeleteShader(vertexShader);
 
 cleanup:
+	delete g_pHud;
+	delete g_pTextures;
+	delete g_pHudFont;
 	eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
 	eglTerminate(eglDisplay);
 
@@ -6,6 +6,9 @@
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 #include "imageloader.h"
+#include "textureloader.h"
+#include "texturemanager.h"
+#include "assetpack.h"
 /******************************************************************************
 Defines
 ******************************************************************************/
@@ -143,29 +146,9 @@ GLuint LoadShader(char *shaderSrc, GLenum type)
 	return shader;
 }
 
-//Makes the image into a texture, and returns the id of the texture
-GLuint loadTexture(Image* image) {
-	GLuint textureId;
-	glGenTextures(1, &textureId); //Make room for our texture
-	glBindTexture(GL_TEXTURE_2D, textureId); //Tell OpenGL which texture to edit
-											 //Map the image to the texture
-	glTexImage2D(GL_TEXTURE_2D,                //Always GL_TEXTURE_2D
-		0,                            //0 for now
-		GL_RGB,                       //Format OpenGL uses for image
-		image->width, image->height,  //Width and height
-		0,                            //The border of the image
-		GL_RGB, //GL_RGB, because pixels are stored in RGB format
-		GL_UNSIGNED_BYTE, //GL_UNSIGNED_BYTE, because pixels are stored
-						  //as unsigned numbers
-		image->pixels);               //The actual pixel data
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	return textureId; //Returns the id of the texture
-}
-
-GLuint _textureId; //The id of the texture
+AssetPack g_pack; //Converted assets, mapped once at startup
+TextureManager g_textures; //Owns the textures of the demo
+TextureHandle g_texture = INVALID_TEXTURE; //The texture of the quad, bound through g_textures every frame
 
 				   /*!****************************************************************************
 				   @Function		WinMain
@@ -378,11 +361,23 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, TCHAR *lpCmdLin
 	//	if ( ((i*j)/8) % 2 ) col = (GLuint) (255L<<24) + (255L<<16) + (0L<<8) + (255L);
 	//	pTexData[j*TEX_SIZE+i] = col;
 	//}
-	Image* image = loadBMP("blackbuck.bmp");
-	_textureId = loadTexture(image);
-	delete image;
+	// Prefer the pack written by "AssetTools pack -mips -srgb assets.pak blackbuck.bmp",
+	// then the ETC1 copy written by "AssetTools ktx -mips -srgb blackbuck.bmp blackbuck.ktx"
+	if (g_pack.open("assets.pak"))
+	{
+		g_texture = g_textures.load(g_pack, "blackbuck.bmp");
+	}
+	if (g_texture == INVALID_TEXTURE)
+	{
+		g_texture = g_textures.load("blackbuck.ktx");
+	}
+	if (g_texture == INVALID_TEXTURE)
+	{
+		// The photo is minified on screen; average its mips in linear light
+		g_texture = g_textures.load("blackbuck.bmp", PIXEL_RGB888, MIPMAP_BOX, true);
+	}
 	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, _textureId);
+	g_textures.bind(g_texture);
 	//glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image->width, image->height, 0, GL_RGB, GL_UNSIGNED_BYTE, image->pixels);
 
 	//GLfloat afVertices[] = {-0.4f,-0.4f,0.0f, // Pos
@@ -410,6 +405,12 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, TCHAR *lpCmdLin
 		0.5f,  0.5f, 0.0f,  // Position 3
 		1.0f,  1.0f         // TexCoord 3
 	};
+	// A compressed KTX stored top-down can't be flipped on load; flip t instead
+	if (!g_textures.originBottom(g_texture))
+	{
+		for (int i = 4; i < 20; i += 5)
+			afVertices[i] = 1.0f - afVertices[i];
+	}
 
 	// VBO handle
 	//GLuint m_ui32Vbo;
@@ -524,6 +525,14 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, TCHAR *lpCmdLin
 		glVertexAttribPointer(TEXCOORD_ARRAY, 2, GL_FLOAT,
 			GL_FALSE, 5 * sizeof(GLfloat), &afVertices[3]);
 
+		/*
+			Bind through the manager every frame, which marks the texture
+			used (reloading it if it was evicted) after beginFrame() let the
+			manager evict what earlier frames used and this one doesn't.
+		*/
+		g_textures.beginFrame();
+		g_textures.bind(g_texture);
+
 		glDrawArrays(GL_TRIANGLE_FAN, 0, 4/*nPolygon*/);
 		EGLint iErr = eglGetError();
 		if (iErr != EGL_SUCCESS)
@@ -559,6 +568,10 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, TCHAR *lpCmdLin
 	glDeleteShader(vertexShader);
 
 cleanup:
+	// Frees the textures while the context is still current
+	g_textures.clear();
+	g_pack.close();
+
 	eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
 	eglTerminate(eglDisplay);
 
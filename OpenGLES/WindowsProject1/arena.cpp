@@ -0,0 +1,62 @@
+#include "stdafx.h"
+#include <string.h>
+#include "arena.h"
+
+LinearArena::LinearArena(size_t blockSize_) :
+	blockSize(blockSize_), current(0), offset(0), usedBytes(0) {
+}
+
+LinearArena::~LinearArena() {
+	for (size_t i = 0; i < blocks.size(); i++)
+		delete[] blocks[i].memory;
+}
+
+void* LinearArena::allocate(size_t bytes, size_t alignment) {
+	while (current < blocks.size()) {
+		size_t base = (size_t)blocks[current].memory;
+		size_t start = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+		if (start + bytes <= blocks[current].size) {
+			offset = start + bytes;
+			return blocks[current].memory + start;
+		}
+		//Move on to the next block; the rest of this one is wasted until reset()
+		if (current + 1 == blocks.size())
+			break;
+		usedBytes += offset;
+		offset = 0;
+		current++;
+	}
+
+	//Out of blocks: add one big enough for the request
+	Block block;
+	block.size = bytes + alignment > blockSize ? bytes + alignment : blockSize;
+	block.memory = new char[block.size];
+	if (!blocks.empty()) {
+		usedBytes += offset;
+		offset = 0;
+		current = blocks.size();
+	}
+	blocks.push_back(block);
+	size_t base = (size_t)block.memory;
+	size_t start = ((base + alignment - 1) & ~(alignment - 1)) - base;
+	offset = start + bytes;
+	return block.memory + start;
+}
+
+void LinearArena::reset() {
+	current = 0;
+	offset = 0;
+	usedBytes = 0;
+}
+
+void LinearArena::scribble(unsigned char value) {
+	for (size_t i = 0; i < blocks.size(); i++)
+		memset(blocks[i].memory, value, blocks[i].size);
+}
+
+size_t LinearArena::capacity() const {
+	size_t total = 0;
+	for (size_t i = 0; i < blocks.size(); i++)
+		total += blocks[i].size;
+	return total;
+}
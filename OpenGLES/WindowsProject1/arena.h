@@ -0,0 +1,59 @@
+#ifndef ARENA_H_INCLUDED
+#define ARENA_H_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+
+/* Bump-pointer allocator over a list of blocks.
+ *
+ * allocate() moves a pointer through the current block and starts the next
+ * one when it is full; nothing is freed on its own.  reset() rewinds to the
+ * first block and keeps every block, so once an arena has grown to what a
+ * frame needs, refilling it costs no heap allocations.  Requests larger
+ * than the block size get a block of their own.  Not thread safe: give each
+ * thread its own arena.
+ */
+class LinearArena {
+	public:
+		explicit LinearArena(size_t blockSize = 64 * 1024);
+		~LinearArena();
+
+		//Returns bytes of uninitialized memory, valid until reset()
+		void* allocate(size_t bytes, size_t alignment = 16);
+
+		//Room for count objects of T; constructors are not run
+		template<class T>
+		T* allocate(size_t count = 1) {
+			return (T*)allocate(sizeof(T) * count, alignof(T) > 16 ? alignof(T) : 16);
+		}
+
+		//Forgets all allocations, keeping the blocks for reuse
+		void reset();
+
+		size_t used() const { return usedBytes + offset; }
+		size_t capacity() const;
+
+		//Blocks allocated from the heap over the arena's life
+		int blockCount() const { return (int)blocks.size(); }
+
+		//Overwrites every block with value, so reads of memory from before
+		//the last reset() stand out.  Costs a pass over the whole capacity.
+		void scribble(unsigned char value);
+
+	private:
+		struct Block {
+			char* memory;
+			size_t size;
+		};
+
+		LinearArena(const LinearArena&);
+		LinearArena& operator=(const LinearArena&);
+
+		std::vector<Block> blocks;
+		size_t blockSize;
+		size_t current;		//Index in blocks of the block being filled
+		size_t offset;		//Bytes used in the current block
+		size_t usedBytes;	//Bytes used in the blocks before current
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "stdafx.h"
+#include <string.h>
+#include "assetpack.h"
+
+namespace {
+	char normalize(char c) {
+		if (c == '\\')
+			return '/';
+		return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+	}
+
+	bool sameName(const char* a, const char* b) {
+		for (; *a && *b; a++, b++) {
+			if (normalize(*a) != normalize(*b))
+				return false;
+		}
+		return *a == *b;
+	}
+}
+
+unsigned long long packHash(const char* name) {
+	unsigned long long hash = 14695981039346656037ULL;
+	for (; *name; name++) {
+		hash ^= (unsigned char)normalize(*name);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+AssetPack::AssetPack() :
+	file(INVALID_HANDLE_VALUE), mapping(NULL), base(NULL), size(0), buckets(NULL), entries(NULL) {
+}
+
+AssetPack::~AssetPack() {
+	close();
+}
+
+bool AssetPack::open(const char* filename) {
+	close();
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(PackHeader) ||
+		fileSize.QuadPart > 0xffffffffLL) {
+		close();
+		return false;
+	}
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping)
+		base = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!base) {
+		close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+
+	//Check the index once so lookups can trust it
+	const PackHeader* header = (const PackHeader*)base;
+	size_t indexEnd = sizeof(PackHeader) + (PACK_BUCKETS + 1) * sizeof(unsigned int) +
+		(size_t)header->entryCount * sizeof(PackEntry);
+	if (header->magic != PACK_MAGIC || header->version != PACK_VERSION ||
+		header->fileSize != size || indexEnd > size) {
+		close();
+		return false;
+	}
+	buckets = (const unsigned int*)(base + sizeof(PackHeader));
+	entries = (const PackEntry*)(buckets + PACK_BUCKETS + 1);
+	for (int i = 0; i < PACK_BUCKETS; i++) {
+		if (buckets[i] > buckets[i + 1] || buckets[i + 1] > header->entryCount) {
+			close();
+			return false;
+		}
+	}
+	for (unsigned int i = 0; i < header->entryCount; i++) {
+		const PackEntry& entry = entries[i];
+		if (entry.nameOffset >= size || memchr(base + entry.nameOffset, 0, size - entry.nameOffset) == NULL ||
+			entry.offset > size || entry.size > size - entry.offset) {
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void AssetPack::close() {
+	if (base)
+		UnmapViewOfFile(base);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+	base = NULL;
+	size = 0;
+	buckets = NULL;
+	entries = NULL;
+}
+
+bool AssetPack::find(const char* name, PackAsset* asset) const {
+	if (!base)
+		return false;
+	unsigned long long hash = packHash(name);
+	unsigned int hashLow = (unsigned int)hash;
+	unsigned int hashHigh = (unsigned int)(hash >> 32);
+	int bucket = hashHigh >> 24;
+	for (unsigned int i = buckets[bucket]; i < buckets[bucket + 1]; i++) {
+		const PackEntry& entry = entries[i];
+		if (entry.hashLow != hashLow || entry.hashHigh != hashHigh || !sameName(base + entry.nameOffset, name))
+			continue;
+		asset->type = (PackAssetType)entry.type;
+		asset->data = base + entry.offset;
+		asset->size = entry.size;
+		return true;
+	}
+	return false;
+}
+
+const char* AssetPack::shaderSource(const char* name) const {
+	PackAsset asset;
+	if (!find(name, &asset) || asset.type != PACK_SHADER_SOURCE || asset.size == 0 ||
+		asset.data[asset.size - 1] != '\0')
+		return NULL;
+	return asset.data;
+}
+
+bool AssetPack::programBinary(const char* name, unsigned int* format,
+							  const void** binary, int* length) const {
+	PackAsset asset;
+	if (!find(name, &asset) || asset.type != PACK_SHADER_BINARY || asset.size <= 4)
+		return false;
+	memcpy(format, asset.data, 4);
+	*binary = asset.data + 4;
+	*length = (int)(asset.size - 4);
+	return true;
+}
+
+int AssetPack::assetCount() const {
+	return base ? (int)((const PackHeader*)base)->entryCount : 0;
+}
@@ -0,0 +1,100 @@
+#ifndef ASSET_PACK_H_INCLUDED
+#define ASSET_PACK_H_INCLUDED
+
+#include <stddef.h>
+#include <windows.h>
+
+/* A pack file holds every asset of a demo in one file that is mapped into
+ * memory once at startup.  Textures are stored as KTX payloads already in
+ * the layout glTexImage2D/glCompressedTexImage2D wants (converted, mipped
+ * or ETC1 compressed by "AssetTools pack"), so loading one is a lookup and
+ * an upload straight out of the mapping, with no file system calls.
+ *
+ * Layout, all integers little-endian:
+ *
+ *   PackHeader
+ *   unsigned int buckets[257]	first entry whose hash starts with byte b
+ *   PackEntry entries[]		sorted by hash
+ *   names						NUL terminated, referenced by the entries
+ *   payloads					each aligned to PACK_ALIGNMENT bytes
+ *
+ * A lookup hashes the name, jumps to the bucket of the top hash byte and
+ * scans the few entries in it, so it costs the same for any pack size.
+ * Names are compared too, so a hash collision can't return the wrong asset.
+ */
+
+#define PACK_MAGIC		0x4b415047	//"GPAK"
+#define PACK_VERSION	1
+#define PACK_BUCKETS	256
+#define PACK_ALIGNMENT	16
+
+//What a payload holds
+enum PackAssetType {
+	PACK_RAW,				//File bytes as they were
+	PACK_TEXTURE_KTX,		//A KTX file, see ktx.h
+	PACK_SHADER_SOURCE,		//GLSL text, NUL terminated
+	PACK_SHADER_BINARY		//A GLenum binary format followed by a program binary
+};
+
+struct PackHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int entryCount;
+	unsigned int fileSize;
+};
+
+struct PackEntry {
+	unsigned int hashLow;
+	unsigned int hashHigh;	//Top byte selects the bucket
+	unsigned int nameOffset;
+	unsigned int type;
+	unsigned int offset;
+	unsigned int size;
+};
+
+//An asset found in a pack; data points into the mapping
+struct PackAsset {
+	PackAssetType type;
+	const char* data;
+	size_t size;
+};
+
+//64-bit FNV-1a of the name with '\\' as '/' and ASCII letters lowercased,
+//so "Data\\Blackbuck.bmp" and "data/blackbuck.bmp" are the same asset
+unsigned long long packHash(const char* name);
+
+//A pack file mapped read-only into memory
+class AssetPack {
+	public:
+		AssetPack();
+		~AssetPack();
+
+		//Maps the file and checks its index; returns false if it is missing
+		//or malformed
+		bool open(const char* filename);
+		void close();
+		bool isOpen() const { return base != NULL; }
+
+		//Finds an asset by name; the data stays valid until close()
+		bool find(const char* name, PackAsset* asset) const;
+
+		//The NUL terminated source of a PACK_SHADER_SOURCE asset, or NULL
+		const char* shaderSource(const char* name) const;
+
+		//Splits a PACK_SHADER_BINARY asset into its GLenum format and the
+		//binary for loadProgramBinary; returns false if there is none
+		bool programBinary(const char* name, unsigned int* format,
+						   const void** binary, int* length) const;
+
+		int assetCount() const;
+
+	private:
+		HANDLE file;
+		HANDLE mapping;
+		const char* base;
+		size_t size;
+		const unsigned int* buckets;
+		const PackEntry* entries;
+};
+
+#endif
@@ -0,0 +1,202 @@
+#include "stdafx.h"
+#include <string.h>
+#include <algorithm>
+#include "atlas.h"
+#include "textureloader.h"
+
+using namespace std;
+
+namespace {
+	int alignUp(int value, int alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	//Orders image indices tallest first, widest on ties
+	struct TallerFirst {
+		const vector<const Image*>* images;
+		bool operator()(int a, int b) const {
+			const Image* ia = (*images)[a];
+			const Image* ib = (*images)[b];
+			if (ia->height != ib->height)
+				return ia->height > ib->height;
+			return ia->width > ib->width;
+		}
+	};
+}
+
+TextureAtlas::TextureAtlas(int pageWidth_, int pageHeight_,
+						   int padding_, int gutter_, int alignment_, int channels_) :
+	pageWidth(pageWidth_), pageHeight(pageHeight_), padding(padding_),
+	gutter(gutter_), alignment(alignment_ > 0 ? alignment_ : 1), channels(channels_ == 1 ? 1 : 3) {
+}
+
+TextureAtlas::~TextureAtlas() {
+	for (size_t i = 0; i < pages.size(); i++)
+		delete pages[i];
+	if (!textures.empty())
+		glDeleteTextures((GLsizei)textures.size(), &textures[0]);
+}
+
+int TextureAtlas::add(const Image* image) {
+	AtlasRegion region = { -1, 0, 0, image->width, image->height, 0, 0, 0, 0 };
+	images.push_back(image);
+	regions.push_back(region);
+	return (int)regions.size() - 1;
+}
+
+//Returns the skyline node a width x height slot should start at, or -1
+int TextureAtlas::findPosition(const vector<SkylineNode>& skyline,
+							   int width, int height, int* bestX, int* bestY) const {
+	int bestIndex = -1;
+	int bestTop = pageHeight + 1;
+	int bestWidth = pageWidth + 1;
+	for (size_t i = 0; i < skyline.size(); i++) {
+		int x = skyline[i].x;
+		if (x + width > pageWidth)
+			break;
+
+		//The slot rests on the highest node it spans
+		int y = 0;
+		int remaining = width;
+		for (size_t j = i; remaining > 0; j++) {
+			y = max(y, skyline[j].y);
+			remaining -= skyline[j].width;
+		}
+		if (y + height > pageHeight)
+			continue;
+
+		if (y + height < bestTop ||
+			(y + height == bestTop && skyline[i].width < bestWidth)) {
+			bestIndex = (int)i;
+			bestTop = y + height;
+			bestWidth = skyline[i].width;
+			*bestX = x;
+			*bestY = y;
+		}
+	}
+	return bestIndex;
+}
+
+void TextureAtlas::addSkylineLevel(vector<SkylineNode>& skyline,
+								   int x, int y, int width, int height) {
+	size_t index = 0;
+	while (skyline[index].x != x)
+		index++;
+
+	SkylineNode node = { x, y + height, width };
+	skyline.insert(skyline.begin() + index, node);
+
+	//Trim the nodes now covered by the new one
+	for (size_t i = index + 1; i < skyline.size(); ) {
+		int shrink = node.x + node.width - skyline[i].x;
+		if (shrink <= 0)
+			break;
+		skyline[i].x += shrink;
+		skyline[i].width -= shrink;
+		if (skyline[i].width > 0)
+			break;
+		skyline.erase(skyline.begin() + i);
+	}
+
+	//Merge neighbours of equal height
+	for (size_t i = 0; i + 1 < skyline.size(); ) {
+		if (skyline[i].y == skyline[i + 1].y) {
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+//Copies the image into its page, repeating the edge texels into the gutter
+void TextureAtlas::blit(const Image* image, const AtlasRegion& region) {
+	Image* target = pages[region.page];
+	for (int y = -gutter; y < image->height + gutter; y++) {
+		int sy = min(max(y, 0), image->height - 1);
+		const char* src = image->pixels + channels * image->width * sy;
+		char* dst = target->pixels + channels * (target->width * (region.y + y) + region.x);
+		if (gutter == 0) {
+			memcpy(dst, src, channels * image->width);
+			continue;
+		}
+		for (int x = -gutter; x < image->width + gutter; x++) {
+			int sx = min(max(x, 0), image->width - 1);
+			memcpy(dst + channels * x, src + channels * sx, channels);
+		}
+	}
+}
+
+bool TextureAtlas::build() {
+	vector<int> order;
+	for (size_t i = 0; i < regions.size(); i++) {
+		if (regions[i].page < 0)
+			order.push_back((int)i);
+	}
+	TallerFirst tallerFirst = { &images };
+	sort(order.begin(), order.end(), tallerFirst);
+
+	for (size_t n = 0; n < order.size(); n++) {
+		const Image* image = images[order[n]];
+		AtlasRegion& region = regions[order[n]];
+		int slotWidth = alignUp(image->width + 2 * gutter + padding, alignment);
+		int slotHeight = alignUp(image->height + 2 * gutter + padding, alignment);
+		if (slotWidth > pageWidth || slotHeight > pageHeight)
+			return false;
+
+		int x = 0;
+		int y = 0;
+		int page = 0;
+		for (; page < (int)pages.size(); page++) {
+			if (findPosition(skylines[page], slotWidth, slotHeight, &x, &y) >= 0)
+				break;
+		}
+		if (page == (int)pages.size()) {
+			char* pixels = new char[pageWidth * pageHeight * channels];
+			memset(pixels, 0, pageWidth * pageHeight * channels);
+			pages.push_back(new Image(pixels, pageWidth, pageHeight));
+			skylines.push_back(vector<SkylineNode>(1));
+			SkylineNode& root = skylines.back()[0];
+			root.x = 0;
+			root.y = 0;
+			root.width = pageWidth;
+			findPosition(skylines[page], slotWidth, slotHeight, &x, &y);
+		}
+		addSkylineLevel(skylines[page], x, y, slotWidth, slotHeight);
+
+		region.page = page;
+		region.x = x + gutter;
+		region.y = y + gutter;
+		region.u0 = (float)region.x / pageWidth;
+		region.v0 = (float)region.y / pageHeight;
+		region.u1 = (float)(region.x + region.width) / pageWidth;
+		region.v1 = (float)(region.y + region.height) / pageHeight;
+		blit(image, region);
+	}
+	//Packed images are not needed any more
+	images.assign(images.size(), (const Image*)NULL);
+	return true;
+}
+
+void TextureAtlas::upload() {
+	if (!textures.empty())
+		glDeleteTextures((GLsizei)textures.size(), &textures[0]);
+	textures.resize(pages.size());
+	for (size_t i = 0; i < pages.size(); i++) {
+		if (channels == 3) {
+			textures[i] = loadTexture(pages[i]);
+			continue;
+		}
+		glGenTextures(1, &textures[i]);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, pageWidth, pageHeight, 0,
+			GL_LUMINANCE, GL_UNSIGNED_BYTE, pages[i]->pixels);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+}
@@ -0,0 +1,76 @@
+#ifndef ATLAS_H_INCLUDED
+#define ATLAS_H_INCLUDED
+
+#include <vector>
+#include <GLES2/gl2.h>
+#include "imageloader.h"
+
+//Where one packed image ended up
+struct AtlasRegion {
+	int page;
+	int x, y, width, height;	//Texels of the image itself, gutters excluded
+	float u0, v0, u1, v1;		//Texture coordinates of the same rectangle
+};
+
+/* Packs many small images into a few shared pages with a skyline
+ * (bottom-left) packer, so they can be drawn from one texture per page.
+ *
+ * Every image is surrounded by `gutter` texels that repeat its edge, so
+ * bilinear filtering never picks up a neighbour, and then `padding` empty
+ * texels.  Placements are aligned to `alignment` texels; with an alignment
+ * of 2^n the first n mip levels still keep every image on its own texels.
+ *
+ * Pages are RGB like Image, or with `channels` 1 a single byte per texel
+ * uploaded as GL_LUMINANCE; the images added must then have one byte per
+ * texel too.
+ */
+class TextureAtlas {
+	public:
+		TextureAtlas(int pageWidth, int pageHeight,
+					 int padding = 1, int gutter = 2, int alignment = 4, int channels = 3);
+		~TextureAtlas();
+
+		//Queues an image for packing and returns its region index.  The atlas
+		//does not own the image, which must stay alive until build().
+		int add(const Image* image);
+
+		//Packs all queued images, tallest first, and copies them into the
+		//pages.  Returns false if an image does not fit on an empty page.
+		bool build();
+
+		//Creates one GL texture per page; the CPU copies are kept
+		void upload();
+
+		const AtlasRegion& region(int index) const { return regions[index]; }
+		int regionCount() const { return (int)regions.size(); }
+		int pageCount() const { return (int)pages.size(); }
+		const Image* page(int index) const { return pages[index]; }
+		GLuint pageTexture(int index) const { return textures[index]; }
+		int channelCount() const { return channels; }
+
+	private:
+		struct SkylineNode {
+			int x, y, width;
+		};
+
+		int findPosition(const std::vector<SkylineNode>& skyline,
+						 int width, int height, int* bestX, int* bestY) const;
+		void addSkylineLevel(std::vector<SkylineNode>& skyline,
+							 int x, int y, int width, int height);
+		void blit(const Image* image, const AtlasRegion& region);
+
+		int pageWidth;
+		int pageHeight;
+		int padding;
+		int gutter;
+		int alignment;
+		int channels;
+
+		std::vector<const Image*> images;
+		std::vector<AtlasRegion> regions;
+		std::vector<Image*> pages;
+		std::vector<std::vector<SkylineNode> > skylines;
+		std::vector<GLuint> textures;
+};
+
+#endif
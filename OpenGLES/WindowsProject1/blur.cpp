@@ -0,0 +1,330 @@
+#include "stdafx.h"
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include "blur.h"
+#include "glprogram.h"
+
+using namespace std;
+
+// Index to bind the attributes to vertex shaders
+#define VERTEX_ARRAY	0
+
+// Radius of one down and up level at offset 1, in source pixels; every
+// further level doubles it (three sigmas, measured from the edge response)
+#define KAWASE_BASE_RADIUS	9.0f
+// Spread of the taps between level counts; narrower stops blurring evenly
+#define KAWASE_MIN_OFFSET	0.7f
+// Widest Gaussian a generated program covers
+#define MAX_GAUSSIAN_RADIUS	128
+
+namespace {
+	const GLfloat QUAD[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+
+	//Centre plus the four diagonals one step away, the centre counted four
+	//times.  myStep is the spread in source texture coordinates.
+	const char* pszDownVertShader = "\
+		attribute highp vec2	myVertex;\
+		uniform mediump vec2	myStep;\
+		varying mediump vec2	myCentre;\
+		varying mediump vec4	myDiagonals0;\
+		varying mediump vec4	myDiagonals1;\
+		void main(void)\
+		{\
+			gl_Position = vec4(myVertex * 2.0 - 1.0, 0.0, 1.0);\
+			myCentre = myVertex;\
+			myDiagonals0 = vec4(myVertex - myStep, myVertex + myStep);\
+			myDiagonals1 = vec4(myVertex + vec2(myStep.x, -myStep.y), myVertex - vec2(myStep.x, -myStep.y));\
+		}";
+	const char* pszDownFragShader = "\
+		uniform sampler2D sampler2d;\
+		varying mediump vec2	myCentre;\
+		varying mediump vec4	myDiagonals0;\
+		varying mediump vec4	myDiagonals1;\
+		void main (void)\
+		{\
+			mediump vec3 sum = texture2D(sampler2d, myCentre).rgb * 4.0;\
+			sum += texture2D(sampler2d, myDiagonals0.xy).rgb;\
+			sum += texture2D(sampler2d, myDiagonals0.zw).rgb;\
+			sum += texture2D(sampler2d, myDiagonals1.xy).rgb;\
+			sum += texture2D(sampler2d, myDiagonals1.zw).rgb;\
+			gl_FragColor = vec4(sum * 0.125, 1.0);\
+		}";
+
+	//The four axes two steps away and the four diagonals one step away,
+	//weighted twice
+	const char* pszUpVertShader = "\
+		attribute highp vec2	myVertex;\
+		uniform mediump vec2	myStep;\
+		varying mediump vec4	myAxes0;\
+		varying mediump vec4	myAxes1;\
+		varying mediump vec4	myDiagonals0;\
+		varying mediump vec4	myDiagonals1;\
+		void main(void)\
+		{\
+			gl_Position = vec4(myVertex * 2.0 - 1.0, 0.0, 1.0);\
+			mediump vec2 x = vec2(2.0 * myStep.x, 0.0);\
+			mediump vec2 y = vec2(0.0, 2.0 * myStep.y);\
+			myAxes0 = vec4(myVertex - x, myVertex + x);\
+			myAxes1 = vec4(myVertex - y, myVertex + y);\
+			myDiagonals0 = vec4(myVertex - myStep, myVertex + myStep);\
+			myDiagonals1 = vec4(myVertex + vec2(myStep.x, -myStep.y), myVertex - vec2(myStep.x, -myStep.y));\
+		}";
+	const char* pszUpFragShader = "\
+		uniform sampler2D sampler2d;\
+		varying mediump vec4	myAxes0;\
+		varying mediump vec4	myAxes1;\
+		varying mediump vec4	myDiagonals0;\
+		varying mediump vec4	myDiagonals1;\
+		void main (void)\
+		{\
+			mediump vec3 sum = texture2D(sampler2d, myAxes0.xy).rgb;\
+			sum += texture2D(sampler2d, myAxes0.zw).rgb;\
+			sum += texture2D(sampler2d, myAxes1.xy).rgb;\
+			sum += texture2D(sampler2d, myAxes1.zw).rgb;\
+			sum += texture2D(sampler2d, myDiagonals0.xy).rgb * 2.0;\
+			sum += texture2D(sampler2d, myDiagonals0.zw).rgb * 2.0;\
+			sum += texture2D(sampler2d, myDiagonals1.xy).rgb * 2.0;\
+			sum += texture2D(sampler2d, myDiagonals1.zw).rgb * 2.0;\
+			gl_FragColor = vec4(sum / 12.0, 1.0);\
+		}";
+
+	const char* pszGaussianVertShader = "\
+		attribute highp vec2	myVertex;\
+		varying mediump vec2	myTexCoord;\
+		void main(void)\
+		{\
+			gl_Position = vec4(myVertex * 2.0 - 1.0, 0.0, 1.0);\
+			myTexCoord = myVertex;\
+		}";
+
+	GLuint buildPass(const char* vertSrc, const char* fragSrc, GLint* stepLocation) {
+		const char* attribs[] = { "myVertex" };
+		GLuint program = buildProgram(vertSrc, fragSrc, attribs, 1);
+		if (program) {
+			glUseProgram(program);
+			glUniform1i(glGetUniformLocation(program, "sampler2d"), 0);
+			*stepLocation = glGetUniformLocation(program, "myStep");
+		}
+		return program;
+	}
+
+	//An RGBA target with linear filtering, for reading back with offsets
+	//between texels
+	bool createTarget(int width, int height, GLuint* texture, GLuint* framebuffer) {
+		glGenTextures(1, texture);
+		glBindTexture(GL_TEXTURE_2D, *texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glGenFramebuffers(1, framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, *framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *texture, 0);
+		bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return complete;
+	}
+
+	GLuint createQuad() {
+		GLuint buffer;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(QUAD), QUAD, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return buffer;
+	}
+
+	void drawQuad(GLuint buffer) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glEnableVertexAttribArray(VERTEX_ARRAY);
+		glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+KawaseBlur::KawaseBlur(int width_, int height_, int maxLevels_) :
+	width(width_), height(height_), maxLevels(maxLevels_ > 0 ? maxLevels_ : 1), textures(NULL), quadBuffer(0),
+	downProgram(0), upProgram(0), downTexelLocation(-1), upTexelLocation(-1) {
+}
+
+KawaseBlur::~KawaseBlur() {
+	for (size_t i = 0; i < handles.size(); i++)
+		textures->release(handles[i]);
+	for (size_t i = 0; i < levels.size(); i++) {
+		glDeleteFramebuffers(1, &levels[i].framebuffer);
+		glDeleteTextures(1, &levels[i].texture);
+	}
+	glDeleteBuffers(1, &quadBuffer);
+	glDeleteProgram(downProgram);
+	glDeleteProgram(upProgram);
+}
+
+bool KawaseBlur::init(TextureManager* textures_) {
+	textures = textures_;
+	downProgram = buildPass(pszDownVertShader, pszDownFragShader, &downTexelLocation);
+	upProgram = buildPass(pszUpVertShader, pszUpFragShader, &upTexelLocation);
+	if (!downProgram || !upProgram)
+		return false;
+
+	//Stop halving before a level loses its last texel
+	int w = width, h = height;
+	while ((int)levels.size() < maxLevels && w > 1 && h > 1) {
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+		Level level = { w, h, 0, 0 };
+		bool complete = createTarget(w, h, &level.texture, &level.framebuffer);
+		levels.push_back(level);
+		if (textures)
+			handles.push_back(textures->track(level.texture, w, h));
+		if (!complete)
+			return false;
+	}
+	quadBuffer = createQuad();
+	return true;
+}
+
+void KawaseBlur::levelsFor(float radius, int* levelCount, float* offset) const {
+	//Each level doubles the radius; the offset stretches the taps of every
+	//level to land on radius between two counts
+	int count = 0;
+	float reach = KAWASE_BASE_RADIUS;
+	while (count < (int)levels.size() && radius > 0.0f && (count == 0 || radius > reach * KAWASE_MIN_OFFSET)) {
+		count++;
+		if (radius <= reach)
+			break;
+		reach *= 2.0f;
+	}
+	*levelCount = count;
+	*offset = count ? radius / (KAWASE_BASE_RADIUS * (float)(1 << (count - 1))) : 0.0f;
+}
+
+void KawaseBlur::pass(GLuint program, GLint stepLocation, GLuint source, int sourceWidth, int sourceHeight,
+					  float offset, GLuint framebuffer, int w, int h) {
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, w, h);
+	glUseProgram(program);
+	glUniform2f(stepLocation, offset / sourceWidth, offset / sourceHeight);
+	glBindTexture(GL_TEXTURE_2D, source);
+	drawQuad(quadBuffer);
+}
+
+void KawaseBlur::apply(GLuint source, float radius, GLuint output) {
+	int count;
+	float offset;
+	levelsFor(radius, &count, &offset);
+
+	//Down the pyramid from the source, then up again, the last pass
+	//straight into the output
+	GLuint from = source;
+	int fromWidth = width, fromHeight = height;
+	for (int i = 0; i < count; i++) {
+		const Level& level = levels[i];
+		pass(downProgram, downTexelLocation, from, fromWidth, fromHeight, offset,
+			 level.framebuffer, level.width, level.height);
+		from = level.texture;
+		fromWidth = level.width;
+		fromHeight = level.height;
+	}
+	for (int i = count - 2; i >= 0; i--) {
+		const Level& level = levels[i];
+		pass(upProgram, upTexelLocation, from, fromWidth, fromHeight, offset,
+			 level.framebuffer, level.width, level.height);
+		from = level.texture;
+		fromWidth = level.width;
+		fromHeight = level.height;
+	}
+	pass(upProgram, upTexelLocation, from, fromWidth, fromHeight, offset, output, width, height);
+}
+
+GaussianBlur::GaussianBlur(int width_, int height_, bool linearSampling) :
+	width(width_), height(height_), linear(linearSampling), texture(0), framebuffer(0), quadBuffer(0) {
+}
+
+GaussianBlur::~GaussianBlur() {
+	for (map<int, Pass>::iterator i = programs.begin(); i != programs.end(); ++i)
+		glDeleteProgram(i->second.program);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteTextures(1, &texture);
+	glDeleteBuffers(1, &quadBuffer);
+}
+
+bool GaussianBlur::init() {
+	if (!createTarget(width, height, &texture, &framebuffer))
+		return false;
+	quadBuffer = createQuad();
+	return true;
+}
+
+int GaussianBlur::tapCount(float radius) const {
+	int r = (int)(radius + 0.5f);
+	r = r < 1 ? 1 : (r > MAX_GAUSSIAN_RADIUS ? MAX_GAUSSIAN_RADIUS : r);
+	return linear ? 1 + 2 * ((r + 1) / 2) : 1 + 2 * r;
+}
+
+//Generates the fragment shader of one pass: the centre tap, then pairs of
+//taps either side along myStep, one texel apart, or with linear sampling
+//two texels apart at the weighted mean of the pair
+const GaussianBlur::Pass& GaussianBlur::program(int r) {
+	map<int, Pass>::iterator found = programs.find(r);
+	if (found != programs.end())
+		return found->second;
+
+	float sigma = r / 3.0f;
+	vector<float> weights(r + 1);
+	float total = 0.0f;
+	for (int i = 0; i <= r; i++) {
+		weights[i] = expf(-(float)(i * i) / (2.0f * sigma * sigma));
+		total += i ? 2.0f * weights[i] : weights[i];
+	}
+
+	ostringstream src;
+	src << fixed << "\
+		uniform sampler2D sampler2d;\n\
+		uniform mediump vec2	myStep;\n\
+		varying mediump vec2	myTexCoord;\n\
+		void main (void)\n\
+		{\n";
+	src << "\t\t\tmediump vec3 sum = texture2D(sampler2d, myTexCoord).rgb * "
+		<< setprecision(8) << weights[0] / total << ";\n";
+	int step = linear ? 2 : 1;
+	for (int i = 1; i <= r; i += step) {
+		float weight = weights[i], distance = (float)i;
+		if (linear && i + 1 <= r) {
+			weight = weights[i] + weights[i + 1];
+			distance = (i * weights[i] + (i + 1) * weights[i + 1]) / weight;
+		}
+		src << setprecision(6) << "\t\t\tsum += (texture2D(sampler2d, myTexCoord + myStep * " << distance
+			<< ").rgb + texture2D(sampler2d, myTexCoord - myStep * " << distance
+			<< ").rgb) * " << setprecision(8) << weight / total << ";\n";
+	}
+	src << "\t\t\tgl_FragColor = vec4(sum, 1.0);\n\t\t}";
+
+	Pass& built = programs[r];
+	built.stepLocation = -1;
+	built.program = buildPass(pszGaussianVertShader, src.str().c_str(), &built.stepLocation);
+	return built;
+}
+
+void GaussianBlur::pass(const Pass& prog, GLuint source, float dx, float dy, GLuint target) {
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+	glViewport(0, 0, width, height);
+	glUseProgram(prog.program);
+	glUniform2f(prog.stepLocation, dx, dy);
+	glBindTexture(GL_TEXTURE_2D, source);
+	drawQuad(quadBuffer);
+}
+
+void GaussianBlur::apply(GLuint source, float radius, GLuint output) {
+	int r = (int)(radius + 0.5f);
+	r = r < 1 ? 1 : (r > MAX_GAUSSIAN_RADIUS ? MAX_GAUSSIAN_RADIUS : r);
+	const Pass& prog = program(r);
+	if (!prog.program)
+		return;
+	pass(prog, source, 1.0f / width, 0.0f, framebuffer);
+	pass(prog, texture, 0.0f, 1.0f / height, output);
+}
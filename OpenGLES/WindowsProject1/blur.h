@@ -0,0 +1,106 @@
+#ifndef BLUR_H_INCLUDED
+#define BLUR_H_INCLUDED
+
+#include <map>
+#include <vector>
+#include <GLES2/gl2.h>
+#include "texturemanager.h"
+
+/* Blur for post-processing on framebuffers, by radius in pixels: about the
+ * Gaussian with sigma = radius / 3, so radius is where the kernel fades out.
+ *
+ * Both classes read a width x height source texture and write the result
+ * over the whole of a width x height output framebuffer, 0 for the window.
+ * They leave the output bound with its viewport set, and their program
+ * bound.
+ */
+
+/* Dual Kawase blur: the source is halved level by level with a 5-tap
+ * filter and brought back up with an 8-tap one, every tap a bilinear
+ * fetch between texels.  Each level doubles the radius for the same
+ * 13 fetches a pixel of its size, so the whole chain costs about the same
+ * as one fullscreen pass of 5 and one of 8, whatever the radius.  The tap
+ * coordinates are computed in the vertex shader so no fetch depends on
+ * arithmetic in the fragment shader.
+ */
+class KawaseBlur {
+	public:
+		//maxLevels bounds the pyramid; 6 levels reach a radius of about 400
+		KawaseBlur(int width, int height, int maxLevels = 6);
+		~KawaseBlur();
+
+		//Creates the pyramid of half-size targets and the programs; needs a
+		//current context.  With textures, the targets are track()ed in it
+		//until the blur is deleted.
+		bool init(TextureManager* textures = NULL);
+
+		void apply(GLuint source, float radius, GLuint output);
+
+		//The levels and the tap spread, in source texels, the chain uses
+		//for radius.  radius 0 is a straight copy.
+		void levelsFor(float radius, int* levels, float* offset) const;
+
+	private:
+		struct Level {
+			int width, height;
+			GLuint texture;
+			GLuint framebuffer;
+		};
+
+		void pass(GLuint program, GLint texelLocation, GLuint source, int sourceWidth, int sourceHeight,
+				  float offset, GLuint framebuffer, int width, int height);
+
+		int width;
+		int height;
+		int maxLevels;
+		std::vector<Level> levels;	//levels[0] is half the source size
+		TextureManager* textures;
+		std::vector<TextureHandle> handles;	//One per level while tracked
+		GLuint quadBuffer;
+		GLuint downProgram;
+		GLuint upProgram;
+		GLint downTexelLocation;
+		GLint upTexelLocation;
+};
+
+/* Separable Gaussian blur: a horizontal pass into a full-size target, then
+ * a vertical pass to the output.
+ *
+ * With linear sampling each fetch lands between two texels at the point
+ * where bilinear filtering weighs them as the kernel does, so a radius r
+ * takes about r + 1 fetches a pass instead of the 2r + 1 of the naive
+ * kernel (linearSampling false), which is kept to measure against.  The
+ * taps are unrolled into a program generated for each radius the first
+ * time it is used.
+ */
+class GaussianBlur {
+	public:
+		GaussianBlur(int width, int height, bool linearSampling = true);
+		~GaussianBlur();
+
+		bool init();
+
+		void apply(GLuint source, float radius, GLuint output);
+
+		//Texture fetches per pixel of one pass
+		int tapCount(float radius) const;
+
+	private:
+		struct Pass {
+			GLuint program;
+			GLint stepLocation;
+		};
+
+		const Pass& program(int radius);
+		void pass(const Pass& program, GLuint source, float dx, float dy, GLuint framebuffer);
+
+		int width;
+		int height;
+		bool linear;
+		GLuint texture;
+		GLuint framebuffer;
+		GLuint quadBuffer;
+		std::map<int, Pass> programs;	//By radius
+};
+
+#endif
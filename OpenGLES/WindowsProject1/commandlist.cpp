@@ -0,0 +1,293 @@
+#include "stdafx.h"
+#include <string.h>
+#include "commandlist.h"
+
+//Header of every recorded command, followed by its arguments
+struct CommandList::Command {
+	Command* next;
+	int type;
+};
+
+namespace {
+	enum CommandType {
+		CMD_USE_PROGRAM,
+		CMD_UNIFORM_MATRIX4,
+		CMD_UNIFORM4,
+		CMD_BIND_TEXTURE,
+		CMD_BIND_BUFFER,
+		CMD_VERTEX_ARRAY,
+		CMD_DISABLE_VERTEX_ARRAY,
+		CMD_DRAW_ARRAYS,
+		CMD_DRAW_ELEMENTS
+	};
+
+	struct UniformArgs {
+		GLint location;
+		GLfloat value[16];
+	};
+
+	struct BindArgs {
+		GLenum target;	//Texture unit for CMD_BIND_TEXTURE
+		GLuint object;
+	};
+
+	struct VertexArrayArgs {
+		GLuint index;
+		int size;
+		GLenum type;
+		bool normalized;
+		int stride;
+		const void* pointer;
+	};
+
+	struct DrawArgs {
+		GLenum mode;
+		int first;
+		int count;
+		GLenum type;
+		const void* indices;
+	};
+}
+
+GLBackend::GLBackend() {
+	invalidate();
+}
+
+void GLBackend::invalidate() {
+	//~0 never matches a real object, so the next bind of each goes through
+	program = ~0u;
+	for (int i = 0; i < MAX_UNITS; i++)
+		textures[i] = ~0u;
+	activeUnit = -1;
+	arrayBuffer = ~0u;
+	elementBuffer = ~0u;
+	for (int i = 0; i < MAX_ATTRIBS; i++)
+		enabled[i] = false;
+	draws = 0;
+	binds = 0;
+	skipped = 0;
+}
+
+void GLBackend::useProgram(GLuint program_) {
+	if (program == program_) {
+		skipped++;
+		return;
+	}
+	program = program_;
+	glUseProgram(program);
+	binds++;
+}
+
+void GLBackend::uniformMatrix4(GLint location, const GLfloat* matrix) {
+	glUniformMatrix4fv(location, 1, GL_FALSE, matrix);
+}
+
+void GLBackend::uniform4(GLint location, const GLfloat* value) {
+	glUniform4fv(location, 1, value);
+}
+
+void GLBackend::bindTexture(int unit, GLuint texture) {
+	if (unit < MAX_UNITS && textures[unit] == texture) {
+		skipped++;
+		return;
+	}
+	if (activeUnit != unit) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		activeUnit = unit;
+	}
+	if (unit < MAX_UNITS)
+		textures[unit] = texture;
+	glBindTexture(GL_TEXTURE_2D, texture);
+	binds++;
+}
+
+void GLBackend::bindBuffer(GLenum target, GLuint buffer) {
+	GLuint& bound = target == GL_ELEMENT_ARRAY_BUFFER ? elementBuffer : arrayBuffer;
+	if (bound == buffer) {
+		skipped++;
+		return;
+	}
+	bound = buffer;
+	glBindBuffer(target, buffer);
+	binds++;
+}
+
+void GLBackend::vertexArray(GLuint index, int size, GLenum type, bool normalized,
+							int stride, const void* pointer) {
+	if (index >= MAX_ATTRIBS || !enabled[index]) {
+		glEnableVertexAttribArray(index);
+		if (index < MAX_ATTRIBS)
+			enabled[index] = true;
+	}
+	glVertexAttribPointer(index, size, type, normalized ? GL_TRUE : GL_FALSE, stride, pointer);
+}
+
+void GLBackend::disableVertexArray(GLuint index) {
+	glDisableVertexAttribArray(index);
+	if (index < MAX_ATTRIBS)
+		enabled[index] = false;
+}
+
+void GLBackend::drawArrays(GLenum mode, int first, int count) {
+	glDrawArrays(mode, first, count);
+	draws++;
+}
+
+void GLBackend::drawElements(GLenum mode, int count, GLenum type, const void* indices) {
+	glDrawElements(mode, count, type, indices);
+	draws++;
+}
+
+CommandList::CommandList(size_t blockSize) :
+	arena(blockSize), frameArena(NULL), bytes(0), first(NULL), last(NULL), count(0) {
+}
+
+CommandList::CommandList(FrameArena* frameArena_) :
+	arena(0), frameArena(frameArena_), bytes(0), first(NULL), last(NULL), count(0) {
+}
+
+void CommandList::reset() {
+	if (!frameArena)
+		arena.reset();
+	bytes = 0;
+	first = NULL;
+	last = NULL;
+	count = 0;
+}
+
+void* CommandList::allocate(size_t size) {
+	bytes += size;
+	return frameArena ? frameArena->allocate(size) : arena.allocate(size);
+}
+
+void* CommandList::append(int type, size_t size) {
+	Command* command = (Command*)allocate(sizeof(Command) + size);
+	command->next = NULL;
+	command->type = type;
+	if (last)
+		last->next = command;
+	else
+		first = command;
+	last = command;
+	count++;
+	return command + 1;
+}
+
+void CommandList::useProgram(GLuint program) {
+	BindArgs* args = (BindArgs*)append(CMD_USE_PROGRAM, sizeof(BindArgs));
+	args->target = 0;
+	args->object = program;
+}
+
+void CommandList::uniformMatrix4(GLint location, const GLfloat* matrix) {
+	UniformArgs* args = (UniformArgs*)append(CMD_UNIFORM_MATRIX4, sizeof(UniformArgs));
+	args->location = location;
+	memcpy(args->value, matrix, 16 * sizeof(GLfloat));
+}
+
+void CommandList::uniform4(GLint location, const GLfloat* value) {
+	//Only the first four floats are stored
+	UniformArgs* args = (UniformArgs*)append(CMD_UNIFORM4, sizeof(GLint) + 4 * sizeof(GLfloat));
+	args->location = location;
+	memcpy(args->value, value, 4 * sizeof(GLfloat));
+}
+
+void CommandList::bindTexture(int unit, GLuint texture) {
+	BindArgs* args = (BindArgs*)append(CMD_BIND_TEXTURE, sizeof(BindArgs));
+	args->target = unit;
+	args->object = texture;
+}
+
+void CommandList::bindBuffer(GLenum target, GLuint buffer) {
+	BindArgs* args = (BindArgs*)append(CMD_BIND_BUFFER, sizeof(BindArgs));
+	args->target = target;
+	args->object = buffer;
+}
+
+void CommandList::vertexArray(GLuint index, int size, GLenum type, bool normalized,
+							  int stride, const void* pointer) {
+	VertexArrayArgs* args = (VertexArrayArgs*)append(CMD_VERTEX_ARRAY, sizeof(VertexArrayArgs));
+	args->index = index;
+	args->size = size;
+	args->type = type;
+	args->normalized = normalized;
+	args->stride = stride;
+	args->pointer = pointer;
+}
+
+void CommandList::disableVertexArray(GLuint index) {
+	BindArgs* args = (BindArgs*)append(CMD_DISABLE_VERTEX_ARRAY, sizeof(BindArgs));
+	args->target = 0;
+	args->object = index;
+}
+
+void CommandList::drawArrays(GLenum mode, int first, int count) {
+	DrawArgs* args = (DrawArgs*)append(CMD_DRAW_ARRAYS, sizeof(DrawArgs));
+	args->mode = mode;
+	args->first = first;
+	args->count = count;
+}
+
+void CommandList::drawElements(GLenum mode, int count, GLenum type, const void* indices) {
+	DrawArgs* args = (DrawArgs*)append(CMD_DRAW_ELEMENTS, sizeof(DrawArgs));
+	args->mode = mode;
+	args->count = count;
+	args->type = type;
+	args->indices = indices;
+}
+
+void* CommandList::copy(const void* data, size_t size) {
+	void* target = allocate(size);
+	memcpy(target, data, size);
+	return target;
+}
+
+void CommandList::replay(CommandBackend& backend) const {
+	for (const Command* command = first; command; command = command->next) {
+		const void* args = command + 1;
+		switch (command->type) {
+			case CMD_USE_PROGRAM:
+				backend.useProgram(((const BindArgs*)args)->object);
+				break;
+			case CMD_UNIFORM_MATRIX4: {
+				const UniformArgs* uniform = (const UniformArgs*)args;
+				backend.uniformMatrix4(uniform->location, uniform->value);
+				break;
+			}
+			case CMD_UNIFORM4: {
+				const UniformArgs* uniform = (const UniformArgs*)args;
+				backend.uniform4(uniform->location, uniform->value);
+				break;
+			}
+			case CMD_BIND_TEXTURE: {
+				const BindArgs* bind = (const BindArgs*)args;
+				backend.bindTexture(bind->target, bind->object);
+				break;
+			}
+			case CMD_BIND_BUFFER: {
+				const BindArgs* bind = (const BindArgs*)args;
+				backend.bindBuffer(bind->target, bind->object);
+				break;
+			}
+			case CMD_VERTEX_ARRAY: {
+				const VertexArrayArgs* array = (const VertexArrayArgs*)args;
+				backend.vertexArray(array->index, array->size, array->type, array->normalized,
+									array->stride, array->pointer);
+				break;
+			}
+			case CMD_DISABLE_VERTEX_ARRAY:
+				backend.disableVertexArray(((const BindArgs*)args)->object);
+				break;
+			case CMD_DRAW_ARRAYS: {
+				const DrawArgs* draw = (const DrawArgs*)args;
+				backend.drawArrays(draw->mode, draw->first, draw->count);
+				break;
+			}
+			case CMD_DRAW_ELEMENTS: {
+				const DrawArgs* draw = (const DrawArgs*)args;
+				backend.drawElements(draw->mode, draw->count, draw->type, draw->indices);
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,125 @@
+#ifndef COMMAND_LIST_H_INCLUDED
+#define COMMAND_LIST_H_INCLUDED
+
+#include <GLES2/gl2.h>
+#include "arena.h"
+#include "framearena.h"
+
+/* Receiver of recorded commands.  GLBackend turns them into GL calls; other
+ * backends can render the same lists without a GL context.
+ */
+class CommandBackend {
+	public:
+		virtual ~CommandBackend() {}
+
+		virtual void useProgram(GLuint program) = 0;
+		virtual void uniformMatrix4(GLint location, const GLfloat* matrix) = 0;
+		virtual void uniform4(GLint location, const GLfloat* value) = 0;
+		virtual void bindTexture(int unit, GLuint texture) = 0;
+		virtual void bindBuffer(GLenum target, GLuint buffer) = 0;
+		virtual void vertexArray(GLuint index, int size, GLenum type, bool normalized,
+								 int stride, const void* pointer) = 0;
+		virtual void disableVertexArray(GLuint index) = 0;
+		virtual void drawArrays(GLenum mode, int first, int count) = 0;
+		virtual void drawElements(GLenum mode, int count, GLenum type, const void* indices) = 0;
+};
+
+//Executes commands on the current GL context, skipping program, texture and
+//buffer binds that are already in place
+class GLBackend : public CommandBackend {
+	public:
+		GLBackend();
+
+		//Forgets the cached bindings and zeroes the counters; call after GL
+		//state was changed outside the backend
+		void invalidate();
+
+		void useProgram(GLuint program);
+		void uniformMatrix4(GLint location, const GLfloat* matrix);
+		void uniform4(GLint location, const GLfloat* value);
+		void bindTexture(int unit, GLuint texture);
+		void bindBuffer(GLenum target, GLuint buffer);
+		void vertexArray(GLuint index, int size, GLenum type, bool normalized,
+						 int stride, const void* pointer);
+		void disableVertexArray(GLuint index);
+		void drawArrays(GLenum mode, int first, int count);
+		void drawElements(GLenum mode, int count, GLenum type, const void* indices);
+
+		int drawCount() const { return draws; }
+		//Program, texture and buffer binds issued, and those skipped
+		int bindCount() const { return binds; }
+		int skippedBinds() const { return skipped; }
+
+	private:
+		enum { MAX_UNITS = 8, MAX_ATTRIBS = 8 };
+
+		GLuint program;
+		GLuint textures[MAX_UNITS];
+		int activeUnit;
+		GLuint arrayBuffer;
+		GLuint elementBuffer;
+		bool enabled[MAX_ATTRIBS];
+		int draws;
+		int binds;
+		int skipped;
+};
+
+/* A recorded sequence of draw commands.
+ *
+ * GL contexts are bound to one thread, but preparing draws (matrices,
+ * culling, picking programs) doesn't need the context.  Worker threads can
+ * each record a CommandList in parallel, then the thread owning the context
+ * replays them in order.  Commands and their arguments are stored in the
+ * list's own LinearArena, so recording a frame after the first does no heap
+ * allocation once the list is reset().  A list built on a FrameArena records
+ * into the frame's memory instead; reset() it at the start of every frame.
+ *
+ * Matrices and uniform values are copied when recorded.  Vertex and index
+ * pointers are not: they must stay valid until replay, or be copied into the
+ * list with copy().
+ */
+class CommandList {
+	public:
+		explicit CommandList(size_t blockSize = 64 * 1024);
+		explicit CommandList(FrameArena* frameArena);
+
+		//Drops the recorded commands, keeping the memory
+		void reset();
+
+		void useProgram(GLuint program);
+		void uniformMatrix4(GLint location, const GLfloat* matrix);
+		void uniform4(GLint location, const GLfloat* value);
+		void bindTexture(int unit, GLuint texture);
+		void bindBuffer(GLenum target, GLuint buffer);
+		void vertexArray(GLuint index, int size, GLenum type, bool normalized,
+						 int stride, const void* pointer);
+		void disableVertexArray(GLuint index);
+		void drawArrays(GLenum mode, int first, int count);
+		void drawElements(GLenum mode, int count, GLenum type, const void* indices);
+
+		//Returns a copy of size bytes of data that lives as long as the commands
+		void* copy(const void* data, size_t size);
+
+		//Sends every command, in recording order, to backend
+		void replay(CommandBackend& backend) const;
+
+		int commandCount() const { return count; }
+		size_t memoryUsed() const { return bytes; }
+
+	private:
+		struct Command;
+
+		//Adds a command and returns its size bytes of arguments
+		void* append(int type, size_t size);
+
+		void* allocate(size_t size);
+
+		LinearArena arena;
+		FrameArena* frameArena;	//Used instead of arena when set
+		size_t bytes;
+		Command* first;
+		Command* last;
+		int count;
+};
+
+#endif
@@ -0,0 +1,237 @@
+#include "stdafx.h"
+#include <string.h>
+#include <string>
+#include <sstream>
+#include <EGL/egl.h>
+#include "drawconstants.h"
+#include "glprogram.h"
+
+using namespace std;
+
+// Index to bind the attributes to vertex shaders
+#define VERTEX_ARRAY	0
+
+// ES 3.0 values missing from the ES 2.0 headers
+#define UNIFORM_BUFFER					0x8A11
+#define UNIFORM_BUFFER_OFFSET_ALIGNMENT	0x8A34
+#define INVALID_INDEX					0xFFFFFFFFu
+#define MAP_WRITE_BIT					0x0002
+#define MAP_INVALIDATE_RANGE_BIT		0x0004
+#define MAP_UNSYNCHRONIZED_BIT			0x0020
+#define SYNC_GPU_COMMANDS_COMPLETE		0x9117
+#define SYNC_FLUSH_COMMANDS_BIT			0x00000001
+#define TIMEOUT_IGNORED					0xFFFFFFFFFFFFFFFFull
+
+namespace {
+	typedef struct __GLsync* Sync;
+	typedef GLuint (GL_APIENTRY *GetUniformBlockIndexProc)(GLuint program, const GLchar* name);
+	typedef void (GL_APIENTRY *UniformBlockBindingProc)(GLuint program, GLuint index, GLuint binding);
+	typedef void (GL_APIENTRY *BindBufferRangeProc)(GLenum target, GLuint index, GLuint buffer,
+													GLintptr offset, GLsizeiptr size);
+	typedef void* (GL_APIENTRY *MapBufferRangeProc)(GLenum target, GLintptr offset, GLsizeiptr length,
+													GLbitfield access);
+	typedef GLboolean (GL_APIENTRY *UnmapBufferProc)(GLenum target);
+	typedef Sync (GL_APIENTRY *FenceSyncProc)(GLenum condition, GLbitfield flags);
+	typedef GLenum (GL_APIENTRY *ClientWaitSyncProc)(Sync sync, GLbitfield flags, unsigned long long timeout);
+	typedef void (GL_APIENTRY *DeleteSyncProc)(Sync sync);
+
+	struct ES3Procs {
+		GetUniformBlockIndexProc getUniformBlockIndex;
+		UniformBlockBindingProc uniformBlockBinding;
+		BindBufferRangeProc bindBufferRange;
+		MapBufferRangeProc mapBufferRange;
+		UnmapBufferProc unmapBuffer;
+		FenceSyncProc fenceSync;
+		ClientWaitSyncProc clientWaitSync;
+		DeleteSyncProc deleteSync;
+
+		ES3Procs() {
+			getUniformBlockIndex = (GetUniformBlockIndexProc)eglGetProcAddress("glGetUniformBlockIndex");
+			uniformBlockBinding = (UniformBlockBindingProc)eglGetProcAddress("glUniformBlockBinding");
+			bindBufferRange = (BindBufferRangeProc)eglGetProcAddress("glBindBufferRange");
+			mapBufferRange = (MapBufferRangeProc)eglGetProcAddress("glMapBufferRange");
+			unmapBuffer = (UnmapBufferProc)eglGetProcAddress("glUnmapBuffer");
+			fenceSync = (FenceSyncProc)eglGetProcAddress("glFenceSync");
+			clientWaitSync = (ClientWaitSyncProc)eglGetProcAddress("glClientWaitSync");
+			deleteSync = (DeleteSyncProc)eglGetProcAddress("glDeleteSync");
+		}
+
+		bool loaded() const {
+			return getUniformBlockIndex && uniformBlockBinding && bindBufferRange && mapBufferRange &&
+				   unmapBuffer && fenceSync && clientWaitSync && deleteSync;
+		}
+	};
+
+	//Loaded on first use, when a context is current
+	const ES3Procs& es3() {
+		static ES3Procs procs;
+		return procs;
+	}
+
+	const char* pszArrayVertShader = "\
+		attribute highp vec3	myVertex;\n\
+		uniform highp vec4		constants[5 * BATCH];\n\
+		varying lowp vec4		myTint;\n\
+		void main(void)\n\
+		{\n\
+			int i = 5 * int(myVertex.z);\n\
+			mat4 matrix = mat4(constants[i], constants[i + 1], constants[i + 2], constants[i + 3]);\n\
+			gl_Position = matrix * vec4(myVertex.xy, 0.0, 1.0);\n\
+			myTint = constants[i + 4];\n\
+		}";
+	const char* pszArrayFragShader = "\
+		varying lowp vec4		myTint;\
+		void main (void)\
+		{\
+			gl_FragColor = myTint;\
+		}";
+}
+
+UniformRing::UniformRing(size_t frameBytes_, int frames_) :
+	frameBytes(frameBytes_), frames(frames_ < 1 ? 1 : frames_), section(0), alignment(256),
+	head(0), flushed(0), buffer(0) {
+}
+
+UniformRing::~UniformRing() {
+	for (size_t i = 0; i < fences.size(); i++) {
+		if (fences[i])
+			es3().deleteSync(fences[i]);
+	}
+	glDeleteBuffers(1, &buffer);
+}
+
+bool UniformRing::supported() {
+	const char* version = (const char*)glGetString(GL_VERSION);
+	if (!version || strncmp(version, "OpenGL ES ", 10) != 0 || version[10] < '3')
+		return false;
+	return es3().loaded();
+}
+
+bool UniformRing::init() {
+	if (!supported())
+		return false;
+	GLint offsetAlignment = 0;
+	glGetIntegerv(UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+	if (offsetAlignment > 0)
+		alignment = offsetAlignment;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(UNIFORM_BUFFER, buffer);
+	glBufferData(UNIFORM_BUFFER, frameBytes * frames, NULL, GL_DYNAMIC_DRAW);
+	fences.assign(frames, (Sync)NULL);
+	staging.resize(frameBytes);
+	head = flushed = 0;
+	return true;
+}
+
+bool UniformRing::bindBlock(GLuint program, const char* blockName, GLuint binding) {
+	GLuint index = es3().getUniformBlockIndex(program, blockName);
+	if (index == INVALID_INDEX)
+		return false;
+	es3().uniformBlockBinding(program, index, binding);
+	return true;
+}
+
+void UniformRing::beginFrame() {
+	section = (section + 1) % frames;
+	if (fences[section]) {
+		//Usually long signalled; only blocks when the GPU is frames behind
+		es3().clientWaitSync(fences[section], SYNC_FLUSH_COMMANDS_BIT, TIMEOUT_IGNORED);
+		es3().deleteSync(fences[section]);
+		fences[section] = NULL;
+	}
+	head = flushed = frameStart();
+}
+
+GLintptr UniformRing::push(const void* data, size_t size) {
+	size_t offset = (head + alignment - 1) / alignment * alignment;
+	if (offset + size > frameStart() + frameBytes)
+		return -1;
+	memcpy(&staging[offset - frameStart()], data, size);
+	head = offset + size;
+	return (GLintptr)offset;
+}
+
+void UniformRing::flush() {
+	if (head == flushed)
+		return;
+	glBindBuffer(UNIFORM_BUFFER, buffer);
+	//Unsynchronized is safe: the section's fence was waited on in beginFrame()
+	void* target = es3().mapBufferRange(UNIFORM_BUFFER, flushed, head - flushed,
+		MAP_WRITE_BIT | MAP_INVALIDATE_RANGE_BIT | MAP_UNSYNCHRONIZED_BIT);
+	if (target) {
+		memcpy(target, &staging[flushed - frameStart()], head - flushed);
+		es3().unmapBuffer(UNIFORM_BUFFER);
+	}
+	else {
+		glBufferSubData(UNIFORM_BUFFER, flushed, head - flushed, &staging[flushed - frameStart()]);
+	}
+	flushed = head;
+}
+
+void UniformRing::bind(GLuint binding, GLintptr offset, size_t size) {
+	es3().bindBufferRange(UNIFORM_BUFFER, binding, buffer, offset, size);
+}
+
+void UniformRing::endFrame() {
+	flush();
+	fences[section] = es3().fenceSync(SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+ConstantArrayBatch::ConstantArrayBatch() :
+	vertexCount(0), batch(0), program(0), constantsLocation(-1), vertexBuffer(0), drawCalls(0) {
+}
+
+ConstantArrayBatch::~ConstantArrayBatch() {
+	glDeleteBuffers(1, &vertexBuffer);
+	glDeleteProgram(program);
+}
+
+bool ConstantArrayBatch::init(const GLfloat* triangles, int vertexCount_, int maxBatch) {
+	vertexCount = vertexCount_;
+	GLint maxVectors = 0;
+	glGetIntegerv(GL_MAX_VERTEX_UNIFORM_VECTORS, &maxVectors);
+	//Keep a few vectors for the driver's own use
+	batch = (maxVectors - 4) / 5;
+	if (maxBatch > 0 && maxBatch < batch)
+		batch = maxBatch;
+	if (batch < 1 || vertexCount <= 0)
+		return false;
+
+	ostringstream vertSrc;
+	vertSrc << "#define BATCH " << batch << "\n" << pszArrayVertShader;
+	const char* attribs[] = { "myVertex" };
+	program = buildProgram(vertSrc.str().c_str(), pszArrayFragShader, attribs, 1);
+	if (!program)
+		return false;
+	constantsLocation = glGetUniformLocation(program, "constants");
+
+	//batch copies of the mesh, z holding the copy index
+	vector<GLfloat> vertices(batch * vertexCount * 3);
+	for (int copy = 0; copy < batch; copy++) {
+		for (int v = 0; v < vertexCount; v++) {
+			GLfloat* vertex = &vertices[(copy * vertexCount + v) * 3];
+			vertex[0] = triangles[2 * v];
+			vertex[1] = triangles[2 * v + 1];
+			vertex[2] = (GLfloat)copy;
+		}
+	}
+	glGenBuffers(1, &vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);
+	return true;
+}
+
+void ConstantArrayBatch::draw(const DrawConstants* items, int count) {
+	glUseProgram(program);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glEnableVertexAttribArray(VERTEX_ARRAY);
+	glVertexAttribPointer(VERTEX_ARRAY, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	for (int first = 0; first < count; first += batch) {
+		int n = count - first < batch ? count - first : batch;
+		glUniform4fv(constantsLocation, 5 * n, items[first].matrix);
+		glDrawArrays(GL_TRIANGLES, 0, n * vertexCount);
+		drawCalls++;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
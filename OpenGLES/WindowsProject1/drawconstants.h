@@ -0,0 +1,109 @@
+#ifndef DRAW_CONSTANTS_H_INCLUDED
+#define DRAW_CONSTANTS_H_INCLUDED
+
+#include <vector>
+#include <GLES2/gl2.h>
+
+//Constants of one draw, laid out for both paths below: as a std140 uniform
+//block { mat4 myPMVMatrix; vec4 myColor; } and as five vec4 of an array
+struct DrawConstants {
+	GLfloat matrix[16];
+	GLfloat color[4];
+};
+
+/* Per-draw constants through uniform buffers, for ES 3.0 contexts.
+ *
+ * Instead of a glUniform* call per draw, a frame's constants are staged with
+ * push(), uploaded together by flush(), and every draw picks its own with
+ * bind(), a glBindBufferRange.  The buffer is a ring of frames sections,
+ * each frameBytes long; beginFrame() waits on the fence of the section it
+ * is about to reuse, so the ring never overwrites constants the GPU is
+ * still reading and needs no orphaning.
+ *
+ * The ES 3.0 entry points are loaded with eglGetProcAddress, so the rest of
+ * the code keeps building against the ES 2.0 headers.
+ */
+class UniformRing {
+	public:
+		explicit UniformRing(size_t frameBytes = 1 << 20, int frames = 3);
+		~UniformRing();
+
+		//False on ES 2.0 contexts; use ConstantArrayBatch there
+		static bool supported();
+
+		//Creates the buffer; needs a current ES 3.0 context
+		bool init();
+
+		//Binds the uniform block blockName of program to binding point
+		//binding.  Returns false if the program has no such block.
+		static bool bindBlock(GLuint program, const char* blockName, GLuint binding);
+
+		void beginFrame();
+
+		//Stages size bytes and returns the offset to pass to bind(), or -1
+		//if the frame's section is full
+		GLintptr push(const void* data, size_t size);
+
+		//Uploads what was pushed since the last flush; call before drawing
+		//with those offsets
+		void flush();
+
+		void bind(GLuint binding, GLintptr offset, size_t size);
+
+		//Fences the frame's section
+		void endFrame();
+
+		size_t frameBytesUsed() const { return head - frameStart(); }
+
+	private:
+		typedef struct __GLsync* Sync;
+
+		size_t frameStart() const { return frameBytes * section; }
+
+		size_t frameBytes;
+		int frames;
+		int section;
+		size_t alignment;	//GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+		size_t head;		//Next free byte of the buffer
+		size_t flushed;		//End of the bytes already uploaded
+		GLuint buffer;
+		std::vector<Sync> fences;
+		std::vector<unsigned char> staging;
+};
+
+/* Per-draw constants through uniform arrays, the ES 2.0 fallback.
+ *
+ * Draws many copies of one mesh with few calls: the vertex buffer holds
+ * batchSize copies of the mesh tagged with their copy index, and the
+ * DrawConstants of batchSize draws go to the shader in one glUniform4fv,
+ * so batchSize objects cost one uniform upload and one glDrawArrays.  The
+ * batch is limited by GL_MAX_VERTEX_UNIFORM_VECTORS, five vectors per
+ * object, 25 on the minimum ES 2.0 implementation.
+ */
+class ConstantArrayBatch {
+	public:
+		ConstantArrayBatch();
+		~ConstantArrayBatch();
+
+		//Creates the program and buffer for a mesh of vertexCount (x, y)
+		//vertices drawn as GL_TRIANGLES.  maxBatch <= 0 uses as many as the
+		//implementation allows.
+		bool init(const GLfloat* triangles, int vertexCount, int maxBatch = 0);
+
+		//Draws count copies of the mesh, copy i with items[i].  Leaves the
+		//batch program and buffer bound.
+		void draw(const DrawConstants* items, int count);
+
+		int batchSize() const { return batch; }
+		int drawCount() const { return drawCalls; }
+
+	private:
+		int vertexCount;
+		int batch;
+		GLuint program;
+		GLint constantsLocation;
+		GLuint vertexBuffer;
+		int drawCalls;
+};
+
+#endif
@@ -0,0 +1,287 @@
+#include "stdafx.h"
+#include <math.h>
+#include <string>
+#include <EGL/egl.h>
+#include "dynamicresolution.h"
+#include "glprogram.h"
+
+using namespace std;
+
+// Index to bind the attributes to vertex shaders
+#define VERTEX_ARRAY	0
+
+// Render sizes are multiples of this many pixels
+#define SIZE_STEP		8
+// Weight of the newest frame in the filtered frame time
+#define SMOOTHING		0.2f
+// The scale only climbs while frames take less than this share of the target
+#define HEADROOM		0.85f
+// Most the scale climbs in one frame
+#define MAX_STEP_UP		0.02f
+// Without GPU timing, frames up to this share of the target made their vsync
+#define VSYNC_SLACK		1.1f
+// GPU times from a second up are measurement errors, not frames
+#define MAX_GPU_NANOSECONDS	1000000000ull
+
+// GL_EXT_disjoint_timer_query values missing from the ES 2.0 headers
+#define TIME_ELAPSED_EXT			0x88BF
+#define QUERY_RESULT_EXT			0x8866
+#define QUERY_RESULT_AVAILABLE_EXT	0x8867
+#define GPU_DISJOINT_EXT			0x8FBB
+
+namespace {
+	typedef void (GL_APIENTRY *GenQueriesProc)(GLsizei n, GLuint* ids);
+	typedef void (GL_APIENTRY *DeleteQueriesProc)(GLsizei n, const GLuint* ids);
+	typedef void (GL_APIENTRY *BeginQueryProc)(GLenum target, GLuint id);
+	typedef void (GL_APIENTRY *EndQueryProc)(GLenum target);
+	typedef void (GL_APIENTRY *GetQueryObjectuivProc)(GLuint id, GLenum pname, GLuint* params);
+	typedef void (GL_APIENTRY *GetQueryObjectui64vProc)(GLuint id, GLenum pname, unsigned long long* params);
+
+	struct TimerProcs {
+		GenQueriesProc genQueries;
+		DeleteQueriesProc deleteQueries;
+		BeginQueryProc beginQuery;
+		EndQueryProc endQuery;
+		GetQueryObjectuivProc getQueryObjectuiv;
+		GetQueryObjectui64vProc getQueryObjectui64v;
+
+		TimerProcs() {
+			genQueries = (GenQueriesProc)eglGetProcAddress("glGenQueriesEXT");
+			deleteQueries = (DeleteQueriesProc)eglGetProcAddress("glDeleteQueriesEXT");
+			beginQuery = (BeginQueryProc)eglGetProcAddress("glBeginQueryEXT");
+			endQuery = (EndQueryProc)eglGetProcAddress("glEndQueryEXT");
+			getQueryObjectuiv = (GetQueryObjectuivProc)eglGetProcAddress("glGetQueryObjectuivEXT");
+			getQueryObjectui64v = (GetQueryObjectui64vProc)eglGetProcAddress("glGetQueryObjectui64vEXT");
+		}
+
+		bool loaded() const {
+			return genQueries && deleteQueries && beginQuery && endQuery &&
+				   getQueryObjectuiv && getQueryObjectui64v;
+		}
+	};
+
+	//Loaded on first use, when a context is current
+	const TimerProcs& timer() {
+		static TimerProcs procs;
+		return procs;
+	}
+
+	const char* pszVertShader = "\
+		attribute highp vec2	myVertex;\n\
+		varying mediump vec2	myTexCoord;\n\
+		void main(void)\n\
+		{\n\
+			gl_Position = vec4(myVertex * 2.0 - 1.0, 0.0, 1.0);\n\
+			myTexCoord = myVertex;\n\
+		}";
+
+	//myRegion: (render size / target size, 1 / target size).  Every tap is
+	//clamped half a texel inside the rendered region, since the texels
+	//around it hold older frames.
+	const char* pszFragShader = "\
+		uniform sampler2D sampler2d;\n\
+		uniform mediump vec4	myRegion;\n\
+		uniform mediump float	mySharpness;\n\
+		varying mediump vec2	myTexCoord;\n\
+		mediump vec3 tap(mediump vec2 uv)\n\
+		{\n\
+			mediump vec2 edge = 0.5 * myRegion.zw;\n\
+			return texture2D(sampler2d, clamp(uv, edge, myRegion.xy - edge)).rgb;\n\
+		}\n\
+		void main (void)\n\
+		{\n\
+			mediump vec2 uv = myTexCoord * myRegion.xy;\n\
+			mediump vec3 colour = tap(uv);\n\
+		#ifdef SHARPEN\n\
+			mediump vec3 north = tap(uv + vec2(0.0, myRegion.w));\n\
+			mediump vec3 south = tap(uv - vec2(0.0, myRegion.w));\n\
+			mediump vec3 east = tap(uv + vec2(myRegion.z, 0.0));\n\
+			mediump vec3 west = tap(uv - vec2(myRegion.z, 0.0));\n\
+			mediump vec3 lowest = min(colour, min(min(north, south), min(east, west)));\n\
+			mediump vec3 highest = max(colour, max(max(north, south), max(east, west)));\n\
+			mediump vec3 detail = colour - 0.25 * (north + south + east + west);\n\
+			colour = clamp(colour + mySharpness * detail, lowest, highest);\n\
+		#endif\n\
+			gl_FragColor = vec4(colour, 1.0);\n\
+		}";
+
+	GLuint buildUpscaleProgram(bool sharpen) {
+		string fragSrc = string(sharpen ? "#define SHARPEN\n" : "") + pszFragShader;
+		const char* attribs[] = { "myVertex" };
+		GLuint program = buildProgram(pszVertShader, fragSrc.c_str(), attribs, 1);
+		if (program) {
+			glUseProgram(program);
+			glUniform1i(glGetUniformLocation(program, "sampler2d"), 0);
+		}
+		return program;
+	}
+}
+
+DynamicResolution::DynamicResolution(int width_, int height_, float targetMs_, float minScale_, bool depth_) :
+	width(width_), height(height_), targetMs(targetMs_),
+	minScale(minScale_ < 0.1f ? 0.1f : (minScale_ > 1.0f ? 1.0f : minScale_)), depth(depth_),
+	currentScale(1.0f), targetWidth(width_), targetHeight(height_), filteredMs(0.0f), sharpness(0.0f),
+	texture(0), textures(NULL), textureHandle(INVALID_TEXTURE), depthBuffer(0), framebuffer(0), quadBuffer(0), bilinearProgram(0), sharpenProgram(0),
+	bilinearRegionLocation(-1), sharpenRegionLocation(-1), sharpnessLocation(-1),
+	nextQuery(0), timing(false), lastGpuMs(0.0f) {
+	for (int i = 0; i < QUERY_COUNT; i++) {
+		queries[i] = 0;
+		pending[i] = false;
+	}
+}
+
+DynamicResolution::~DynamicResolution() {
+	if (queries[0])
+		timer().deleteQueries(QUERY_COUNT, queries);
+	if (textures)
+		textures->release(textureHandle);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &depthBuffer);
+	glDeleteTextures(1, &texture);
+	glDeleteBuffers(1, &quadBuffer);
+	glDeleteProgram(bilinearProgram);
+	glDeleteProgram(sharpenProgram);
+}
+
+bool DynamicResolution::init(TextureManager* textures_) {
+	textures = textures_;
+	bilinearProgram = buildUpscaleProgram(false);
+	sharpenProgram = buildUpscaleProgram(true);
+	if (!bilinearProgram || !sharpenProgram)
+		return false;
+	bilinearRegionLocation = glGetUniformLocation(bilinearProgram, "myRegion");
+	sharpenRegionLocation = glGetUniformLocation(sharpenProgram, "myRegion");
+	sharpnessLocation = glGetUniformLocation(sharpenProgram, "mySharpness");
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	if (textures)
+		textureHandle = textures->track(texture, width, height);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	if (depth) {
+		glGenRenderbuffers(1, &depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	}
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (!complete)
+		return false;
+
+	const GLfloat quad[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+	glGenBuffers(1, &quadBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (hasExtension("GL_EXT_disjoint_timer_query") && timer().loaded())
+		timer().genQueries(QUERY_COUNT, queries);
+	resize();
+	return true;
+}
+
+void DynamicResolution::resize() {
+	int w = (int)(width * currentScale / SIZE_STEP + 0.5f) * SIZE_STEP;
+	int h = (int)(height * currentScale / SIZE_STEP + 0.5f) * SIZE_STEP;
+	targetWidth = w < SIZE_STEP ? SIZE_STEP : (w > width ? width : w);
+	targetHeight = h < SIZE_STEP ? SIZE_STEP : (h > height ? height : h);
+}
+
+//Takes the newest finished measurement, skipping any the GPU spoiled by a
+//disjoint event such as a frequency change, and any too long to be real;
+//some drivers return garbage for the first query of a context
+void DynamicResolution::readQueries() {
+	GLint disjoint = 0;
+	glGetIntegerv(GPU_DISJOINT_EXT, &disjoint);
+	//Oldest first: nextQuery is the slot begin() is about to reuse
+	for (int i = 0; i < QUERY_COUNT; i++) {
+		int slot = (nextQuery + i) % QUERY_COUNT;
+		if (!pending[slot])
+			continue;
+		GLuint available = 0;
+		timer().getQueryObjectuiv(queries[slot], QUERY_RESULT_AVAILABLE_EXT, &available);
+		if (!available)
+			break;
+		unsigned long long nanoseconds = 0;
+		timer().getQueryObjectui64v(queries[slot], QUERY_RESULT_EXT, &nanoseconds);
+		pending[slot] = false;
+		if (!disjoint && nanoseconds < MAX_GPU_NANOSECONDS)
+			lastGpuMs = (float)(nanoseconds / 1.0e6);
+	}
+}
+
+void DynamicResolution::begin() {
+	if (queries[0]) {
+		readQueries();
+		//A slot still waiting for its result is reused; that frame goes unmeasured
+		pending[nextQuery] = true;
+		timer().beginQuery(TIME_ELAPSED_EXT, queries[nextQuery]);
+		timing = true;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, targetWidth, targetHeight);
+}
+
+void DynamicResolution::end(GLuint output) {
+	glBindFramebuffer(GL_FRAMEBUFFER, output);
+	glViewport(0, 0, width, height);
+
+	GLfloat region[4] = {
+		(GLfloat)targetWidth / width, (GLfloat)targetHeight / height,
+		1.0f / width, 1.0f / height
+	};
+	//Nothing to sharpen when the scene is at the full resolution
+	if (sharpness > 0.0f && (targetWidth < width || targetHeight < height)) {
+		glUseProgram(sharpenProgram);
+		glUniform4fv(sharpenRegionLocation, 1, region);
+		glUniform1f(sharpnessLocation, sharpness);
+	}
+	else {
+		glUseProgram(bilinearProgram);
+		glUniform4fv(bilinearRegionLocation, 1, region);
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+	glEnableVertexAttribArray(VERTEX_ARRAY);
+	glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DynamicResolution::endTiming() {
+	if (timing) {
+		timer().endQuery(TIME_ELAPSED_EXT);
+		nextQuery = (nextQuery + 1) % QUERY_COUNT;
+		timing = false;
+	}
+}
+
+void DynamicResolution::update(float cpuMs) {
+	float ms = cpuMs > lastGpuMs ? cpuMs : lastGpuMs;
+	//Without GPU timing the frame time includes the wait for the swap, so a
+	//frame that made its vsync reads as the whole interval whatever it cost.
+	//Count those as having headroom: the scale climbs until frames miss.
+	if (!gpuTimed() && ms <= targetMs * VSYNC_SLACK)
+		ms = targetMs * HEADROOM * HEADROOM;
+	filteredMs = filteredMs > 0.0f ? filteredMs + (ms - filteredMs) * SMOOTHING : ms;
+	if (filteredMs <= 0.0f)
+		return;
+
+	//Cost goes with the area, so the scale goes with the root of the time
+	float wanted = currentScale * sqrtf(targetMs * HEADROOM / filteredMs);
+	if (filteredMs > targetMs)
+		currentScale = wanted;
+	else if (filteredMs < targetMs * HEADROOM)
+		currentScale = wanted < currentScale + MAX_STEP_UP ? wanted : currentScale + MAX_STEP_UP;
+	currentScale = currentScale < minScale ? minScale : (currentScale > 1.0f ? 1.0f : currentScale);
+	resize();
+}
@@ -0,0 +1,104 @@
+#ifndef DYNAMIC_RESOLUTION_H_INCLUDED
+#define DYNAMIC_RESOLUTION_H_INCLUDED
+
+#include <GLES2/gl2.h>
+#include "texturemanager.h"
+
+/* Renders a scene below the surface resolution when frames run over budget,
+ * and scales it back up to the surface.
+ *
+ * The offscreen target is allocated once at the full output size; a lower
+ * resolution only shrinks the viewport within it, so changing the scale
+ * never reallocates anything.  Sizes are rounded to multiples of 8 pixels
+ * so the scale moves in visible steps rather than shimmering every frame.
+ *
+ * update() compares the frame time with the target and picks the next
+ * scale.  Fill cost goes with the pixel count, so the scale moves with the
+ * square root of the time ratio: it drops at once when a frame runs over,
+ * and climbs back at most a few percent a frame while there is headroom.
+ * The GPU time of the frame is measured with GL_EXT_disjoint_timer_query
+ * when the driver has it, read a few frames late so it never stalls;
+ * otherwise only the CPU time passed to update() is seen.
+ *
+ * The upscale is one draw of a bilinear quad, or with a sharpness above 0
+ * a 5-tap unsharp mask clamped to the neighbouring texels so it can't ring.
+ */
+class DynamicResolution {
+	public:
+		//width, height: output size and the most the scene is rendered at.
+		//targetMs: frame budget.  minScale: lowest fraction of the width.
+		DynamicResolution(int width, int height, float targetMs = 1000.0f / 60.0f,
+						  float minScale = 0.5f, bool depth = false);
+		~DynamicResolution();
+
+		//Creates the target, programs and timer queries; needs a current
+		//context.  With textures, the target is track()ed in it until the
+		//scaler is deleted.
+		bool init(TextureManager* textures = NULL);
+
+		//Binds the target with the viewport at the current resolution and
+		//starts timing the frame's GPU work
+		void begin();
+
+		//Binds output, the window surface by default, and draws the
+		//upscaled scene over a viewport of width x height at 0, 0.  Leaves
+		//the upscale program bound.
+		void end(GLuint output = 0);
+
+		//Stops timing the frame's GPU work.  Call it once everything the
+		//frame draws is issued, post-processing after end() included, so
+		//the budget covers the whole frame.
+		void endTiming();
+
+		//Chooses the resolution of the next frame.  cpuMs is the CPU time
+		//of the frame without the wait for the swap; without GPU timing,
+		//pass the whole frame time instead, with targetMs the swap
+		//interval: frames within it then count as on budget.
+		void update(float cpuMs);
+
+		//0 for a plain bilinear upscale, up to 1 for the strongest sharpening
+		void setSharpness(float amount) { sharpness = amount; }
+
+		float scale() const { return currentScale; }
+		int renderWidth() const { return targetWidth; }
+		int renderHeight() const { return targetHeight; }
+		bool gpuTimed() const { return queries[0] != 0; }
+		float gpuMs() const { return lastGpuMs; }
+
+	private:
+		enum { QUERY_COUNT = 4 };
+
+		void resize();
+		void readQueries();
+
+		int width;
+		int height;
+		float targetMs;
+		float minScale;
+		bool depth;
+		float currentScale;
+		int targetWidth;
+		int targetHeight;
+		float filteredMs;
+		float sharpness;
+
+		GLuint texture;
+		TextureManager* textures;
+		TextureHandle textureHandle;
+		GLuint depthBuffer;
+		GLuint framebuffer;
+		GLuint quadBuffer;
+		GLuint bilinearProgram;
+		GLuint sharpenProgram;
+		GLint bilinearRegionLocation;
+		GLint sharpenRegionLocation;
+		GLint sharpnessLocation;
+
+		GLuint queries[QUERY_COUNT];
+		bool pending[QUERY_COUNT];
+		int nextQuery;
+		bool timing;		//Between begin() and endTiming()
+		float lastGpuMs;
+};
+
+#endif
@@ -0,0 +1,288 @@
+#include "stdafx.h"
+#include <string.h>
+#include "etcencoder.h"
+#include "jobsystem.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define ETC_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+	//Intensity modifiers of the eight ETC1 tables
+	const int MODIFIERS[8][2] = {
+		{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 },
+		{ 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+	};
+
+	int clamp255(int value) {
+		return value < 0 ? 0 : (value > 255 ? 255 : value);
+	}
+
+	//The offset a texel index selects; index bits are (msb, lsb)
+	int modifier(int table, int index) {
+		int magnitude = MODIFIERS[table][index & 1];
+		return (index & 2) ? -magnitude : magnitude;
+	}
+
+	//The 8 texels of one subblock, one channel per array
+	struct Subblock {
+		short r[8];
+		short g[8];
+		short b[8];
+		int position[8];	//Bit position x * 4 + y of every texel in the block
+	};
+
+	//Best table for a subblock around a base colour.  Fills in the texel
+	//indices and returns the squared error.
+	int fitSubblock(const Subblock& sub, const int base[3], int* bestTable, int indices[8]) {
+		int bestError = 0x7fffffff;
+		for (int table = 0; table < 8; table++) {
+			int tableIndices[8];
+			int error = 0;
+#ifdef ETC_USE_SSE2
+			__m128i r = _mm_loadu_si128((const __m128i*)sub.r);
+			__m128i g = _mm_loadu_si128((const __m128i*)sub.g);
+			__m128i b = _mm_loadu_si128((const __m128i*)sub.b);
+			__m128i zero = _mm_setzero_si128();
+			__m128i bestLo = _mm_set1_epi32(0x7fffffff);
+			__m128i bestHi = bestLo;
+			__m128i indexLo = zero;
+			__m128i indexHi = zero;
+			for (int index = 0; index < 4; index++) {
+				int offset = modifier(table, index);
+				__m128i dr = _mm_sub_epi16(r, _mm_set1_epi16((short)clamp255(base[0] + offset)));
+				__m128i dg = _mm_sub_epi16(g, _mm_set1_epi16((short)clamp255(base[1] + offset)));
+				__m128i db = _mm_sub_epi16(b, _mm_set1_epi16((short)clamp255(base[2] + offset)));
+
+				//dr*dr + dg*dg + db*db as 32-bit lanes, four texels per register
+				__m128i rgLo = _mm_unpacklo_epi16(dr, dg);
+				__m128i rgHi = _mm_unpackhi_epi16(dr, dg);
+				__m128i bLo = _mm_unpacklo_epi16(db, zero);
+				__m128i bHi = _mm_unpackhi_epi16(db, zero);
+				__m128i errorLo = _mm_add_epi32(_mm_madd_epi16(rgLo, rgLo), _mm_madd_epi16(bLo, bLo));
+				__m128i errorHi = _mm_add_epi32(_mm_madd_epi16(rgHi, rgHi), _mm_madd_epi16(bHi, bHi));
+
+				__m128i betterLo = _mm_cmpgt_epi32(bestLo, errorLo);
+				__m128i betterHi = _mm_cmpgt_epi32(bestHi, errorHi);
+				__m128i indexValue = _mm_set1_epi32(index);
+				bestLo = _mm_or_si128(_mm_and_si128(betterLo, errorLo), _mm_andnot_si128(betterLo, bestLo));
+				bestHi = _mm_or_si128(_mm_and_si128(betterHi, errorHi), _mm_andnot_si128(betterHi, bestHi));
+				indexLo = _mm_or_si128(_mm_and_si128(betterLo, indexValue), _mm_andnot_si128(betterLo, indexLo));
+				indexHi = _mm_or_si128(_mm_and_si128(betterHi, indexValue), _mm_andnot_si128(betterHi, indexHi));
+			}
+			int errors[8];
+			_mm_storeu_si128((__m128i*)errors, bestLo);
+			_mm_storeu_si128((__m128i*)(errors + 4), bestHi);
+			_mm_storeu_si128((__m128i*)tableIndices, indexLo);
+			_mm_storeu_si128((__m128i*)(tableIndices + 4), indexHi);
+			for (int i = 0; i < 8; i++)
+				error += errors[i];
+#else
+			for (int i = 0; i < 8; i++) {
+				int texelBest = 0x7fffffff;
+				for (int index = 0; index < 4; index++) {
+					int offset = modifier(table, index);
+					int dr = sub.r[i] - clamp255(base[0] + offset);
+					int dg = sub.g[i] - clamp255(base[1] + offset);
+					int db = sub.b[i] - clamp255(base[2] + offset);
+					int texelError = dr * dr + dg * dg + db * db;
+					if (texelError < texelBest) {
+						texelBest = texelError;
+						tableIndices[i] = index;
+					}
+				}
+				error += texelBest;
+			}
+#endif
+			if (error < bestError) {
+				bestError = error;
+				*bestTable = table;
+				memcpy(indices, tableIndices, sizeof(tableIndices));
+			}
+		}
+		return bestError;
+	}
+
+	//One candidate encoding of a block
+	struct BlockFit {
+		int error;
+		bool differential;
+		bool flip;
+		int color[2][3];	//Quantised colours, 4 or 5 bits per channel
+		int table[2];
+		int indices[2][8];
+	};
+
+	void average(const Subblock& sub, float avg[3]) {
+		int sum[3] = { 0, 0, 0 };
+		for (int i = 0; i < 8; i++) {
+			sum[0] += sub.r[i];
+			sum[1] += sub.g[i];
+			sum[2] += sub.b[i];
+		}
+		for (int c = 0; c < 3; c++)
+			avg[c] = sum[c] / 8.0f;
+	}
+
+	//Fits both subblocks with the given quantised colours
+	void fitBlock(const Subblock subs[2], BlockFit& fit) {
+		fit.error = 0;
+		for (int s = 0; s < 2; s++) {
+			int base[3];
+			for (int c = 0; c < 3; c++) {
+				int q = fit.color[s][c];
+				base[c] = fit.differential ? (q << 3) | (q >> 2) : (q << 4) | q;
+			}
+			fit.error += fitSubblock(subs[s], base, &fit.table[s], fit.indices[s]);
+		}
+	}
+
+	void writeBlock(const BlockFit& fit, const Subblock subs[2], unsigned char* out) {
+		unsigned int high = 0;
+		if (fit.differential) {
+			for (int c = 0; c < 3; c++) {
+				int delta = fit.color[1][c] - fit.color[0][c];
+				high |= (unsigned int)fit.color[0][c] << (27 - 8 * c);
+				high |= (unsigned int)(delta & 7) << (24 - 8 * c);
+			}
+		}
+		else {
+			for (int c = 0; c < 3; c++) {
+				high |= (unsigned int)fit.color[0][c] << (28 - 8 * c);
+				high |= (unsigned int)fit.color[1][c] << (24 - 8 * c);
+			}
+		}
+		high |= fit.table[0] << 5;
+		high |= fit.table[1] << 2;
+		high |= (fit.differential ? 1 : 0) << 1;
+		high |= fit.flip ? 1 : 0;
+
+		unsigned int low = 0;
+		for (int s = 0; s < 2; s++) {
+			for (int i = 0; i < 8; i++) {
+				int bit = subs[s].position[i];
+				int index = fit.indices[s][i];
+				low |= (unsigned int)((index >> 1) & 1) << (bit + 16);
+				low |= (unsigned int)(index & 1) << bit;
+			}
+		}
+
+		//Blocks are stored big-endian
+		for (int i = 0; i < 4; i++) {
+			out[i] = (unsigned char)(high >> (24 - 8 * i));
+			out[4 + i] = (unsigned char)(low >> (24 - 8 * i));
+		}
+	}
+
+	void encodeBlock(const unsigned char* rgb, int width, int height,
+					 int blockX, int blockY, unsigned char* out) {
+		//Texels past the edge repeat the last row and column
+		unsigned char texels[4][4][3];
+		for (int y = 0; y < 4; y++) {
+			int sy = blockY * 4 + y < height ? blockY * 4 + y : height - 1;
+			for (int x = 0; x < 4; x++) {
+				int sx = blockX * 4 + x < width ? blockX * 4 + x : width - 1;
+				memcpy(texels[y][x], rgb + 3 * (sy * width + sx), 3);
+			}
+		}
+
+		BlockFit best;
+		best.error = 0x7fffffff;
+		for (int flip = 0; flip < 2; flip++) {
+			//Without flip the subblocks are the left and right 2x4 halves,
+			//with flip the top and bottom 4x2 halves
+			Subblock subs[2];
+			int count[2] = { 0, 0 };
+			for (int y = 0; y < 4; y++) {
+				for (int x = 0; x < 4; x++) {
+					int s = flip ? (y >= 2) : (x >= 2);
+					Subblock& sub = subs[s];
+					sub.r[count[s]] = texels[y][x][0];
+					sub.g[count[s]] = texels[y][x][1];
+					sub.b[count[s]] = texels[y][x][2];
+					sub.position[count[s]] = x * 4 + y;
+					count[s]++;
+				}
+			}
+
+			float avg[2][3];
+			average(subs[0], avg[0]);
+			average(subs[1], avg[1]);
+
+			//Individual mode, 4 bits per channel and subblock
+			BlockFit fit;
+			fit.flip = flip != 0;
+			fit.differential = false;
+			for (int s = 0; s < 2; s++)
+				for (int c = 0; c < 3; c++)
+					fit.color[s][c] = (int)(avg[s][c] * 15.0f / 255.0f + 0.5f);
+			fitBlock(subs, fit);
+			if (fit.error < best.error)
+				best = fit;
+
+			//Differential mode, 5 bits plus a 3-bit signed delta
+			fit.differential = true;
+			bool representable = true;
+			for (int c = 0; c < 3; c++) {
+				fit.color[0][c] = (int)(avg[0][c] * 31.0f / 255.0f + 0.5f);
+				fit.color[1][c] = (int)(avg[1][c] * 31.0f / 255.0f + 0.5f);
+				int delta = fit.color[1][c] - fit.color[0][c];
+				if (delta < -4 || delta > 3)
+					representable = false;
+			}
+			if (representable) {
+				fitBlock(subs, fit);
+				if (fit.error < best.error)
+					best = fit;
+			}
+		}
+
+		//Rebuild the subblock layout of the winning orientation for the index bits
+		Subblock subs[2];
+		int count[2] = { 0, 0 };
+		for (int y = 0; y < 4; y++) {
+			for (int x = 0; x < 4; x++) {
+				int s = best.flip ? (y >= 2) : (x >= 2);
+				subs[s].position[count[s]++] = x * 4 + y;
+			}
+		}
+		writeBlock(best, subs, out);
+	}
+
+	void encodeRows(const unsigned char* rgb, int width, int height,
+					int firstRow, int lastRow, unsigned char* out) {
+		int blocksX = (width + 3) / 4;
+		for (int by = firstRow; by < lastRow; by++) {
+			for (int bx = 0; bx < blocksX; bx++)
+				encodeBlock(rgb, width, height, bx, by, out + 8 * (by * blocksX + bx));
+		}
+	}
+}
+
+int etc1ImageSize(int width, int height) {
+	return ((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+void encodeETC1(const char* rgb, int width, int height, char* out, int threads) {
+	int blocksY = (height + 3) / 4;
+	const unsigned char* pixels = (const unsigned char*)rgb;
+	unsigned char* blocks = (unsigned char*)out;
+	parallelRanges(blocksY, threads, [&](int firstRow, int lastRow) {
+		encodeRows(pixels, width, height, firstRow, lastRow, blocks);
+	});
+}
+
+KTXTexture* compressETC1(const Image* image, int threads) {
+	KTXTexture* texture = new KTXTexture();
+	texture->glInternalFormat = GL_ETC1_RGB8_OES;
+	texture->glBaseInternalFormat = GL_RGB;
+	texture->width = image->width;
+	texture->height = image->height;
+	texture->levels.resize(1);
+	texture->levels[0].resize(etc1ImageSize(image->width, image->height));
+	encodeETC1(image->pixels, image->width, image->height, &texture->levels[0][0], threads);
+	return texture;
+}
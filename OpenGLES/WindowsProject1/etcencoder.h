@@ -0,0 +1,31 @@
+#ifndef ETC_ENCODER_H_INCLUDED
+#define ETC_ENCODER_H_INCLUDED
+
+#include "imageloader.h"
+#include "ktx.h"
+
+/* ETC1 block compressor.
+ *
+ * ETC1 stores every 4x4 block in 8 bytes, 4 bits per texel against the 24
+ * of loadBMP's RGB, and GPUs sample it without decompressing to memory.  Any
+ * ES 3.0 driver decodes it as GL_COMPRESSED_RGB8_ETC2, which is a superset.
+ *
+ * For every block the encoder tries both subblock orientations in both
+ * individual and differential colour mode and picks, per subblock, the
+ * modifier table with the smallest squared RGB error.  The per-texel search
+ * runs on SSE2 when available and block rows are split across jobs.
+ */
+
+//Bytes of an ETC1 level of the given size, partial blocks included
+int etc1ImageSize(int width, int height);
+
+//Compresses tightly packed RGB rows (the layout of Image::pixels) into
+//etc1ImageSize(width, height) bytes, keeping the row order of the input.
+//Block rows are split into threads jobs, threads <= 0 letting the job
+//system choose.
+void encodeETC1(const char* rgb, int width, int height, char* out, int threads = 0);
+
+//Compresses an image into a single level GL_ETC1_RGB8_OES texture
+KTXTexture* compressETC1(const Image* image, int threads = 0);
+
+#endif
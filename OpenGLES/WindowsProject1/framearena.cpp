@@ -0,0 +1,20 @@
+#include "stdafx.h"
+#include "framearena.h"
+
+FrameArena::FrameArena(size_t blockSize) :
+	even(blockSize), odd(blockSize), current(&even), previous(&odd), frames(0), peak(0) {
+}
+
+void FrameArena::beginFrame() {
+	if (current->used() > peak)
+		peak = current->used();
+
+	LinearArena* recycled = previous;
+	previous = current;
+	current = recycled;
+	current->reset();
+#if FRAME_ARENA_SCRIBBLE
+	current->scribble(0xcd);
+#endif
+	frames++;
+}
@@ -0,0 +1,53 @@
+#ifndef FRAME_ARENA_H_INCLUDED
+#define FRAME_ARENA_H_INCLUDED
+
+#include "arena.h"
+
+//Debug builds scribble over a frame's memory when it is recycled
+#if defined(_DEBUG) && !defined(FRAME_ARENA_SCRIBBLE)
+#define FRAME_ARENA_SCRIBBLE 1
+#endif
+
+/* Memory for data that lives one frame: tessellated vertices, draw lists,
+ * matrices staged for upload.
+ *
+ * Two LinearArenas take turns.  beginFrame() switches to the other one and
+ * rewinds it in constant time, so an allocation stays valid through the
+ * frame after the one that made it, long enough for a render thread or
+ * the GL driver to finish reading it.  Blocks are kept, so once the arenas
+ * have grown to the busiest frame, frames allocate nothing from the heap;
+ * heapBlocks() stops changing when that is the case.
+ */
+class FrameArena {
+	public:
+		explicit FrameArena(size_t blockSize = 256 * 1024);
+
+		//Starts a frame, recycling the memory of the frame before last
+		void beginFrame();
+
+		void* allocate(size_t bytes, size_t alignment = 16) {
+			return current->allocate(bytes, alignment);
+		}
+		template<class T>
+		T* allocate(size_t count = 1) {
+			return current->allocate<T>(count);
+		}
+
+		//Bytes allocated since beginFrame()
+		size_t frameBytes() const { return current->used(); }
+		//Most bytes any finished frame allocated
+		size_t highWater() const { return peak; }
+		size_t capacity() const { return even.capacity() + odd.capacity(); }
+		int heapBlocks() const { return even.blockCount() + odd.blockCount(); }
+		int frame() const { return frames; }
+
+	private:
+		LinearArena even;
+		LinearArena odd;
+		LinearArena* current;
+		LinearArena* previous;
+		int frames;
+		size_t peak;
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <string.h>
+#include <EGL/egl.h>
+#include "glprogram.h"
+#include <GLES2/gl2ext.h>
+
+namespace {
+	GLuint compileShader(const char* shaderSrc, GLenum type) {
+		GLuint shader = glCreateShader(type);
+		if (shader == 0)
+			return 0;
+		glShaderSource(shader, 1, &shaderSrc, NULL);
+		glCompileShader(shader);
+
+		GLint compiled;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+		if (!compiled) {
+			GLint infoLen = 0;
+			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
+			if (infoLen > 1) {
+				char* infoLog = new char[infoLen];
+				glGetShaderInfoLog(shader, infoLen, NULL, infoLog);
+				printf("Error compiling shader:\n%s\n", infoLog);
+				delete[] infoLog;
+			}
+			glDeleteShader(shader);
+			return 0;
+		}
+		return shader;
+	}
+}
+
+GLuint buildProgram(const char* vertSrc, const char* fragSrc,
+					const char* const* attribs, int attribCount) {
+	GLuint vertexShader = compileShader(vertSrc, GL_VERTEX_SHADER);
+	GLuint fragmentShader = compileShader(fragSrc, GL_FRAGMENT_SHADER);
+	if (!vertexShader || !fragmentShader) {
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	for (int i = 0; i < attribCount; i++)
+		glBindAttribLocation(program, i, attribs[i]);
+	glLinkProgram(program);
+
+	//The program keeps the shaders for as long as it needs them
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint linked;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		GLint infoLen = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLen);
+		if (infoLen > 1) {
+			char* infoLog = new char[infoLen];
+			glGetProgramInfoLog(program, infoLen, NULL, infoLog);
+			printf("Error linking program:\n%s\n", infoLog);
+			delete[] infoLog;
+		}
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+GLuint loadProgramBinary(GLenum format, const void* binary, int length) {
+	static PFNGLPROGRAMBINARYOESPROC programBinary =
+		(PFNGLPROGRAMBINARYOESPROC)eglGetProcAddress("glProgramBinaryOES");
+	if (!programBinary || !binary || length <= 0)
+		return 0;
+
+	GLuint program = glCreateProgram();
+	programBinary(program, format, binary, length);
+	GLint linked;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+bool hasExtension(const char* name) {
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	if (!extensions)
+		return false;
+	size_t length = strlen(name);
+	for (const char* found = strstr(extensions, name); found; found = strstr(found + length, name)) {
+		if ((found == extensions || found[-1] == ' ') &&
+			(found[length] == ' ' || found[length] == '\0'))
+			return true;
+	}
+	return false;
+}
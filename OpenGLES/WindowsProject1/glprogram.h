@@ -0,0 +1,19 @@
+#ifndef GL_PROGRAM_H_INCLUDED
+#define GL_PROGRAM_H_INCLUDED
+
+#include <GLES2/gl2.h>
+
+//Compiles both shaders and links them into a program, binding attribs[i] to
+//attribute location i.  Returns 0 and prints the info log if anything fails.
+GLuint buildProgram(const char* vertSrc, const char* fragSrc,
+					const char* const* attribs, int attribCount);
+
+//Creates a program from a binary saved with glGetProgramBinaryOES.  Returns 0
+//without GL_OES_get_program_binary or if the driver rejects the binary, as
+//it may after a driver update; build the program from source then.
+GLuint loadProgramBinary(GLenum format, const void* binary, int length);
+
+//True if the current context lists the extension name in GL_EXTENSIONS
+bool hasExtension(const char* name);
+
+#endif
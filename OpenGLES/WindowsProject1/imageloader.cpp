@@ -26,6 +26,7 @@
 #include <fstream>
 
 #include "imageloader.h"
+#include "jobsystem.h"
 
 using namespace std;
 
@@ -132,7 +133,7 @@ namespace {
 	};
 }
 
-Image* loadBMP(const char* filename) {
+Image* loadBMP(const char* filename, int threads) {
 	ifstream input;
 	input.open(filename, ifstream::binary);
 	assert(!input.fail() || !"Could not find file");
@@ -178,8 +179,8 @@ Image* loadBMP(const char* filename) {
 			assert(!"Unknown bitmap format");
 	}
 	
-	//Read the data
-	int bytesPerRow = ((width * 3 + 3) / 4) * 4 - (width * 3 % 4);
+	//Read the data; every row is padded to a multiple of 4 bytes
+	int bytesPerRow = (width * 3 + 3) & ~3;
 	int size = bytesPerRow * height;
 	auto_array<char> pixels(new char[size]);
 	input.seekg(dataOffset, ios_base::beg);
@@ -187,14 +188,18 @@ Image* loadBMP(const char* filename) {
 	
 	//Get the data into the right format
 	auto_array<char> pixels2(new char[width * height * 3]);
-	for(int y = 0; y < height; y++) {
-		for(int x = 0; x < width; x++) {
-			for(int c = 0; c < 3; c++) {
-				pixels2[3 * (width * y + x) + c] =
-					pixels[bytesPerRow * y + 3 * x + (2 - c)];
+	const char* source = pixels.get();
+	char* target = pixels2.get();
+	parallelRanges(height, threads, [&](int first, int last) {
+		for(int y = first; y < last; y++) {
+			for(int x = 0; x < width; x++) {
+				for(int c = 0; c < 3; c++) {
+					target[3 * (width * y + x) + c] =
+						source[bytesPerRow * y + 3 * x + (2 - c)];
+				}
 			}
 		}
-	}
+	});
 	
 	input.close();
 	return new Image(pixels2.release(), width, height);
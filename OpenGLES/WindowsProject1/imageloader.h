@@ -42,8 +42,9 @@ class Image {
 		int height;
 };
 
-//Reads a bitmap image from file.
-Image* loadBMP(const char* filename);
+//Reads a bitmap image from file.  The rows are converted to RGB in threads
+//jobs, threads <= 0 letting the job system choose.
+Image* loadBMP(const char* filename, int threads = 0);
 
 
 
@@ -0,0 +1,184 @@
+#include "stdafx.h"
+#include "jobsystem.h"
+
+using namespace std;
+
+namespace {
+	//Pool and queue of the worker running on this thread, if any
+	thread_local JobSystem* currentSystem = NULL;
+	thread_local int currentQueue = 0;
+}
+
+JobSystem::JobSystem(int threads) : queued(0), sleeping(0), waiting(0), stopping(false) {
+	if (threads <= 0)
+		threads = (int)thread::hardware_concurrency();
+	if (threads <= 0)
+		threads = 1;
+	for (int i = 0; i < threads; i++)
+		queues.push_back(new Queue());
+	for (int i = 1; i < threads; i++)
+		workers.push_back(thread(&JobSystem::workerLoop, this, i));
+}
+
+JobSystem::~JobSystem() {
+	{
+		lock_guard<mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wakeup.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	for (size_t i = 0; i < queues.size(); i++)
+		delete queues[i];
+}
+
+int JobSystem::queueIndex() const {
+	return currentSystem == this ? currentQueue : 0;
+}
+
+void JobSystem::push(const Job& job) {
+	//Counted before it is visible, so queued never drops below zero.  Pairs
+	//with the sleeping++ before a worker checks queued: either the worker
+	//sees the job or we see the worker.
+	queued++;
+	Queue* queue = queues[queueIndex()];
+	{
+		lock_guard<mutex> lock(queue->mutex);
+		queue->jobs.push_back(job);
+	}
+	if (sleeping.load() > 0) {
+		lock_guard<mutex> lock(sleepMutex);
+		wakeup.notify_one();
+	}
+}
+
+bool JobSystem::pop(Job* job) {
+	if (queued.load() == 0)
+		return false;
+
+	//Newest job of our own queue first
+	int own = queueIndex();
+	{
+		Queue* queue = queues[own];
+		lock_guard<mutex> lock(queue->mutex);
+		if (!queue->jobs.empty()) {
+			*job = queue->jobs.back();
+			queue->jobs.pop_back();
+			queued--;
+			return true;
+		}
+	}
+
+	//Then steal the oldest job of another queue
+	for (size_t i = 1; i < queues.size(); i++) {
+		Queue* queue = queues[(own + i) % queues.size()];
+		lock_guard<mutex> lock(queue->mutex);
+		if (!queue->jobs.empty()) {
+			*job = queue->jobs.front();
+			queue->jobs.pop_front();
+			queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::execute(const Job& job) {
+	job.function(job.data, job.first, job.last);
+	JobCounter* counter = job.counter;
+	if (!counter)
+		return;
+
+	//Last job of the counter: release what was waiting on it, after letting
+	//go of the counter so the continuations may free it
+	vector<Job> ready;
+	if (--counter->pending == 0) {
+		lock_guard<mutex> lock(counter->mutex);
+		ready.swap(counter->continuations);
+	}
+	//Pairs with the waiting++ before wait() checks the counter: either the
+	//waiter sees it done or we see the waiter
+	if (--counter->unfinished == 0 && waiting.load() > 0) {
+		lock_guard<mutex> lock(sleepMutex);
+		wakeup.notify_all();
+	}
+	for (size_t i = 0; i < ready.size(); i++)
+		push(ready[i]);
+}
+
+void JobSystem::run(JobFunction function, void* data, int first, int last, JobCounter* counter) {
+	Job job = { function, data, first, last, counter };
+	if (counter) {
+		counter->pending++;
+		counter->unfinished++;
+	}
+	push(job);
+}
+
+void JobSystem::runAfter(JobCounter* dependency, JobFunction function, void* data,
+						 int first, int last, JobCounter* counter) {
+	Job job = { function, data, first, last, counter };
+	if (counter) {
+		counter->pending++;
+		counter->unfinished++;
+	}
+	{
+		//The last job of dependency takes this lock after dropping pending
+		//to zero, so the job is either seen by it or queued here
+		lock_guard<mutex> lock(dependency->mutex);
+		if (dependency->pending.load() > 0) {
+			dependency->continuations.push_back(job);
+			return;
+		}
+	}
+	push(job);
+}
+
+void JobSystem::wait(JobCounter* counter) {
+	while (!counter->done()) {
+		Job job;
+		if (pop(&job)) {
+			execute(job);
+			continue;
+		}
+
+		//The counter's jobs left are running elsewhere; sleep until one of
+		//them is the last or queues more work to help with
+		waiting++;
+		sleeping++;
+		{
+			unique_lock<mutex> lock(sleepMutex);
+			while (queued.load() == 0 && !counter->done())
+				wakeup.wait(lock);
+		}
+		sleeping--;
+		waiting--;
+	}
+}
+
+void JobSystem::workerLoop(int index) {
+	currentSystem = this;
+	currentQueue = index;
+	for (;;) {
+		Job job;
+		if (pop(&job)) {
+			execute(job);
+			continue;
+		}
+
+		sleeping++;
+		{
+			unique_lock<mutex> lock(sleepMutex);
+			while (queued.load() == 0 && !stopping)
+				wakeup.wait(lock);
+		}
+		sleeping--;
+		if (stopping)
+			return;
+	}
+}
+
+JobSystem& jobSystem() {
+	static JobSystem system;
+	return system;
+}
@@ -0,0 +1,147 @@
+#ifndef JOB_SYSTEM_H_INCLUDED
+#define JOB_SYSTEM_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+//Work on the items [first, last) of whatever data points to
+typedef void (*JobFunction)(void* data, int first, int last);
+
+struct Job {
+	JobFunction function;
+	void* data;
+	int first;
+	int last;
+	JobCounter* counter;	//Decremented when the job finishes, may be NULL
+};
+
+/* Counts the unfinished jobs started with it.  Jobs can be made to wait for
+ * a counter with JobSystem::runAfter(); they are queued the moment it drops
+ * to zero.  A counter must outlive its jobs and can be reused once done.
+ */
+class JobCounter {
+	public:
+		JobCounter() : pending(0), unfinished(0) {}
+
+		bool done() const { return unfinished.load() == 0; }
+
+	private:
+		friend class JobSystem;
+
+		//pending drops when a job's function returns and decides when the
+		//continuations run; unfinished drops after that, as the job's last
+		//access to the counter, so a waiter can free it once done()
+		std::atomic<int> pending;
+		std::atomic<int> unfinished;
+		std::mutex mutex;
+		std::vector<Job> continuations;	//Queued by runAfter() until done
+};
+
+/* A work-stealing thread pool.
+ *
+ * Every worker owns a deque; jobs started by a worker go to the back of its
+ * own deque and it takes work from the back too, so related jobs run hot in
+ * its cache.  An idle worker steals from the front of the other deques,
+ * where the oldest and usually largest pieces of work are.  Threads outside
+ * the pool share one more deque.  wait() runs queued jobs while there are
+ * any, so waiting inside a job can't deadlock the pool, and only sleeps
+ * once the rest of its work is running on other threads.
+ *
+ * Jobs are a function pointer plus a range, not std::function, so starting
+ * one does no heap allocation.
+ */
+class JobSystem {
+	public:
+		//threads <= 0 makes one worker per core.  The thread calling wait()
+		//works as well, so threads - 1 workers are started.
+		explicit JobSystem(int threads = 0);
+		~JobSystem();
+
+		//Queues function(data, first, last); counter, if given, is
+		//incremented now and decremented when the job has run
+		void run(JobFunction function, void* data, int first, int last, JobCounter* counter);
+
+		//Like run() but only queues the job once dependency is done
+		void runAfter(JobCounter* dependency, JobFunction function, void* data,
+					  int first, int last, JobCounter* counter);
+
+		//Runs queued jobs until counter is done.  With none left to run it
+		//sleeps until more are queued or counter's last job finishes.
+		void wait(JobCounter* counter);
+
+		//Calls body(first, last) over [0, count) in ranges of about grain
+		//items, grain <= 0 picking four ranges per thread, and returns when
+		//all are done.  The calling thread takes part.
+		template<class Body>
+		void parallelFor(int count, int grain, const Body& body) {
+			if (count <= 0)
+				return;
+			if (grain <= 0)
+				grain = (count + 4 * threadCount() - 1) / (4 * threadCount());
+			if (grain >= count) {
+				body(0, count);
+				return;
+			}
+			JobCounter counter;
+			for (int first = 0; first < count; first += grain)
+				run(&invokeBody<Body>, (void*)&body, first, first + grain < count ? first + grain : count, &counter);
+			wait(&counter);
+		}
+
+		int threadCount() const { return (int)workers.size() + 1; }
+
+	private:
+		//One deque per worker, plus queues[0] for threads outside the pool
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		template<class Body>
+		static void invokeBody(void* data, int first, int last) {
+			(*(const Body*)data)(first, last);
+		}
+
+		JobSystem(const JobSystem&);
+		JobSystem& operator=(const JobSystem&);
+
+		void push(const Job& job);
+		bool pop(Job* job);
+		void execute(const Job& job);
+		void workerLoop(int index);
+		int queueIndex() const;
+
+		std::vector<std::thread> workers;
+		std::vector<Queue*> queues;
+		std::atomic<int> queued;	//Jobs in all the queues
+		std::atomic<int> sleeping;	//Workers and waiters waiting on wakeup
+		std::atomic<int> waiting;	//Threads sleeping in wait()
+		std::atomic<bool> stopping;
+		std::mutex sleepMutex;
+		std::condition_variable wakeup;
+};
+
+//Pool shared by the loaders, tessellators and image converters, one worker
+//per core, started on first use
+JobSystem& jobSystem();
+
+//Calls body(first, last) over [0, count) on jobSystem() split into about
+//splits ranges.  splits <= 0 lets the pool pick, splits == 1 runs body on
+//the calling thread.  This is what the "threads" arguments of the image
+//functions control.
+template<class Body>
+void parallelRanges(int count, int splits, const Body& body) {
+	if (splits == 1 || count <= 1) {
+		body(0, count);
+		return;
+	}
+	jobSystem().parallelFor(count, splits > 0 ? (count + splits - 1) / splits : 0, body);
+}
+
+#endif
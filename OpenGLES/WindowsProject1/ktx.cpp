@@ -0,0 +1,268 @@
+#include "stdafx.h"
+#include <string.h>
+#include <fstream>
+#include <algorithm>
+#include "ktx.h"
+
+using namespace std;
+
+namespace {
+	const unsigned char KTX_IDENTIFIER[12] = {
+		0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+	};
+	const unsigned int KTX_ENDIAN_REF = 0x04030201;
+	const unsigned int KTX_ENDIAN_REF_REV = 0x01020304;
+
+	const char ORIENTATION_KEY[] = "KTXorientation";
+	const char ORIENTATION_VALUE[] = "S=r,T=u";
+
+	//Header fields after the identifier, in file order
+	struct KTXHeader {
+		unsigned int endianness;
+		unsigned int glType;
+		unsigned int glTypeSize;
+		unsigned int glFormat;
+		unsigned int glInternalFormat;
+		unsigned int glBaseInternalFormat;
+		unsigned int pixelWidth;
+		unsigned int pixelHeight;
+		unsigned int pixelDepth;
+		unsigned int numberOfArrayElements;
+		unsigned int numberOfFaces;
+		unsigned int numberOfMipmapLevels;
+		unsigned int bytesOfKeyValueData;
+	};
+
+	unsigned int swap32(unsigned int value) {
+		return (value >> 24) | ((value >> 8) & 0xff00) |
+			   ((value << 8) & 0xff0000) | (value << 24);
+	}
+
+	unsigned int padding4(unsigned int size) {
+		return (4 - (size & 3)) & 3;
+	}
+
+	//Reads consecutive fields out of a memory block, failing past the end
+	class Reader {
+		public:
+			Reader(const char* data_, size_t size_) : data(data_), size(size_), offset(0) {
+			}
+
+			bool read(void* out, size_t count) {
+				if (count > size - offset)
+					return false;
+				memcpy(out, data + offset, count);
+				offset += count;
+				return true;
+			}
+
+			bool skip(size_t count) {
+				if (count > size - offset)
+					return false;
+				offset += count;
+				return true;
+			}
+
+			size_t remaining() const {
+				return size - offset;
+			}
+
+		private:
+			const char* data;
+			size_t size;
+			size_t offset;
+	};
+
+	void writeUint(ostream& output, unsigned int value) {
+		output.write((const char*)&value, 4);
+	}
+}
+
+KTXTexture::KTXTexture() :
+	glType(0), glTypeSize(1), glFormat(0), glInternalFormat(0),
+	glBaseInternalFormat(0), width(0), height(0), originBottom(true) {
+}
+
+size_t KTXTexture::totalBytes() const {
+	size_t total = 0;
+	for (size_t i = 0; i < levels.size(); i++)
+		total += levels[i].size();
+	return total;
+}
+
+KTXTexture* loadKTX(const char* data, size_t size) {
+	Reader reader(data, size);
+	unsigned char identifier[12];
+	if (!reader.read(identifier, 12) || memcmp(identifier, KTX_IDENTIFIER, 12) != 0)
+		return NULL;
+
+	KTXHeader header;
+	if (!reader.read(&header, sizeof(header)))
+		return NULL;
+	bool swap = header.endianness == KTX_ENDIAN_REF_REV;
+	if (swap) {
+		unsigned int* fields = (unsigned int*)&header;
+		for (size_t i = 0; i < sizeof(header) / 4; i++)
+			fields[i] = swap32(fields[i]);
+	}
+	if (header.endianness != KTX_ENDIAN_REF)
+		return NULL;
+
+	//Only plain 2D textures, which is all the demos sample
+	if (header.pixelDepth > 1 || header.numberOfArrayElements > 0 ||
+		header.numberOfFaces != 1 || header.pixelHeight == 0)
+		return NULL;
+
+	//The orientation key is the only metadata we care about.  KTX files
+	//default to T pointing down, i.e. the first row is the top.
+	bool flipped = true;
+	unsigned int keyValueBytes = header.bytesOfKeyValueData;
+	while (keyValueBytes >= 4) {
+		unsigned int pairSize;
+		if (!reader.read(&pairSize, 4))
+			return NULL;
+		if (swap)
+			pairSize = swap32(pairSize);
+		unsigned int paddedSize = pairSize + padding4(pairSize);
+		if (paddedSize + 4 > keyValueBytes)
+			return NULL;
+		vector<char> pair(pairSize + 1, 0);
+		if (pairSize > 0 && !reader.read(&pair[0], pairSize))
+			return NULL;
+		reader.skip(padding4(pairSize));
+		keyValueBytes -= paddedSize + 4;
+
+		if (strcmp(&pair[0], ORIENTATION_KEY) == 0)
+			flipped = strstr(&pair[0] + sizeof(ORIENTATION_KEY), "T=u") == NULL;
+	}
+	if (!reader.skip(keyValueBytes))
+		return NULL;
+
+	KTXTexture* texture = new KTXTexture();
+	texture->glType = header.glType;
+	texture->glTypeSize = header.glTypeSize;
+	texture->glFormat = header.glFormat;
+	texture->glInternalFormat = header.glInternalFormat;
+	texture->glBaseInternalFormat = header.glBaseInternalFormat;
+	texture->width = header.pixelWidth;
+	texture->height = header.pixelHeight;
+
+	unsigned int levelCount = header.numberOfMipmapLevels ? header.numberOfMipmapLevels : 1;
+	texture->levels.resize(levelCount);
+	for (unsigned int level = 0; level < levelCount; level++) {
+		unsigned int imageSize;
+		if (!reader.read(&imageSize, 4)) {
+			delete texture;
+			return NULL;
+		}
+		if (swap)
+			imageSize = swap32(imageSize);
+		if (imageSize > reader.remaining()) {
+			delete texture;
+			return NULL;
+		}
+		vector<char>& bytes = texture->levels[level];
+		bytes.resize(imageSize);
+		if ((imageSize > 0 && !reader.read(&bytes[0], imageSize))) {
+			delete texture;
+			return NULL;
+		}
+		reader.skip(padding4(imageSize));
+
+		//Uncompressed 16 and 32-bit texels are stored in the writer's byte order
+		if (swap && texture->glTypeSize == 2) {
+			for (size_t i = 0; i + 1 < bytes.size(); i += 2)
+				std::swap(bytes[i], bytes[i + 1]);
+		}
+		else if (swap && texture->glTypeSize == 4) {
+			for (size_t i = 0; i + 3 < bytes.size(); i += 4) {
+				std::swap(bytes[i], bytes[i + 3]);
+				std::swap(bytes[i + 1], bytes[i + 2]);
+			}
+		}
+	}
+
+	//Top-down uncompressed levels are turned around so row 0 is t = 0.
+	//Compressed blocks can't be flipped without decoding, so those are
+	//left for the caller to sample with an inverted t.
+	texture->originBottom = !flipped || !texture->isCompressed();
+	if (flipped && !texture->isCompressed()) {
+		for (unsigned int level = 0; level < levelCount; level++) {
+			int levelHeight = max(texture->height >> level, 1);
+			vector<char>& bytes = texture->levels[level];
+			size_t rowBytes = bytes.size() / levelHeight;
+			vector<char> row(rowBytes);
+			for (int y = 0; y < levelHeight / 2; y++) {
+				char* top = &bytes[y * rowBytes];
+				char* bottom = &bytes[(levelHeight - 1 - y) * rowBytes];
+				memcpy(&row[0], top, rowBytes);
+				memcpy(top, bottom, rowBytes);
+				memcpy(bottom, &row[0], rowBytes);
+			}
+		}
+	}
+	return texture;
+}
+
+KTXTexture* loadKTX(const char* filename) {
+	ifstream input;
+	input.open(filename, ifstream::binary);
+	if (input.fail())
+		return NULL;
+
+	input.seekg(0, ios_base::end);
+	size_t size = (size_t)input.tellg();
+	input.seekg(0, ios_base::beg);
+	vector<char> data(size);
+	if (size > 0)
+		input.read(&data[0], size);
+	input.close();
+	return size > 0 ? loadKTX(&data[0], size) : NULL;
+}
+
+bool writeKTX(const char* filename, const KTXTexture& texture) {
+	ofstream output;
+	output.open(filename, ofstream::binary);
+	if (output.fail())
+		return false;
+	bool ok = writeKTX(output, texture);
+	output.close();
+	return ok;
+}
+
+bool writeKTX(ostream& output, const KTXTexture& texture) {
+	//Key and value are both NUL terminated inside the pair
+	unsigned int pairSize = sizeof(ORIENTATION_KEY) + sizeof(ORIENTATION_VALUE);
+	unsigned int keyValueBytes = 4 + pairSize + padding4(pairSize);
+
+	output.write((const char*)KTX_IDENTIFIER, 12);
+	writeUint(output, KTX_ENDIAN_REF);
+	writeUint(output, texture.glType);
+	writeUint(output, texture.glTypeSize);
+	writeUint(output, texture.glFormat);
+	writeUint(output, texture.glInternalFormat);
+	writeUint(output, texture.glBaseInternalFormat);
+	writeUint(output, texture.width);
+	writeUint(output, texture.height);
+	writeUint(output, 0);	//pixelDepth
+	writeUint(output, 0);	//numberOfArrayElements
+	writeUint(output, 1);	//numberOfFaces
+	writeUint(output, (unsigned int)texture.levels.size());
+	writeUint(output, keyValueBytes);
+
+	const char zeros[4] = { 0, 0, 0, 0 };
+	writeUint(output, pairSize);
+	output.write(ORIENTATION_KEY, sizeof(ORIENTATION_KEY));
+	output.write(ORIENTATION_VALUE, sizeof(ORIENTATION_VALUE));
+	output.write(zeros, padding4(pairSize));
+
+	for (size_t level = 0; level < texture.levels.size(); level++) {
+		const vector<char>& bytes = texture.levels[level];
+		writeUint(output, (unsigned int)bytes.size());
+		if (!bytes.empty())
+			output.write(&bytes[0], bytes.size());
+		output.write(zeros, padding4((unsigned int)bytes.size()));
+	}
+
+	return !output.fail();
+}
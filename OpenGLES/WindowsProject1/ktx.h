@@ -0,0 +1,62 @@
+#ifndef KTX_H_INCLUDED
+#define KTX_H_INCLUDED
+
+#include <stddef.h>
+#include <ostream>
+#include <vector>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+//Compressed formats that are core in ES 3.0 but missing from the ES 2.0 headers
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2							0x9274
+#define GL_COMPRESSED_SRGB8_ETC2						0x9275
+#define GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2		0x9276
+#define GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2	0x9277
+#define GL_COMPRESSED_RGBA8_ETC2_EAC					0x9278
+#define GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC				0x9279
+#endif
+
+/* A texture stored in a KTX 1.1 container: every mip level of a single 2D
+ * image, either block compressed (glType == 0) or plain pixels.
+ *
+ * Levels are kept in the order GL wants them for glTexImage2D and
+ * glCompressedTexImage2D, i.e. the first row of every level is t = 0.  KTX
+ * files written by writeKTX say so with a "KTXorientation" of "S=r,T=u", the
+ * same layout loadBMP produces.  Files without the key are top-down, as the
+ * KTX spec defaults to "T=d"; compressed ones can't be turned around without
+ * decoding the blocks and come with originBottom false.
+ */
+class KTXTexture {
+	public:
+		KTXTexture();
+
+		bool isCompressed() const { return glType == 0; }
+
+		//Bytes of every level together, the memory the texture occupies on the GPU
+		size_t totalBytes() const;
+
+		GLenum glType;
+		GLuint glTypeSize;
+		GLenum glFormat;
+		GLenum glInternalFormat;
+		GLenum glBaseInternalFormat;
+		int width;
+		int height;
+		bool originBottom;	//False if row 0 is the top, so t has to be inverted
+		std::vector<std::vector<char> > levels;
+};
+
+//Reads a KTX file.  Returns NULL if it is not a 2D, single face KTX texture.
+KTXTexture* loadKTX(const char* filename);
+
+//Reads a KTX file already in memory; data must stay valid during the call
+KTXTexture* loadKTX(const char* data, size_t size);
+
+//Writes the texture as a KTX file, returns false if the file can't be written
+bool writeKTX(const char* filename, const KTXTexture& texture);
+
+//Writes the texture as KTX to a stream opened in binary mode
+bool writeKTX(std::ostream& output, const KTXTexture& texture);
+
+#endif
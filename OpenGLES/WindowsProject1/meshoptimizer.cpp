@@ -0,0 +1,309 @@
+#include "stdafx.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "meshoptimizer.h"
+
+using namespace std;
+
+namespace {
+	//FNV-1a over the bytes of one vertex
+	unsigned long long hashVertex(const unsigned char* vertex, int stride) {
+		unsigned long long hash = 14695981039346656037ULL;
+		for (int i = 0; i < stride; i++) {
+			hash ^= vertex[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	/* FIFO post-transform cache.  A vertex is cached while fewer than size
+	 * vertices were inserted after it, so a timestamp per vertex replaces
+	 * the queue.
+	 */
+	struct FifoCache {
+		vector<int> insertedAt;
+		int size;
+		int time;
+
+		FifoCache(int vertexCount, int size) : insertedAt(vertexCount, 0), size(size), time(size + 1) {}
+
+		//Returns true on a miss
+		bool access(int v) {
+			if (time - insertedAt[v] <= size)
+				return false;
+			insertedAt[v] = time++;
+			return true;
+		}
+
+		//Empties the cache by ageing every vertex in it
+		void flush() {
+			time += size + 1;
+		}
+	};
+
+	struct Cluster {
+		int first, last;	//Index range
+		float score;		//Occlusion potential, higher draws first
+	};
+
+	bool byScore(const Cluster& a, const Cluster& b) {
+		return a.score > b.score;
+	}
+
+	void position(const GLfloat* positions, int components, int stride, int v, float* p) {
+		const GLfloat* at = (const GLfloat*)((const char*)positions + (size_t)v * stride);
+		p[0] = at[0];
+		p[1] = at[1];
+		p[2] = components > 2 ? at[2] : 0.0f;
+	}
+
+	//Centroid of triangle t, weighted by area, and its normal scaled by twice its area
+	float triangleGeometry(const GLushort* indices, int t, const GLfloat* positions, int components,
+						   int stride, float* centroid, float* normal) {
+		float a[3], b[3], c[3];
+		position(positions, components, stride, indices[3 * t], a);
+		position(positions, components, stride, indices[3 * t + 1], b);
+		position(positions, components, stride, indices[3 * t + 2], c);
+		float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float w[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		normal[0] = u[1] * w[2] - u[2] * w[1];
+		normal[1] = u[2] * w[0] - u[0] * w[2];
+		normal[2] = u[0] * w[1] - u[1] * w[0];
+		float area = 0.5f * sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		for (int i = 0; i < 3; i++)
+			centroid[i] = (a[i] + b[i] + c[i]) / 3.0f;
+		return area;
+	}
+}
+
+void analyzeVertexCache(const GLushort* indices, int indexCount, int vertexCount,
+						int cacheSize, float* acmr, float* atvr) {
+	FifoCache cache(vertexCount, cacheSize);
+	int misses = 0;
+	for (int i = 0; i < indexCount; i++)
+		misses += cache.access(indices[i]) ? 1 : 0;
+	int triangles = indexCount / 3;
+	*acmr = triangles ? (float)misses / triangles : 0.0f;
+	*atvr = vertexCount ? (float)misses / vertexCount : 0.0f;
+}
+
+int deduplicateVertices(void* vertices, int vertexCount, int stride,
+						GLushort* indices, int indexCount) {
+	unsigned char* bytes = (unsigned char*)vertices;
+	size_t tableSize = 16;
+	while (tableSize < 2 * (size_t)vertexCount)
+		tableSize *= 2;
+	vector<int> table(tableSize, -1);	//Kept vertices by hash, open addressing
+	vector<int> remap(vertexCount);
+	int kept = 0;
+
+	for (int v = 0; v < vertexCount; v++) {
+		const unsigned char* vertex = bytes + (size_t)v * stride;
+		size_t slot = (size_t)hashVertex(vertex, stride) & (tableSize - 1);
+		while (table[slot] >= 0 && memcmp(bytes + (size_t)table[slot] * stride, vertex, stride) != 0)
+			slot = (slot + 1) & (tableSize - 1);
+		if (table[slot] < 0) {
+			//Kept vertices only move towards the start, never over one not yet read
+			if (kept != v)
+				memcpy(bytes + (size_t)kept * stride, vertex, stride);
+			table[slot] = kept++;
+		}
+		remap[v] = table[slot];
+	}
+
+	for (int i = 0; i < indexCount; i++)
+		indices[i] = (GLushort)remap[indices[i]];
+	return kept;
+}
+
+void optimizeVertexCache(GLushort* indices, int indexCount, int vertexCount,
+						 int cacheSize, vector<int>* clusters) {
+	int triangleCount = indexCount / 3;
+
+	//Triangles of each vertex, and how many of them are still to be emitted
+	vector<int> live(vertexCount, 0);
+	vector<int> offsets(vertexCount + 1, 0);
+	vector<int> adjacency(3 * triangleCount);
+	for (int i = 0; i < 3 * triangleCount; i++)
+		live[indices[i]]++;
+	for (int v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + live[v];
+	vector<int> fill(offsets.begin(), offsets.end() - 1);
+	for (int i = 0; i < 3 * triangleCount; i++)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	vector<char> emitted(triangleCount, 0);
+	vector<int> deadEnds;
+	vector<int> candidates;
+	vector<GLushort> out;
+	out.reserve(indexCount);
+	FifoCache cache(vertexCount, cacheSize);
+
+	if (clusters) {
+		clusters->clear();
+		clusters->push_back(0);
+	}
+
+	int cursor = 0;
+	while (cursor < vertexCount && live[cursor] == 0)
+		cursor++;
+	int fanning = cursor < vertexCount ? cursor : -1;
+	while (fanning >= 0) {
+		//Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (int k = offsets[fanning]; k < offsets[fanning + 1]; k++) {
+			int t = adjacency[k];
+			if (emitted[t])
+				continue;
+			emitted[t] = 1;
+			for (int j = 0; j < 3; j++) {
+				int v = indices[3 * t + j];
+				out.push_back((GLushort)v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				cache.access(v);
+			}
+		}
+
+		//Next, the candidate that has been in the cache longest and will
+		//still be there after fanning around it
+		int next = -1;
+		int bestPriority = -1;
+		for (size_t i = 0; i < candidates.size(); i++) {
+			int v = candidates[i];
+			if (live[v] == 0)
+				continue;
+			int age = cache.time - cache.insertedAt[v];
+			int priority = age + 2 * live[v] <= cacheSize ? age : 0;
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				next = v;
+			}
+		}
+
+		//Dead end: restart from a recent vertex with triangles left, or
+		//from the next one in input order.  The cache is cold from here.
+		if (next < 0) {
+			while (!deadEnds.empty() && next < 0) {
+				int v = deadEnds.back();
+				deadEnds.pop_back();
+				if (live[v] > 0)
+					next = v;
+			}
+			while (next < 0 && cursor < vertexCount) {
+				if (live[cursor] > 0)
+					next = cursor;
+				else
+					cursor++;
+			}
+			if (next >= 0 && clusters)
+				clusters->push_back((int)out.size());
+		}
+		fanning = next;
+	}
+
+	if (!out.empty())
+		memcpy(indices, &out[0], out.size() * sizeof(GLushort));
+	if (clusters)
+		clusters->push_back(indexCount);
+}
+
+void optimizeOverdraw(GLushort* indices, int indexCount, const vector<int>& clusters,
+					  const GLfloat* positions, int components, int stride, int vertexCount,
+					  int cacheSize, float threshold) {
+	float meshAcmr, meshAtvr;
+	analyzeVertexCache(indices, indexCount, vertexCount, cacheSize, &meshAcmr, &meshAtvr);
+
+	//Split the hard clusters where the cache, starting empty at the start
+	//of the piece, has done nearly as well as over the whole mesh: the
+	//pieces can then be drawn in any order for little more than that ACMR
+	vector<Cluster> split;
+	FifoCache cache(vertexCount, cacheSize);
+	for (size_t c = 0; c + 1 < clusters.size(); c++) {
+		int first = clusters[c];
+		int misses = 0;
+		cache.flush();
+		for (int i = clusters[c]; i + 3 <= clusters[c + 1]; i += 3) {
+			for (int j = 0; j < 3; j++)
+				misses += cache.access(indices[i + j]) ? 1 : 0;
+			int triangles = (i + 3 - first) / 3;
+			if (i + 3 < clusters[c + 1] && misses <= threshold * meshAcmr * triangles) {
+				Cluster cluster = { first, i + 3, 0.0f };
+				split.push_back(cluster);
+				first = i + 3;
+				misses = 0;
+				cache.flush();
+			}
+		}
+		if (first < clusters[c + 1]) {
+			Cluster cluster = { first, clusters[c + 1], 0.0f };
+			split.push_back(cluster);
+		}
+	}
+
+	//Centre of the mesh and of each cluster, weighted by area
+	float meshCentre[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+	for (int t = 0; t < indexCount / 3; t++) {
+		float centroid[3], normal[3];
+		float area = triangleGeometry(indices, t, positions, components, stride, centroid, normal);
+		for (int i = 0; i < 3; i++)
+			meshCentre[i] += centroid[i] * area;
+		meshArea += area;
+	}
+	for (int i = 0; i < 3 && meshArea > 0.0f; i++)
+		meshCentre[i] /= meshArea;
+
+	//Clusters facing away from the centre tend to occlude those facing in
+	for (size_t c = 0; c < split.size(); c++) {
+		float centre[3] = { 0.0f, 0.0f, 0.0f };
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		float area = 0.0f;
+		for (int t = split[c].first / 3; t < split[c].last / 3; t++) {
+			float triangleCentroid[3], triangleNormal[3];
+			float triangleArea = triangleGeometry(indices, t, positions, components, stride,
+												  triangleCentroid, triangleNormal);
+			for (int i = 0; i < 3; i++) {
+				centre[i] += triangleCentroid[i] * triangleArea;
+				normal[i] += triangleNormal[i];
+			}
+			area += triangleArea;
+		}
+		float score = 0.0f;
+		for (int i = 0; i < 3 && area > 0.0f; i++)
+			score += (centre[i] / area - meshCentre[i]) * normal[i];
+		split[c].score = score;
+	}
+	stable_sort(split.begin(), split.end(), byScore);
+
+	vector<GLushort> out;
+	out.reserve(indexCount);
+	for (size_t c = 0; c < split.size(); c++)
+		out.insert(out.end(), indices + split[c].first, indices + split[c].last);
+	if (!out.empty())
+		memcpy(indices, &out[0], out.size() * sizeof(GLushort));
+}
+
+int optimizeVertexFetch(void* vertices, int vertexCount, int stride,
+						GLushort* indices, int indexCount) {
+	vector<int> remap(vertexCount, -1);
+	int used = 0;
+	for (int i = 0; i < indexCount; i++) {
+		int& to = remap[indices[i]];
+		if (to < 0)
+			to = used++;
+		indices[i] = (GLushort)to;
+	}
+
+	unsigned char* bytes = (unsigned char*)vertices;
+	vector<unsigned char> moved((size_t)used * stride);
+	for (int v = 0; v < vertexCount; v++) {
+		if (remap[v] >= 0)
+			memcpy(&moved[(size_t)remap[v] * stride], bytes + (size_t)v * stride, stride);
+	}
+	if (used)
+		memcpy(bytes, &moved[0], moved.size());
+	return used;
+}
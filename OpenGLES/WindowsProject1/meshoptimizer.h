@@ -0,0 +1,64 @@
+#ifndef MESH_OPTIMIZER_H_INCLUDED
+#define MESH_OPTIMIZER_H_INCLUDED
+
+#include <vector>
+#include <GLES2/gl2.h>
+
+/* Reordering passes for indexed triangle lists drawn with
+ * glDrawElements(GL_TRIANGLES, ...).  None of them changes what is drawn,
+ * only the order the GPU meets the triangles and vertices in.  Run them in
+ * the order below:
+ *
+ *   deduplicateVertices	welds vertices with identical bytes, so the
+ *							vertex cache can see they are shared
+ *   optimizeVertexCache	Tipsify (Sander, Nehab and Barczak 2007):
+ *							triangles reordered so their vertices are
+ *							still in the post-transform cache, in linear
+ *							time
+ *   optimizeOverdraw		clusters of the cache order sorted so that
+ *							triangles likely to occlude others come first,
+ *							keeping most of the cache gain
+ *   optimizeVertexFetch	vertices renumbered in the order the triangles
+ *							first use them, so fetches walk memory forwards
+ *
+ * The cache is measured with a FIFO of cacheSize vertices, as most GPUs
+ * have; 16 is a safe size for the mobile and TV parts this runs on.
+ * ACMR is the vertices transformed per triangle (3 at worst, about 0.5 at
+ * best for a regular grid), ATVR those per vertex of the mesh (1 at best).
+ */
+
+#define MESH_CACHE_SIZE	16
+
+//Vertices shaded per triangle and per vertex of indices drawn through a
+//FIFO cache of cacheSize vertices
+void analyzeVertexCache(const GLushort* indices, int indexCount, int vertexCount,
+						int cacheSize, float* acmr, float* atvr);
+
+//Merges vertices whose stride bytes are equal, keeping the first of each in
+//its order, and rewrites indices to match.  Returns the vertex count left
+//at the start of vertices.
+int deduplicateVertices(void* vertices, int vertexCount, int stride,
+						GLushort* indices, int indexCount);
+
+//Reorders the triangles of indices for the vertex cache.  clusters, if
+//given, receives the first index of every run that starts on a cold cache,
+//followed by indexCount: the boundaries optimizeOverdraw() may move.
+void optimizeVertexCache(GLushort* indices, int indexCount, int vertexCount,
+						 int cacheSize = MESH_CACHE_SIZE, std::vector<int>* clusters = NULL);
+
+//Sorts the clusters of a cache-optimized order from the most to the least
+//occluding, by how far each faces out from the centre of the mesh.
+//Clusters are first split wherever their ACMR so far stays within
+//threshold of the mesh's, so a higher threshold gives more, smaller
+//clusters to sort and less of the cache gain.  positions are
+//components floats (2 or 3) at the start of each stride bytes.
+void optimizeOverdraw(GLushort* indices, int indexCount, const std::vector<int>& clusters,
+					  const GLfloat* positions, int components, int stride, int vertexCount,
+					  int cacheSize = MESH_CACHE_SIZE, float threshold = 1.05f);
+
+//Renumbers vertices in the order indices first use them and moves them to
+//match.  Returns the vertex count left; vertices no triangle uses go.
+int optimizeVertexFetch(void* vertices, int vertexCount, int stride,
+						GLushort* indices, int indexCount);
+
+#endif
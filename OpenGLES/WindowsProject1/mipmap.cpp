@@ -0,0 +1,212 @@
+#include "stdafx.h"
+#include <math.h>
+#include <vector>
+#include "mipmap.h"
+#include "jobsystem.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MIPMAP_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+	const int KAISER_TAPS = 6;
+	const float KAISER_BETA = 4.0f;
+
+	//sRGB <-> linear conversion tables, built on first use
+	struct SrgbTables {
+		float toLinear[256];
+		unsigned char toSrgb[4096];
+
+		SrgbTables() {
+			for (int i = 0; i < 256; i++) {
+				float c = i / 255.0f;
+				toLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < 4096; i++) {
+				float l = i / 4095.0f;
+				float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+				toSrgb[i] = (unsigned char)(c * 255.0f + 0.5f);
+			}
+		}
+
+		unsigned char encode(float linear) const {
+			if (linear <= 0.0f)
+				return 0;
+			if (linear >= 1.0f)
+				return 255;
+			return toSrgb[(int)(linear * 4095.0f + 0.5f)];
+		}
+	};
+
+	const SrgbTables& srgbTables() {
+		static SrgbTables tables;
+		return tables;
+	}
+
+	unsigned char clampByte(float value) {
+		return value <= 0.0f ? 0 : (value >= 255.0f ? 255 : (unsigned char)(value + 0.5f));
+	}
+
+	//sums[i] = a[i] + b[i] for count bytes
+	void addRows(const unsigned char* a, const unsigned char* b, int count, unsigned short* sums) {
+		int i = 0;
+#ifdef MIPMAP_USE_SSE2
+		__m128i zero = _mm_setzero_si128();
+		for (; i + 16 <= count; i += 16) {
+			__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+			__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+			__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+			__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+			_mm_storeu_si128((__m128i*)(sums + i), lo);
+			_mm_storeu_si128((__m128i*)(sums + i + 8), hi);
+		}
+#endif
+		for (; i < count; i++)
+			sums[i] = (unsigned short)(a[i] + b[i]);
+	}
+
+	void boxRows(const Image* src, Image* dst, bool srgb, int first, int last) {
+		const unsigned char* pixels = (const unsigned char*)src->pixels;
+		unsigned char* out = (unsigned char*)dst->pixels;
+		const SrgbTables& tables = srgbTables();
+		vector<unsigned short> sums(src->width * 3);
+
+		for (int y = first; y < last; y++) {
+			const unsigned char* row0 = pixels + 3 * src->width * (2 * y);
+			const unsigned char* row1 = pixels + 3 * src->width * (2 * y + 1 < src->height ? 2 * y + 1 : src->height - 1);
+			unsigned char* target = out + 3 * dst->width * y;
+
+			if (!srgb) {
+				addRows(row0, row1, src->width * 3, &sums[0]);
+				for (int x = 0; x < dst->width; x++) {
+					int x0 = 3 * (2 * x);
+					int x1 = 3 * (2 * x + 1 < src->width ? 2 * x + 1 : src->width - 1);
+					for (int c = 0; c < 3; c++)
+						target[3 * x + c] = (unsigned char)((sums[x0 + c] + sums[x1 + c] + 2) >> 2);
+				}
+				continue;
+			}
+
+			for (int x = 0; x < dst->width; x++) {
+				int x0 = 3 * (2 * x);
+				int x1 = 3 * (2 * x + 1 < src->width ? 2 * x + 1 : src->width - 1);
+				for (int c = 0; c < 3; c++) {
+					float sum = tables.toLinear[row0[x0 + c]] + tables.toLinear[row0[x1 + c]] +
+								tables.toLinear[row1[x0 + c]] + tables.toLinear[row1[x1 + c]];
+					target[3 * x + c] = tables.encode(sum * 0.25f);
+				}
+			}
+		}
+	}
+
+	float besselI0(float x) {
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (int k = 1; k < 20; k++) {
+			term *= (x / (2.0f * k)) * (x / (2.0f * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	//Weights of the source texels 2i-2 .. 2i+3 for destination texel i
+	void kaiserWeights(float weights[KAISER_TAPS]) {
+		const float pi = 3.14159265f;
+		const float radius = KAISER_TAPS / 4.0f;	//In destination texels
+		float total = 0.0f;
+		for (int k = 0; k < KAISER_TAPS; k++) {
+			float t = (k - KAISER_TAPS / 2 + 0.5f) / 2.0f;
+			float sinc = t == 0.0f ? 1.0f : sinf(pi * t) / (pi * t);
+			float r = t / radius;
+			float window = besselI0(KAISER_BETA * sqrtf(1.0f - r * r)) / besselI0(KAISER_BETA);
+			weights[k] = sinc * window;
+			total += weights[k];
+		}
+		for (int k = 0; k < KAISER_TAPS; k++)
+			weights[k] /= total;
+	}
+
+	Image* kaiserDownsample(const Image* src, int dstWidth, int dstHeight, bool srgb, int threads) {
+		float weights[KAISER_TAPS];
+		kaiserWeights(weights);
+		const SrgbTables& tables = srgbTables();
+		const unsigned char* pixels = (const unsigned char*)src->pixels;
+
+		//Horizontal pass into floats, one row per source row
+		vector<float> horizontal(src->height * dstWidth * 3);
+		parallelRanges(src->height, threads, [&](int first, int last) {
+			for (int y = first; y < last; y++) {
+				const unsigned char* row = pixels + 3 * src->width * y;
+				float* target = &horizontal[3 * dstWidth * y];
+				for (int x = 0; x < dstWidth; x++) {
+					float sum[3] = { 0.0f, 0.0f, 0.0f };
+					for (int k = 0; k < KAISER_TAPS; k++) {
+						int sx = 2 * x + k - KAISER_TAPS / 2 + 1;
+						sx = sx < 0 ? 0 : (sx >= src->width ? src->width - 1 : sx);
+						for (int c = 0; c < 3; c++) {
+							unsigned char value = row[3 * sx + c];
+							sum[c] += weights[k] * (srgb ? tables.toLinear[value] : value);
+						}
+					}
+					target[3 * x + 0] = sum[0];
+					target[3 * x + 1] = sum[1];
+					target[3 * x + 2] = sum[2];
+				}
+			}
+		});
+
+		//Vertical pass back to bytes
+		char* out = new char[dstWidth * dstHeight * 3];
+		parallelRanges(dstHeight, threads, [&](int first, int last) {
+			for (int y = first; y < last; y++) {
+				unsigned char* target = (unsigned char*)out + 3 * dstWidth * y;
+				for (int i = 0; i < dstWidth * 3; i++) {
+					float sum = 0.0f;
+					for (int k = 0; k < KAISER_TAPS; k++) {
+						int sy = 2 * y + k - KAISER_TAPS / 2 + 1;
+						sy = sy < 0 ? 0 : (sy >= src->height ? src->height - 1 : sy);
+						sum += weights[k] * horizontal[3 * dstWidth * sy + i];
+					}
+					target[i] = srgb ? tables.encode(sum) : clampByte(sum);
+				}
+			}
+		});
+		return new Image(out, dstWidth, dstHeight);
+	}
+}
+
+int mipLevelCount(int width, int height) {
+	int levels = 1;
+	while (width > 1 || height > 1) {
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		levels++;
+	}
+	return levels;
+}
+
+Image* downsampleImage(const Image* image, MipFilter filter, bool srgb, int threads) {
+	int width = image->width > 1 ? image->width / 2 : 1;
+	int height = image->height > 1 ? image->height / 2 : 1;
+	if (filter == MIP_FILTER_KAISER)
+		return kaiserDownsample(image, width, height, srgb, threads);
+
+	Image* level = new Image(new char[width * height * 3], width, height);
+	parallelRanges(height, threads, [&](int first, int last) {
+		boxRows(image, level, srgb, first, last);
+	});
+	return level;
+}
+
+vector<Image*> generateMipChain(const Image* image, MipFilter filter, bool srgb, int threads) {
+	vector<Image*> levels;
+	const Image* previous = image;
+	while (previous->width > 1 || previous->height > 1) {
+		levels.push_back(downsampleImage(previous, filter, srgb, threads));
+		previous = levels.back();
+	}
+	return levels;
+}
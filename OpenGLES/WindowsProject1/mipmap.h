@@ -0,0 +1,34 @@
+#ifndef MIPMAP_H_INCLUDED
+#define MIPMAP_H_INCLUDED
+
+#include <vector>
+#include "imageloader.h"
+
+//Reduction filter used between two mip levels
+enum MipFilter {
+	MIP_FILTER_BOX,		//2x2 average, the same as most glGenerateMipmap
+	MIP_FILTER_KAISER	//6-tap Kaiser windowed sinc, sharper minified detail
+};
+
+/* CPU mip chain generation for RGB images.
+ *
+ * Every level halves the previous one (rounding down, never below 1x1) until
+ * 1x1.  With srgb set the texels are averaged in linear light and converted
+ * back, which keeps minified photos from darkening; otherwise the bytes are
+ * averaged as they are, like glGenerateMipmap on a GL_RGB texture.  The box
+ * filter adds rows with SSE2 where available.  Output rows are split into
+ * threads ranges run on the job system, threads <= 0 letting it choose.
+ */
+
+//Returns the next level of image, half its size
+Image* downsampleImage(const Image* image, MipFilter filter, bool srgb, int threads = 0);
+
+//Returns levels 1..n of image; level 0 is the image itself and not included.
+//The caller owns the returned images.
+std::vector<Image*> generateMipChain(const Image* image, MipFilter filter,
+									 bool srgb, int threads = 0);
+
+//Number of levels of a full chain for the given size, level 0 included
+int mipLevelCount(int width, int height);
+
+#endif
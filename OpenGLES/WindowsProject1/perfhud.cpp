@@ -0,0 +1,282 @@
+#include "stdafx.h"
+#include <string.h>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include "perfhud.h"
+#include "glprogram.h"
+
+using namespace std;
+
+// Index to bind the attributes to vertex shaders
+#define VERTEX_ARRAY	0
+#define TEXCOORD_ARRAY	1
+#define COLOR_ARRAY		2
+
+// Pixels per bar of the frame time graph
+#define BAR_WIDTH		2
+// Text size in overlay pixels, and the height left for the graph below it
+#define TEXT_SIZE		14.0f
+#define TEXT_LINES		3
+// Blend factor of the overlay over the scene
+#define OVERLAY_ALPHA	"0.85"
+
+namespace {
+	const char* pszGraphVertShader = "\
+		attribute highp vec2	myVertex;\
+		attribute lowp vec4		myColor;\
+		uniform mediump mat4	myPMVMatrix;\
+		varying lowp vec4		myTint;\
+		void main(void)\
+		{\
+			gl_Position = myPMVMatrix * vec4(myVertex, 0.0, 1.0);\
+			myTint = myColor;\
+		}";
+	const char* pszGraphFragShader = "\
+		varying lowp vec4	myTint;\
+		void main (void)\
+		{\
+			gl_FragColor = myTint;\
+		}";
+
+	//Places the unit quad at myRect, (x0, y0, x1, y1) in clip space
+	const char* pszOverlayVertShader = "\
+		attribute highp vec2	myVertex;\
+		uniform highp vec4		myRect;\
+		varying mediump vec2	myTexCoord;\
+		void main(void)\
+		{\
+			gl_Position = vec4(mix(myRect.xy, myRect.zw, myVertex), 0.0, 1.0);\
+			myTexCoord = myVertex;\
+		}";
+	const char* pszOverlayFragShader = "\
+		uniform sampler2D sampler2d;\
+		varying mediump vec2	myTexCoord;\
+		void main (void)\
+		{\
+			gl_FragColor = vec4(texture2D(sampler2d, myTexCoord).rgb, " OVERLAY_ALPHA ");\
+		}";
+
+	const GLuint PANEL_COLOR = 0xff201818;
+	const GLuint BUDGET_COLOR = 0xff606060;
+	const GLuint TEXT_COLOR = 0xffffffff;
+
+	//Bars under the 60 Hz budget are green, under 30 Hz yellow, then red
+	GLuint barColor(float ms) {
+		if (ms <= 1000.0f / 60.0f)
+			return 0xff40d040;
+		return ms <= 1000.0f / 30.0f ? 0xff30d0e0 : 0xff4040e0;
+	}
+}
+
+PerfHud::PerfHud(int width, int height, float updateHz) :
+	hudWidth(width), hudHeight(height), periodMs(1000.0f / (updateHz > 0.0f ? updateHz : 1.0f)),
+	font(NULL), text(256), textures(NULL), textureHandle(INVALID_TEXTURE), texture(0), framebuffer(0), graphProgram(0), graphMatrixLocation(-1),
+	graphBuffer(0), overlayProgram(0), overlayRectLocation(-1), quadBuffer(0),
+	history(max(width / BAR_WIDTH, 1), 0.0f), newest(0), frames(0), elapsedMs(0.0f),
+	worstMs(0.0f), drawCalls(0.0), triangles(0.0), stateChanges(0.0), textureBytes(0), redraws(0) {
+}
+
+PerfHud::~PerfHud() {
+	glDeleteFramebuffers(1, &framebuffer);
+	if (textures)
+		textures->release(textureHandle);
+	else
+		glDeleteTextures(1, &texture);
+	glDeleteBuffers(1, &graphBuffer);
+	glDeleteBuffers(1, &quadBuffer);
+	glDeleteProgram(graphProgram);
+	glDeleteProgram(overlayProgram);
+}
+
+bool PerfHud::init(const SdfFont* font_, TextureManager* textures_) {
+	font = font_;
+	textures = textures_;
+	if (!font || !text.init())
+		return false;
+
+	//myUV is unused; it only keeps myColor at COLOR_ARRAY
+	const char* graphAttribs[] = { "myVertex", "myUV", "myColor" };
+	graphProgram = buildProgram(pszGraphVertShader, pszGraphFragShader, graphAttribs, 3);
+	const char* overlayAttribs[] = { "myVertex" };
+	overlayProgram = buildProgram(pszOverlayVertShader, pszOverlayFragShader, overlayAttribs, 1);
+	if (!graphProgram || !overlayProgram)
+		return false;
+	graphMatrixLocation = glGetUniformLocation(graphProgram, "myPMVMatrix");
+	glUseProgram(overlayProgram);
+	glUniform1i(glGetUniformLocation(overlayProgram, "sampler2d"), 0);
+	overlayRectLocation = glGetUniformLocation(overlayProgram, "myRect");
+
+	//One texel per screen pixel, so nearest filtering is exact
+	if (textures) {
+		textureHandle = textures->createRenderTarget(hudWidth, hudHeight);
+		texture = textures->texture(textureHandle);
+		glBindTexture(GL_TEXTURE_2D, texture);
+	} else {
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, hudWidth, hudHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	GLint previous;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, previous);
+	if (!complete)
+		return false;
+
+	const GLfloat quad[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+	glGenBuffers(1, &quadBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+	//Panel, two budget lines and a bar per history sample
+	glGenBuffers(1, &graphBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, graphBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (history.size() + 3) * 6 * sizeof(GraphVertex), NULL, GL_STREAM_DRAW);
+	vertices.reserve((history.size() + 3) * 6);
+
+	redraw();
+	return true;
+}
+
+void PerfHud::frame(const FrameStats& stats) {
+	newest = (newest + 1) % (int)history.size();
+	history[newest] = stats.frameMs;
+
+	frames++;
+	elapsedMs += stats.frameMs;
+	worstMs = max(worstMs, stats.frameMs);
+	drawCalls += stats.drawCalls;
+	triangles += stats.triangles;
+	stateChanges += stats.stateChanges;
+	textureBytes = stats.textureBytes;
+	if (elapsedMs >= periodMs && framebuffer)
+		redraw();
+}
+
+void PerfHud::addRect(float x0, float y0, float x1, float y1, GLuint color) {
+	GraphVertex corner;
+	corner.r = (GLubyte)(color & 0xff);
+	corner.g = (GLubyte)((color >> 8) & 0xff);
+	corner.b = (GLubyte)((color >> 16) & 0xff);
+	corner.a = (GLubyte)(color >> 24);
+	const float xs[6] = { x0, x1, x1, x0, x1, x0 };
+	const float ys[6] = { y0, y0, y1, y0, y1, y1 };
+	for (int i = 0; i < 6; i++) {
+		corner.x = xs[i];
+		corner.y = ys[i];
+		vertices.push_back(corner);
+	}
+}
+
+void PerfHud::redraw() {
+	GLint previousFramebuffer, previousViewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, hudWidth, hudHeight);
+
+	//Overlay pixels, origin bottom-left
+	const GLfloat pixels[16] = {
+		2.0f / hudWidth, 0.0f, 0.0f, 0.0f,
+		0.0f, 2.0f / hudHeight, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		-1.0f, -1.0f, 0.0f, 1.0f
+	};
+
+	//The graph scale fits 30 Hz frames, or the worst frame shown if longer
+	float graphHeight = hudHeight - TEXT_LINES * TEXT_SIZE * font->lineHeight() - 4.0f;
+	float scaleMs = 1000.0f / 30.0f;
+	for (size_t i = 0; i < history.size(); i++)
+		scaleMs = max(scaleMs, history[i]);
+	float pixelsPerMs = graphHeight / (scaleMs * 1.1f);
+
+	vertices.clear();
+	addRect(0.0f, 0.0f, (float)hudWidth, (float)hudHeight, PANEL_COLOR);
+	for (int hz = 60; hz >= 30; hz -= 30) {
+		float y = 1000.0f / hz * pixelsPerMs;
+		addRect(0.0f, y, (float)hudWidth, y + 1.0f, BUDGET_COLOR);
+	}
+	//Oldest sample on the left
+	int count = (int)history.size();
+	for (int i = 0; i < count; i++) {
+		float ms = history[(newest + 1 + i) % count];
+		if (ms > 0.0f)
+			addRect((float)(i * BAR_WIDTH), 0.0f, (float)((i + 1) * BAR_WIDTH - 1), ms * pixelsPerMs, barColor(ms));
+	}
+
+	glUseProgram(graphProgram);
+	glUniformMatrix4fv(graphMatrixLocation, 1, GL_FALSE, pixels);
+	glBindBuffer(GL_ARRAY_BUFFER, graphBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.capacity() * sizeof(GraphVertex), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(GraphVertex), &vertices[0]);
+	glEnableVertexAttribArray(VERTEX_ARRAY);
+	glEnableVertexAttribArray(COLOR_ARRAY);
+	glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, sizeof(GraphVertex), (void*)0);
+	glVertexAttribPointer(COLOR_ARRAY, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GraphVertex), (void*)(2 * sizeof(GLfloat)));
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+	glDisableVertexAttribArray(COLOR_ARRAY);
+
+	ostringstream line[TEXT_LINES];
+	float meanMs = frames ? elapsedMs / frames : 0.0f;
+	float perFrame = frames ? 1.0f / frames : 0.0f;
+	for (int i = 0; i < TEXT_LINES; i++)
+		line[i] << fixed;
+	line[0] << setprecision(1) << (meanMs > 0.0f ? 1000.0f / meanMs : 0.0f) << " FPS  "
+			<< setprecision(2) << meanMs << " ms  max " << setprecision(1) << worstMs;
+	line[1] << "draws " << setprecision(0) << drawCalls * perFrame
+			<< "  tris " << setprecision(1) << triangles * perFrame / 1000.0 << "k";
+	line[2] << "tex " << setprecision(1) << textureBytes / (1024.0 * 1024.0)
+			<< " MB  state " << setprecision(0) << stateChanges * perFrame;
+	text.begin(pixels, hudWidth, hudHeight);
+	float baseline = hudHeight - TEXT_SIZE;
+	for (int i = 0; i < TEXT_LINES; i++)
+		text.draw(*font, line[i].str().c_str(), 4.0f, baseline - i * TEXT_SIZE * font->lineHeight(), TEXT_SIZE, TEXT_COLOR);
+	text.end();
+
+	//The text batch leaves its buffers bound, which would turn client
+	//index and vertex pointers drawn next into offsets into them
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glDisableVertexAttribArray(TEXCOORD_ARRAY);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+
+	frames = 0;
+	elapsedMs = 0.0f;
+	worstMs = 0.0f;
+	drawCalls = triangles = stateChanges = 0.0;
+	redraws++;
+}
+
+void PerfHud::draw(int x, int y, int viewportWidth, int viewportHeight) {
+	if (!framebuffer)
+		return;
+	GLfloat rect[4] = {
+		2.0f * x / viewportWidth - 1.0f,
+		2.0f * y / viewportHeight - 1.0f,
+		2.0f * (x + hudWidth) / viewportWidth - 1.0f,
+		2.0f * (y + hudHeight) / viewportHeight - 1.0f
+	};
+	glUseProgram(overlayProgram);
+	glUniform4fv(overlayRectLocation, 1, rect);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+	glEnableVertexAttribArray(VERTEX_ARRAY);
+	glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glDisable(GL_BLEND);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,105 @@
+#ifndef PERF_HUD_H_INCLUDED
+#define PERF_HUD_H_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+#include <GLES2/gl2.h>
+#include "sdffont.h"
+#include "textbatch.h"
+#include "texturemanager.h"
+
+//What the application counted during one frame
+struct FrameStats {
+	float frameMs;			//CPU time from the start of this frame to the next
+	int drawCalls;
+	int triangles;
+	size_t textureBytes;	//Resident texture memory, e.g. TextureManager::currentBytes()
+	int stateChanges;		//Program, texture and buffer binds
+};
+
+/* Live overlay of frame times and counters for any demo.
+ *
+ * The overlay is rendered into its own small RGBA texture: a graph of the
+ * last frame times, one bar per frame against the 60 and 30 Hz budgets,
+ * and three lines of text with FPS, the mean and worst frame time, draw
+ * calls, triangles, texture memory and state changes.  That redraw costs
+ * two or three draw calls but only happens updateHz times a second;
+ * every other frame frame() just stores a sample and draw() blends the
+ * texture over the scene with a single textured quad.
+ *
+ * The numbers shown are averaged over the frames since the last redraw,
+ * so the text stays readable.  Time is taken from the frameMs of the
+ * samples, so the overlay needs no clock of its own.
+ */
+class PerfHud {
+	public:
+		//Size of the overlay texture in pixels
+		explicit PerfHud(int width = 256, int height = 128, float updateHz = 4.0f);
+		~PerfHud();
+
+		//Creates the texture, framebuffer and programs; font must be
+		//uploaded and outlive the overlay.  With textures, the overlay
+		//texture is a render target of that manager, counted in its
+		//currentBytes(); the manager must outlive the overlay.  Needs a
+		//current context.
+		bool init(const SdfFont* font, TextureManager* textures = NULL);
+
+		//Records a frame and redraws the texture when 1 / updateHz seconds
+		//of frames went by.  A redraw binds the overlay framebuffer and
+		//viewport, then restores the ones that were bound; it leaves no
+		//array or element buffer bound.
+		void frame(const FrameStats& stats);
+
+		//Blends the overlay over the bound framebuffer with its bottom-left
+		//corner at pixel x, y of a viewport of the given size.  Leaves
+		//blending disabled, no array buffer bound and the overlay program
+		//bound.
+		void draw(int x, int y, int viewportWidth, int viewportHeight);
+
+		int width() const { return hudWidth; }
+		int height() const { return hudHeight; }
+		int redrawCount() const { return redraws; }
+
+	private:
+		//Colored vertex of the graph, 12 bytes
+		struct GraphVertex {
+			GLfloat x, y;
+			GLubyte r, g, b, a;
+		};
+
+		void redraw();
+		void addRect(float x0, float y0, float x1, float y1, GLuint color);
+
+		int hudWidth;
+		int hudHeight;
+		float periodMs;
+		const SdfFont* font;
+		TextBatch text;
+
+		TextureManager* textures;
+		TextureHandle textureHandle;
+		GLuint texture;
+		GLuint framebuffer;
+		GLuint graphProgram;
+		GLint graphMatrixLocation;
+		GLuint graphBuffer;
+		GLuint overlayProgram;
+		GLint overlayRectLocation;
+		GLuint quadBuffer;
+
+		std::vector<float> history;	//Ring of frame times, one per graph bar
+		int newest;
+		std::vector<GraphVertex> vertices;
+
+		//Sums over the frames since the last redraw
+		int frames;
+		float elapsedMs;
+		float worstMs;
+		double drawCalls;
+		double triangles;
+		double stateChanges;
+		size_t textureBytes;
+		int redraws;
+};
+
+#endif
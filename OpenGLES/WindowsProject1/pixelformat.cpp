@@ -0,0 +1,143 @@
+#include "stdafx.h"
+#include "pixelformat.h"
+#include "jobsystem.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PIXEL_FORMAT_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+	//4x4 Bayer matrix, the order in which thresholds are crossed
+	const int BAYER[4][4] = {
+		{  0,  8,  2, 10 },
+		{ 12,  4, 14,  6 },
+		{  3, 11,  1,  9 },
+		{ 15,  7, 13,  5 }
+	};
+
+	//Bit layout of a packed format
+	struct Layout {
+		int bits[3];	//Red, green and blue
+		int shift[3];
+		unsigned short alpha;	//Opaque alpha bits
+	};
+
+	Layout layoutOf(PixelFormat format) {
+		Layout layout;
+		switch (format) {
+			case PIXEL_RGBA4444: {
+				Layout rgba4444 = { { 4, 4, 4 }, { 12, 8, 4 }, 0x000f };
+				layout = rgba4444;
+				break;
+			}
+			case PIXEL_RGBA5551: {
+				Layout rgba5551 = { { 5, 5, 5 }, { 11, 6, 1 }, 0x0001 };
+				layout = rgba5551;
+				break;
+			}
+			default: {
+				Layout rgb565 = { { 5, 6, 5 }, { 11, 5, 0 }, 0x0000 };
+				layout = rgb565;
+				break;
+			}
+		}
+		return layout;
+	}
+
+	/* A channel quantises to q = (value * maxLevel + threshold) / 255.  A
+	 * threshold of 127 rounds to the nearest level; Bayer thresholds spread
+	 * over 8..248 round up or down in a fixed pattern whose average over the
+	 * 4x4 cell is the exact value.
+	 */
+	int threshold(bool dither, int x, int y) {
+		return dither ? BAYER[y & 3][x & 3] * 16 + 8 : 127;
+	}
+
+	//x / 255 for 0 <= x < 65535
+	int divide255(int x) {
+		return (x + 1 + (x >> 8)) >> 8;
+	}
+
+	void convertRows(const unsigned char* rgb, int width, PixelFormat format, bool dither,
+					 unsigned short* out, int first, int last) {
+		Layout layout = layoutOf(format);
+		int maxLevel[3];
+		for (int c = 0; c < 3; c++)
+			maxLevel[c] = (1 << layout.bits[c]) - 1;
+
+		for (int y = first; y < last; y++) {
+			const unsigned char* row = rgb + 3 * width * y;
+			unsigned short* target = out + width * y;
+			int x = 0;
+#ifdef PIXEL_FORMAT_USE_SSE2
+			//The dither pattern repeats every 4 texels, twice per register
+			__m128i thresholds = _mm_setr_epi16(
+				(short)threshold(dither, 0, y), (short)threshold(dither, 1, y),
+				(short)threshold(dither, 2, y), (short)threshold(dither, 3, y),
+				(short)threshold(dither, 0, y), (short)threshold(dither, 1, y),
+				(short)threshold(dither, 2, y), (short)threshold(dither, 3, y));
+			__m128i one = _mm_set1_epi16(1);
+			__m128i alpha = _mm_set1_epi16((short)layout.alpha);
+			for (; x + 8 <= width; x += 8) {
+				const unsigned char* texels = row + 3 * x;
+				__m128i packed = alpha;
+				for (int c = 0; c < 3; c++) {
+					__m128i value = _mm_setr_epi16(texels[c], texels[3 + c], texels[6 + c], texels[9 + c],
+						texels[12 + c], texels[15 + c], texels[18 + c], texels[21 + c]);
+					__m128i scaled = _mm_add_epi16(_mm_mullo_epi16(value, _mm_set1_epi16((short)maxLevel[c])), thresholds);
+					__m128i level = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(scaled, one), _mm_srli_epi16(scaled, 8)), 8);
+					packed = _mm_or_si128(packed, _mm_sll_epi16(level, _mm_cvtsi32_si128(layout.shift[c])));
+				}
+				_mm_storeu_si128((__m128i*)(target + x), packed);
+			}
+#endif
+			for (; x < width; x++) {
+				int t = threshold(dither, x, y);
+				unsigned short texel = layout.alpha;
+				for (int c = 0; c < 3; c++)
+					texel |= (unsigned short)(divide255(row[3 * x + c] * maxLevel[c] + t) << layout.shift[c]);
+				target[x] = texel;
+			}
+		}
+	}
+}
+
+int pixelFormatSize(PixelFormat format) {
+	return format == PIXEL_RGB888 ? 3 : 2;
+}
+
+GLenum pixelFormatGLFormat(PixelFormat format) {
+	return format == PIXEL_RGB888 || format == PIXEL_RGB565 ? GL_RGB : GL_RGBA;
+}
+
+GLenum pixelFormatGLType(PixelFormat format) {
+	switch (format) {
+		case PIXEL_RGB565:
+			return GL_UNSIGNED_SHORT_5_6_5;
+		case PIXEL_RGBA4444:
+			return GL_UNSIGNED_SHORT_4_4_4_4;
+		case PIXEL_RGBA5551:
+			return GL_UNSIGNED_SHORT_5_5_5_1;
+		default:
+			return GL_UNSIGNED_BYTE;
+	}
+}
+
+void convertRGB(const char* rgb, int width, int height, PixelFormat format,
+				bool dither, unsigned short* out, int threads) {
+	const unsigned char* pixels = (const unsigned char*)rgb;
+	parallelRanges(height, threads, [&](int first, int last) {
+		convertRows(pixels, width, format, dither, out, first, last);
+	});
+}
+
+unsigned short* convertImage(const Image* image, PixelFormat format, bool dither, int threads) {
+	if (format == PIXEL_RGB888)
+		return NULL;
+	unsigned short* texels = new unsigned short[image->width * image->height];
+	convertRGB(image->pixels, image->width, image->height, format, dither, texels, threads);
+	return texels;
+}
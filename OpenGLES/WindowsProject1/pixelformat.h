@@ -0,0 +1,52 @@
+#ifndef PIXEL_FORMAT_H_INCLUDED
+#define PIXEL_FORMAT_H_INCLUDED
+
+#include <GLES2/gl2.h>
+#include "imageloader.h"
+
+/* Texel formats a texture can be stored in.
+ *
+ * Drivers pad GL_RGB/GL_UNSIGNED_BYTE to 32 bits per texel, so the 16-bit
+ * packed formats halve both the texture memory and the bytes every sample
+ * fetches, and halve the upload too (2 bytes per texel instead of 3):
+ *
+ *   format        bits/texel  memory vs RGBX8  precision
+ *   RGB888        32 on GPU   1x               8:8:8
+ *   RGB565        16          0.5x             5:6:5
+ *   RGBA4444      16          0.5x             4:4:4:4
+ *   RGBA5551      16          0.5x             5:5:5:1
+ *
+ * A 1024x1024 texture drops from 4 MB to 2 MB (2.7 MB to 1.3 MB with mips).
+ * The cost is banding in smooth gradients, which the ordered dither below
+ * trades for fine noise that is invisible at TV viewing distance.  Images
+ * from loadBMP have no alpha, so the RGBA formats store opaque texels; they
+ * are meant for assets that add alpha later.  Photos should prefer ETC1.
+ */
+enum PixelFormat {
+	PIXEL_RGB888,
+	PIXEL_RGB565,
+	PIXEL_RGBA4444,
+	PIXEL_RGBA5551
+};
+
+//Bytes of one texel in the format
+int pixelFormatSize(PixelFormat format);
+
+//The format and type arguments of glTexImage2D for the format
+GLenum pixelFormatGLFormat(PixelFormat format);
+GLenum pixelFormatGLType(PixelFormat format);
+
+//Converts tightly packed RGB rows (the layout of Image::pixels) into 16-bit
+//texels of a packed format, rounding to the nearest level, or with dither
+//set, through a 4x4 ordered (Bayer) dither.  out holds width * height
+//texels; rows are tightly packed, so upload them with GL_UNPACK_ALIGNMENT 2.
+//The arithmetic runs on SSE2 eight texels at a time where available, and
+//rows are split into threads jobs, threads <= 0 letting the job system choose.
+void convertRGB(const char* rgb, int width, int height, PixelFormat format,
+				bool dither, unsigned short* out, int threads = 0);
+
+//Converts a whole image, the caller deletes[] the result.  Returns NULL for
+//PIXEL_RGB888, which needs no conversion.
+unsigned short* convertImage(const Image* image, PixelFormat format, bool dither, int threads = 0);
+
+#endif
@@ -0,0 +1,121 @@
+#include "stdafx.h"
+#include <string.h>
+#include "renderqueue.h"
+
+// Index to bind the attributes to vertex shaders
+#define VERTEX_ARRAY	0
+#define TEXCOORD_ARRAY	1
+
+#define DEPTH_BITS		24
+#define PROGRAM_BITS	11
+#define TEXTURE_BITS	16
+
+SortKey makeSortKey(int layer, bool translucent, GLuint program, GLuint texture, float depth) {
+	depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+	SortKey depthBits = (SortKey)(depth * ((1 << DEPTH_BITS) - 1));
+	SortKey programBits = program & ((1 << PROGRAM_BITS) - 1);
+	SortKey textureBits = texture & ((1 << TEXTURE_BITS) - 1);
+
+	SortKey key = (SortKey)(layer & 0xf) << 60;
+	if (!translucent)
+		return key | programBits << 48 | textureBits << 32 | depthBits << 8;
+	SortKey farFirst = ((1 << DEPTH_BITS) - 1) - depthBits;
+	return key | (SortKey)1 << 59 | farFirst << 35 | programBits << 24 | textureBits << 8;
+}
+
+RenderQueue::RenderQueue(int reserve) : programChanges(0), textureChanges(0) {
+	items.reserve(reserve);
+	scratch.reserve(reserve);
+	draws.reserve(reserve);
+}
+
+void RenderQueue::clear() {
+	items.clear();
+	draws.clear();
+	programChanges = 0;
+	textureChanges = 0;
+}
+
+void RenderQueue::submit(SortKey key, const QueuedDraw& draw) {
+	Item item = { key, (int)draws.size() };
+	items.push_back(item);
+	draws.push_back(draw);
+}
+
+void RenderQueue::submit(int layer, bool translucent, float depth, const QueuedDraw& draw) {
+	submit(makeSortKey(layer, translucent, draw.program, draw.texture, depth), draw);
+}
+
+void RenderQueue::sort() {
+	size_t count = items.size();
+	if (count < 2)
+		return;
+	scratch.resize(count);
+
+	//Bits that differ between keys; bytes without any are already sorted
+	SortKey differ = 0;
+	for (size_t i = 1; i < count; i++)
+		differ |= items[i].key ^ items[0].key;
+
+	Item* source = &items[0];
+	Item* target = &scratch[0];
+	for (int shift = 0; shift < 64; shift += 8) {
+		if (!((differ >> shift) & 0xff))
+			continue;
+
+		size_t offsets[256];
+		memset(offsets, 0, sizeof(offsets));
+		for (size_t i = 0; i < count; i++)
+			offsets[(source[i].key >> shift) & 0xff]++;
+		size_t total = 0;
+		for (int b = 0; b < 256; b++) {
+			size_t n = offsets[b];
+			offsets[b] = total;
+			total += n;
+		}
+		for (size_t i = 0; i < count; i++)
+			target[offsets[(source[i].key >> shift) & 0xff]++] = source[i];
+
+		Item* swap = source;
+		source = target;
+		target = swap;
+	}
+	if (source != &items[0])
+		items.swap(scratch);
+}
+
+void RenderQueue::execute(CommandBackend& backend) {
+	GLuint program = 0;
+	GLuint texture = 0;
+	bool texCoords = false;
+	bool first = true;
+	for (size_t i = 0; i < items.size(); i++) {
+		const QueuedDraw& draw = draws[items[i].draw];
+		if (first || draw.program != program) {
+			backend.useProgram(draw.program);
+			program = draw.program;
+			programChanges++;
+		}
+		if (draw.texture && (first || draw.texture != texture)) {
+			backend.bindTexture(0, draw.texture);
+			texture = draw.texture;
+			textureChanges++;
+		}
+		first = false;
+
+		backend.uniformMatrix4(draw.matrixLocation, draw.matrix);
+		backend.vertexArray(VERTEX_ARRAY, draw.size, GL_FLOAT, false, draw.stride, draw.vertices);
+		if (draw.texCoords) {
+			backend.vertexArray(TEXCOORD_ARRAY, 2, GL_FLOAT, false, draw.stride, draw.texCoords);
+			texCoords = true;
+		}
+		else if (texCoords) {
+			//Left enabled, it would read the last textured draw's pointer
+			backend.disableVertexArray(TEXCOORD_ARRAY);
+			texCoords = false;
+		}
+		backend.drawArrays(draw.mode, draw.first, draw.count);
+	}
+	if (texCoords)
+		backend.disableVertexArray(TEXCOORD_ARRAY);
+}
@@ -0,0 +1,78 @@
+#ifndef RENDER_QUEUE_H_INCLUDED
+#define RENDER_QUEUE_H_INCLUDED
+
+#include <vector>
+#include <GLES2/gl2.h>
+#include "commandlist.h"
+
+typedef unsigned long long SortKey;
+
+/* Packs the draw order into 64 bits, most significant first:
+ *
+ *   layer (4) | translucent (1) | opaque:      program (11) | texture (16) | depth (24) | 8 unused
+ *                               | translucent: far depth (24) | program (11) | texture (16) | 8 unused
+ *
+ * Layers draw in order and opaque draws come before translucent ones.
+ * Opaque draws are grouped by program, then texture, then drawn front to
+ * back; translucent ones have to be drawn back to front, so depth leads and
+ * state only groups draws at equal depth.  program and texture are GL names
+ * masked to their fields; names past the masks only cost sorting quality.
+ * depth is 0 (near) to 1 (far).
+ */
+SortKey makeSortKey(int layer, bool translucent, GLuint program, GLuint texture, float depth);
+
+//What one queued draw needs; the pointers must stay valid until execute()
+struct QueuedDraw {
+	GLuint program;
+	GLuint texture;			//0 for untextured draws
+	GLint matrixLocation;
+	const GLfloat* matrix;
+	const void* vertices;	//Client array or offset into the bound buffer
+	const void* texCoords;	//(u, v) pairs with the same stride, NULL if none
+	int size;				//Position floats per vertex
+	int stride;
+	GLenum mode;
+	int first;
+	int count;
+};
+
+/* Collects a frame's draws with their sort keys, orders them with an LSD
+ * radix sort (a byte per pass, skipping bytes every key shares) and replays
+ * them, binding a program or texture only where it differs from the
+ * previous draw.
+ */
+class RenderQueue {
+	public:
+		explicit RenderQueue(int reserve = 1024);
+
+		//Empties the queue and the switch counters, keeping the memory
+		void clear();
+
+		void submit(SortKey key, const QueuedDraw& draw);
+		void submit(int layer, bool translucent, float depth, const QueuedDraw& draw);
+
+		//Orders the queue by key; equal keys keep their submission order
+		void sort();
+
+		//Sends the draws, in queue order, to backend.  The texture
+		//coordinate array is only enabled for draws that have one.
+		void execute(CommandBackend& backend);
+
+		int size() const { return (int)items.size(); }
+		int programSwitches() const { return programChanges; }
+		int textureSwitches() const { return textureChanges; }
+
+	private:
+		struct Item {
+			SortKey key;
+			int draw;	//Index in draws
+		};
+
+		std::vector<Item> items;
+		std::vector<Item> scratch;
+		std::vector<QueuedDraw> draws;
+		int programChanges;
+		int textureChanges;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#include "stdafx.h"
+#include <math.h>
+#include <string.h>
+#include <windows.h>
+#include <vector>
+#include "sdffont.h"
+#include "jobsystem.h"
+
+using namespace std;
+
+// Glyphs are rasterized this many times larger than the field is stored
+#define SDF_SUPERSAMPLE	4
+// Atlas pages of one font
+#define SDF_PAGE_SIZE	1024
+
+namespace {
+	//Offset from a texel to the nearest seed texel
+	struct Offset {
+		int dx, dy;
+		int length2() const { return dx * dx + dy * dy; }
+	};
+
+	const Offset FAR_AWAY = { 1 << 14, 1 << 14 };
+
+	void compare(vector<Offset>& grid, int width, int x, int y, int ox, int oy) {
+		Offset other = grid[(y + oy) * width + x + ox];
+		other.dx += ox;
+		other.dy += oy;
+		if (other.length2() < grid[y * width + x].length2())
+			grid[y * width + x] = other;
+	}
+
+	//8SSEDT: every texel ends up with the offset to its nearest seed (offset
+	//0), in two sweeps of the grid
+	void distanceSweep(vector<Offset>& grid, int width, int height) {
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				if (x > 0)
+					compare(grid, width, x, y, -1, 0);
+				if (y > 0) {
+					compare(grid, width, x, y, 0, -1);
+					if (x > 0)
+						compare(grid, width, x, y, -1, -1);
+					if (x + 1 < width)
+						compare(grid, width, x, y, 1, -1);
+				}
+			}
+			for (int x = width - 2; x >= 0; x--)
+				compare(grid, width, x, y, 1, 0);
+		}
+		for (int y = height - 1; y >= 0; y--) {
+			for (int x = width - 1; x >= 0; x--) {
+				if (x + 1 < width)
+					compare(grid, width, x, y, 1, 0);
+				if (y + 1 < height) {
+					compare(grid, width, x, y, 0, 1);
+					if (x > 0)
+						compare(grid, width, x, y, -1, 1);
+					if (x + 1 < width)
+						compare(grid, width, x, y, 1, 1);
+				}
+			}
+			for (int x = 1; x < width; x++)
+				compare(grid, width, x, y, -1, 0);
+		}
+	}
+
+	//Rasterized glyph waiting for its distance field
+	struct GlyphBitmap {
+		int width, height;			//Supersampled, spread included
+		vector<unsigned char> inside;	//Top-down, 1 inside the outline
+		Image* field;
+	};
+
+	//Samples the signed distance of bitmap at the centre of every
+	//SDF_SUPERSAMPLE block into a one byte per texel image, rows bottom-up
+	Image* buildField(const GlyphBitmap& bitmap, int spread) {
+		int width = bitmap.width, height = bitmap.height;
+		vector<Offset> toInside(width * height), toOutside(width * height);
+		for (int i = 0; i < width * height; i++) {
+			Offset zero = { 0, 0 };
+			toInside[i] = bitmap.inside[i] ? zero : FAR_AWAY;
+			toOutside[i] = bitmap.inside[i] ? FAR_AWAY : zero;
+		}
+		distanceSweep(toInside, width, height);
+		distanceSweep(toOutside, width, height);
+
+		int fieldWidth = width / SDF_SUPERSAMPLE, fieldHeight = height / SDF_SUPERSAMPLE;
+		char* pixels = new char[fieldWidth * fieldHeight];
+		for (int y = 0; y < fieldHeight; y++) {
+			int sy = y * SDF_SUPERSAMPLE + SDF_SUPERSAMPLE / 2;
+			unsigned char* row = (unsigned char*)pixels + fieldWidth * (fieldHeight - 1 - y);
+			for (int x = 0; x < fieldWidth; x++) {
+				int i = sy * width + x * SDF_SUPERSAMPLE + SDF_SUPERSAMPLE / 2;
+				float distance = (sqrtf((float)toOutside[i].length2()) - sqrtf((float)toInside[i].length2())) /
+					SDF_SUPERSAMPLE;
+				float value = 128.0f + 127.0f * distance / spread;
+				unsigned char texel = (unsigned char)(value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value + 0.5f));
+				row[x] = texel;
+			}
+		}
+		return new Image(pixels, fieldWidth, fieldHeight);
+	}
+}
+
+SdfFont::SdfFont() : size(0), spreadTexels(0), lineGap(0.0f), built(false),
+	pages(SDF_PAGE_SIZE, SDF_PAGE_SIZE, 1, 2, 1, 1) {
+	memset(glyphs, 0, sizeof(glyphs));
+}
+
+bool SdfFont::build(const char* fontFile, const char* faceName, int glyphSize, int spread) {
+	size = glyphSize;
+	spreadTexels = spread;
+	if (fontFile && !AddFontResourceExA(fontFile, FR_PRIVATE, 0))
+		return false;
+
+	HDC hDC = CreateCompatibleDC(NULL);
+	HFONT hFont = CreateFontA(-glyphSize * SDF_SUPERSAMPLE, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+		ANSI_CHARSET, OUT_TT_ONLY_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY,
+		DEFAULT_PITCH, faceName);
+	if (!hDC || !hFont) {
+		if (hDC)
+			DeleteDC(hDC);
+		if (fontFile)
+			RemoveFontResourceExA(fontFile, FR_PRIVATE, 0);
+		return false;
+	}
+	HGDIOBJ hOldFont = SelectObject(hDC, hFont);
+
+	TEXTMETRICA metrics;
+	GetTextMetricsA(hDC, &metrics);
+	float em = (float)(glyphSize * SDF_SUPERSAMPLE);
+	lineGap = (metrics.tmHeight + metrics.tmExternalLeading) / em;
+
+	//GDI rasterizes on this thread; the distance fields are computed in
+	//parallel afterwards
+	const int count = LAST_CHAR - FIRST_CHAR + 1;
+	vector<GlyphBitmap> bitmaps(count);
+	int border = spread * SDF_SUPERSAMPLE;
+	MAT2 identity = { { 0, 1 }, { 0, 0 }, { 0, 0 }, { 0, 1 } };
+	vector<unsigned char> gray;
+	for (int i = 0; i < count; i++) {
+		SdfGlyph& glyph = glyphs[i];
+		GlyphBitmap& bitmap = bitmaps[i];
+		bitmap.field = NULL;
+		glyph.region = -1;
+
+		GLYPHMETRICS gm;
+		DWORD bytes = GetGlyphOutlineW(hDC, (WCHAR)(FIRST_CHAR + i), GGO_GRAY8_BITMAP, &gm, 0, NULL, &identity);
+		if (bytes == GDI_ERROR) {
+			glyph.advance = 0.0f;
+			continue;
+		}
+		glyph.advance = gm.gmCellIncX / em;
+		if (bytes == 0)
+			continue;
+		gray.resize(bytes);
+		GetGlyphOutlineW(hDC, (WCHAR)(FIRST_CHAR + i), GGO_GRAY8_BITMAP, &gm, bytes, &gray[0], &identity);
+
+		//Rows of 0..64 coverage, DWORD aligned, top-down; pad the box with
+		//the spread and round it up to whole field texels
+		int boxWidth = gm.gmBlackBoxX, boxHeight = gm.gmBlackBoxY;
+		int pitch = (boxWidth + 3) & ~3;
+		bitmap.width = (boxWidth + 2 * border + SDF_SUPERSAMPLE - 1) / SDF_SUPERSAMPLE * SDF_SUPERSAMPLE;
+		bitmap.height = (boxHeight + 2 * border + SDF_SUPERSAMPLE - 1) / SDF_SUPERSAMPLE * SDF_SUPERSAMPLE;
+		bitmap.inside.assign(bitmap.width * bitmap.height, 0);
+		for (int y = 0; y < boxHeight; y++) {
+			for (int x = 0; x < boxWidth; x++)
+				bitmap.inside[(y + border) * bitmap.width + x + border] = gray[y * pitch + x] >= 32;
+		}
+
+		glyph.x0 = (gm.gmptGlyphOrigin.x - border) / em;
+		glyph.y1 = (gm.gmptGlyphOrigin.y + border) / em;
+		glyph.x1 = glyph.x0 + bitmap.width / em;
+		glyph.y0 = glyph.y1 - bitmap.height / em;
+	}
+
+	SelectObject(hDC, hOldFont);
+	DeleteObject(hFont);
+	DeleteDC(hDC);
+	if (fontFile)
+		RemoveFontResourceExA(fontFile, FR_PRIVATE, 0);
+
+	parallelRanges(count, 0, [&](int first, int last) {
+		for (int i = first; i < last; i++) {
+			if (!bitmaps[i].inside.empty())
+				bitmaps[i].field = buildField(bitmaps[i], spread);
+		}
+	});
+
+	for (int i = 0; i < count; i++) {
+		if (bitmaps[i].field)
+			glyphs[i].region = pages.add(bitmaps[i].field);
+	}
+	bool packed = pages.build();
+	for (int i = 0; i < count; i++)
+		delete bitmaps[i].field;
+	built = packed;
+	return packed;
+}
+
+void SdfFont::upload() {
+	if (built)
+		pages.upload();
+}
+
+const SdfGlyph* SdfFont::glyph(int c) const {
+	if (!built || c < FIRST_CHAR || c > LAST_CHAR)
+		return NULL;
+	return &glyphs[c - FIRST_CHAR];
+}
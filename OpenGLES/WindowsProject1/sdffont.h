@@ -0,0 +1,61 @@
+#ifndef SDF_FONT_H_INCLUDED
+#define SDF_FONT_H_INCLUDED
+
+#include <vector>
+#include "atlas.h"
+
+//Placement of one character, in ems (multiples of the font size)
+struct SdfGlyph {
+	float advance;			//Pen movement to the next character
+	float x0, y0, x1, y1;	//Quad around the pen position on the baseline, y up
+	int region;				//Region of the atlas, -1 for blank glyphs
+};
+
+/* Printable ASCII glyphs of a font file as signed distance fields.
+ *
+ * Every glyph is rasterized by GDI at 4x glyphSize, the distance from each
+ * texel to the outline is computed with a two pass 8-neighbour sweep, and
+ * the field is sampled down to glyphSize texels per em.  Texels store
+ * 128 + 127 * distance / spread, positive inside; spread is the distance
+ * in glyphSize texels that the field covers either side of the outline,
+ * one byte per texel in GL_LUMINANCE atlas pages.
+ * Because filtering a distance keeps the outline where it was, the same
+ * atlas draws sharp text at any size (see TextBatch).
+ *
+ * build() needs no GL context and only touches GDI through its own device
+ * context, so it can run as a job while the demo carries on; upload() must
+ * then be called on the thread that owns the context.
+ */
+class SdfFont {
+	public:
+		SdfFont();
+
+		//Rasterizes the glyphs of the face faceName from fontFile (a .ttf
+		//or .otf; NULL for an installed face).  Call once.  Returns false if
+		//the face can't be created or the glyphs don't fit the atlas.
+		bool build(const char* fontFile, const char* faceName,
+				   int glyphSize = 48, int spread = 6);
+
+		//Creates the atlas textures; needs a current context
+		void upload();
+
+		//The glyph of c, or NULL if the font has none
+		const SdfGlyph* glyph(int c) const;
+
+		float lineHeight() const { return lineGap; }	//In ems
+		int spread() const { return spreadTexels; }
+		int glyphSize() const { return size; }
+		const TextureAtlas& atlas() const { return pages; }
+
+	private:
+		enum { FIRST_CHAR = 32, LAST_CHAR = 126 };
+
+		int size;
+		int spreadTexels;
+		float lineGap;
+		SdfGlyph glyphs[LAST_CHAR - FIRST_CHAR + 1];
+		bool built;
+		TextureAtlas pages;
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include "stdafx.h"
+#include <math.h>
+#include "shapes.h"
+#include "shapetables.h"
+#include "jobsystem.h"
+
+#define PI 3.14159
+#define START_TOP		0.0f
+#define END_TOP			180.0f
+#define START_RIGHT		-90.0f
+#define END_RIGHT		90.0f
+
+// Arcs with fewer vertices are cheaper to write than to hand out as jobs
+#define PARALLEL_ARC_VERTICES	4096
+
+namespace
+{
+	// Built by the compiler; angles on a whole degree are looked up here
+	constexpr TrigTable TRIG_DEGREES;
+
+	// Index in TRIG_DEGREES of degrees, or -1 if it isn't a whole degree
+	int wholeDegree(float degrees)
+	{
+		if (degrees < -1e6f || degrees > 1e6f || (float)(int)degrees != degrees)
+			return -1;
+		int i = (int)degrees % 360;
+		return i < 0 ? i + 360 : i;
+	}
+
+	void cosSin(float degrees, float* c, float* s)
+	{
+		int i = wholeDegree(degrees);
+		if (i >= 0)
+		{
+			*c = TRIG_DEGREES.cosine[i];
+			*s = TRIG_DEGREES.sine[i];
+		}
+		else
+		{
+			*c = (float)cos(degrees*PI / 180);
+			*s = (float)sin(degrees*PI / 180);
+		}
+	}
+
+	// Number of vertices of an arc stepped from start to end, end included
+	int arcVertexCount(float start, float end, float incAngle)
+	{
+		int count = 0;
+		for (float i = start; i <= end; i += incAngle)
+		{
+			count++;
+		}
+		return count;
+	}
+
+	// Writes count (x, y, z) vertices of an arc of the circle centred on (cx, cy).
+	// Each angle is computed from its index, so any range can be written independently.
+	// Whole-degree steps from a whole-degree start read every vertex from the table.
+	void tessellateArc(GLfloat* vertices, int count, float radius, float cx, float cy,
+		float start, float incAngle, int threads)
+	{
+		int first = wholeDegree(start);
+		int step = wholeDegree(incAngle);
+		auto write = [=](int from, int to)
+		{
+			if (first >= 0 && step >= 0)
+			{
+				int degree = (first + from * step) % 360;
+				for (int k = from; k < to; k++)
+				{
+					vertices[3 * k] = cx + radius*TRIG_DEGREES.cosine[degree];
+					vertices[3 * k + 1] = cy + radius*TRIG_DEGREES.sine[degree];
+					vertices[3 * k + 2] = 0;
+					degree = (degree + step) % 360;
+				}
+				return;
+			}
+			for (int k = from; k < to; k++)
+			{
+				float i = start + k * incAngle;
+				vertices[3 * k] = cx + radius*cos(i*PI / 180.0f);
+				vertices[3 * k + 1] = cy + radius*sin(i*PI / 180.0f);
+				vertices[3 * k + 2] = 0;
+			}
+		};
+		if (count >= PARALLEL_ARC_VERTICES)
+			parallelRanges(count, threads, write);
+		else
+			write(0, count);
+	}
+}
+
+int tessellateHeart(GLfloat* vertices, int limit, float radius, float incAngle, int threads)
+{
+	const GLfloat square[] = { -radius,  radius, 0.0f,	// Position 0
+		-radius, -radius, 0.0f,		// Position 1
+		radius, -radius, 0.0f,		// Position 2
+		radius,  radius, 0.0f,		// Position 3
+	};
+
+	int count = 0;
+	for (int i = 0; i < 12 && count + 3 <= limit; i++)
+	{
+		vertices[count++] = square[i];
+	}
+
+	int top = arcVertexCount(START_TOP, END_TOP, incAngle);
+	if (top > (limit - count) / 3)
+		top = (limit - count) / 3;
+	tessellateArc(vertices + count, top, radius, 0.0f, radius, START_TOP, incAngle, threads);
+	count += 3 * top;
+
+	int right = arcVertexCount(START_RIGHT, END_RIGHT, incAngle);
+	if (right > (limit - count) / 3)
+		right = (limit - count) / 3;
+	tessellateArc(vertices + count, right, radius, radius, 0.0f, START_RIGHT, incAngle, threads);
+	count += 3 * right;
+	return count;
+}
+
+int heartFloatCount(float incAngle)
+{
+	return 12 + 3 * (arcVertexCount(START_TOP, END_TOP, incAngle) +
+		arcVertexCount(START_RIGHT, END_RIGHT, incAngle));
+}
+
+int polygonFloatCount(int sides)
+{
+	return sides < 3 ? 0 : 2 * sides;
+}
+
+int tessellatePolygon(GLfloat* vertices, int limit, int sides, float radius)
+{
+	if (sides < 3 || limit < 2)
+		return 0;
+
+	// Walk the edges counter-clockwise starting from the bottom left corner.
+	// The turn isn't rounded to whole degrees, so the outline closes for
+	// sides that don't divide 360.
+	GLfloat side = 2 * radius*sin(PI / sides);
+	int count = 0;
+	vertices[count++] = -radius*sin(PI / sides);
+	vertices[count++] = -radius*cos(PI / sides);
+	for (int i = 1; i < sides && count + 2 <= limit; i++)
+	{
+		float c, s;
+		cosSin((i - 1) * 360.0f / sides, &c, &s);
+		vertices[count] = vertices[count - 2] + side*c;
+		count++;
+		vertices[count] = vertices[count - 2] + side*s;
+		count++;
+	}
+	return count;
+}
+
+int starFloatCount(int points)
+{
+	return points < 2 ? 0 : 4 * points;
+}
+
+int tessellateStar(GLfloat* vertices, int limit, int points, float outerRadius, float innerRadius)
+{
+	if (points < 2)
+		return 0;
+
+	// The first point faces up
+	int count = 0;
+	for (int i = 0; i < 2 * points && count + 2 <= limit; i++)
+	{
+		float radius = i % 2 ? innerRadius : outerRadius;
+		float c, s;
+		cosSin(90.0f + i * 180.0f / points, &c, &s);
+		vertices[count++] = radius*c;
+		vertices[count++] = radius*s;
+	}
+	return count;
+}
@@ -0,0 +1,39 @@
+#ifndef SHAPES_H_INCLUDED
+#define SHAPES_H_INCLUDED
+
+#include <GLES2/gl2.h>
+
+/* Tessellators for the shapes drawn by the demos.  Both write positions into a
+ * caller supplied array, suitable for glDrawArrays(GL_TRIANGLE_FAN, ...), and
+ * return the number of floats written (never more than limit).
+ *
+ * Angles that fall on a whole degree are read from a table built at compile
+ * time rather than computed; shapes with fixed parameters can skip the
+ * tessellators altogether with the tables of shapetables.h.
+ */
+
+//Writes the heart of Heart.cpp (a square with a semicircle on its top and right
+//edges) as (x, y, z) triples, one vertex every incAngle degrees on each arc.
+//Arcs of thousands of vertices are split into threads jobs, threads <= 0
+//letting the job system choose.
+int tessellateHeart(GLfloat* vertices, int limit, float radius, float incAngle, int threads = 0);
+
+//Writes a regular polygon of the given number of sides as (x, y) pairs.  The
+//bottom edge is horizontal and the corners lie on a circle of the given radius.
+//Starts from the same corner as the loop Polygon.cpp had, but turns by exactly
+//360 / sides degrees; that loop turned by whole degrees and wrote a copy of
+//the first corner after the last, which wasn't drawn.
+int tessellatePolygon(GLfloat* vertices, int limit, int sides, float radius);
+
+//Writes a star of the given number of points as (x, y) pairs, alternating
+//between corners on the outer and the inner circle counter-clockwise.  The
+//outline is concave, so it needs triangulate() rather than a fan.
+int tessellateStar(GLfloat* vertices, int limit, int points, float outerRadius, float innerRadius);
+
+//Floats the tessellators write when the limit doesn't cut them short, to size
+//arrays allocated per frame
+int heartFloatCount(float incAngle);
+int polygonFloatCount(int sides);
+int starFloatCount(int points);
+
+#endif
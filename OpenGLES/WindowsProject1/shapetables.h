@@ -0,0 +1,149 @@
+#ifndef SHAPE_TABLES_H_INCLUDED
+#define SHAPE_TABLES_H_INCLUDED
+
+#include <GLES2/gl2.h>
+
+/* Shapes and trigonometry computed by the compiler.
+ *
+ * The tables are filled in by constexpr constructors, so a constexpr table is
+ * data in the executable like any array initialised with literals: nothing is
+ * computed when the program starts.  The parameters shapes.h takes at runtime
+ * are template arguments here, except for the radius, which the constructors
+ * take as an ordinary argument since floats can't be template arguments.
+ *
+ *	static constexpr HeartTable<1> heart(0.3f);
+ *	glVertexAttribPointer(VERTEX_ARRAY, 3, GL_FLOAT, GL_FALSE, 0, heart.vertices);
+ *
+ * The vertices are laid out as the matching tessellator writes them.
+ * Shapes whose parameters are only known at runtime go through shapes.h,
+ * which looks whole-degree angles up in a TrigTable instead of calling sin
+ * and cos.
+ */
+
+#define SHAPE_TABLES_PI 3.14159265358979323846
+
+//Taylor series, to double precision for |x| <= pi / 4
+constexpr double seriesSin(double x)
+{
+	double term = x, sum = x;
+	for (int n = 2; n <= 16; n += 2)
+	{
+		term *= -x * x / (n * (n + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double seriesCos(double x)
+{
+	double term = 1.0, sum = 1.0;
+	for (int n = 1; n <= 15; n += 2)
+	{
+		term *= -x * x / (n * (n + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+//sin and cos usable in constant expressions: x is brought within pi / 4 of a
+//multiple of pi / 2 and the quadrant picks the series and the sign
+constexpr double constexprSin(double x)
+{
+	double quarters = x / (SHAPE_TABLES_PI / 2);
+	long long q = (long long)(quarters < 0 ? quarters - 0.5 : quarters + 0.5);
+	double r = x - q * (SHAPE_TABLES_PI / 2);
+	switch (q & 3)
+	{
+	case 0: return seriesSin(r);
+	case 1: return seriesCos(r);
+	case 2: return -seriesSin(r);
+	default: return -seriesCos(r);
+	}
+}
+
+constexpr double constexprCos(double x)
+{
+	double quarters = x / (SHAPE_TABLES_PI / 2);
+	long long q = (long long)(quarters < 0 ? quarters - 0.5 : quarters + 0.5);
+	double r = x - q * (SHAPE_TABLES_PI / 2);
+	switch (q & 3)
+	{
+	case 0: return seriesCos(r);
+	case 1: return -seriesSin(r);
+	case 2: return -seriesCos(r);
+	default: return seriesSin(r);
+	}
+}
+
+//sin and cos of the whole degrees 0 to 359
+struct TrigTable {
+	GLfloat sine[360];
+	GLfloat cosine[360];
+
+	constexpr TrigTable() : sine(), cosine() {
+		for (int i = 0; i < 360; i++) {
+			sine[i] = (GLfloat)constexprSin(i * SHAPE_TABLES_PI / 180);
+			cosine[i] = (GLfloat)constexprCos(i * SHAPE_TABLES_PI / 180);
+		}
+	}
+};
+
+//tessellateHeart(vertices, limit, radius, IncDegrees) for a whole number of
+//degrees: the square, then the top arc from 0 to 180 degrees and the right
+//arc from -90 to 90, as (x, y, z) triples
+template<int IncDegrees>
+struct HeartTable {
+	static_assert(IncDegrees > 0, "the arcs need a positive step");
+
+	enum {
+		ARC_VERTICES = 180 / IncDegrees + 1,
+		VERTICES = 4 + 2 * ARC_VERTICES,
+		FLOATS = 3 * VERTICES
+	};
+
+	GLfloat vertices[FLOATS];
+
+	constexpr explicit HeartTable(float radius) : vertices() {
+		const GLfloat square[] = { -radius, radius, -radius, -radius, radius, -radius, radius, radius };
+		int count = 0;
+		for (int i = 0; i < 8; i += 2) {
+			vertices[count++] = square[i];
+			vertices[count++] = square[i + 1];
+			vertices[count++] = 0.0f;
+		}
+		//Top arc centred on (0, radius), right arc on (radius, 0)
+		for (int k = 0; k < ARC_VERTICES; k++) {
+			double angle = k * IncDegrees * SHAPE_TABLES_PI / 180;
+			vertices[count++] = (GLfloat)(radius * constexprCos(angle));
+			vertices[count++] = (GLfloat)(radius + radius * constexprSin(angle));
+			vertices[count++] = 0.0f;
+		}
+		for (int k = 0; k < ARC_VERTICES; k++) {
+			double angle = (k * IncDegrees - 90) * SHAPE_TABLES_PI / 180;
+			vertices[count++] = (GLfloat)(radius + radius * constexprCos(angle));
+			vertices[count++] = (GLfloat)(radius * constexprSin(angle));
+			vertices[count++] = 0.0f;
+		}
+	}
+};
+
+//tessellatePolygon(vertices, limit, Sides, radius): (x, y) pairs
+//counter-clockwise from the bottom left corner, the bottom edge horizontal
+template<int Sides>
+struct PolygonTable {
+	static_assert(Sides >= 3, "a polygon needs at least 3 sides");
+
+	enum { VERTICES = Sides, FLOATS = 2 * Sides };
+
+	GLfloat vertices[FLOATS];
+
+	constexpr explicit PolygonTable(float radius) : vertices() {
+		for (int k = 0; k < Sides; k++) {
+			double angle = -SHAPE_TABLES_PI / 2 - SHAPE_TABLES_PI / Sides + k * 2 * SHAPE_TABLES_PI / Sides;
+			vertices[2 * k] = (GLfloat)(radius * constexprCos(angle));
+			vertices[2 * k + 1] = (GLfloat)(radius * constexprSin(angle));
+		}
+	}
+};
+
+#endif
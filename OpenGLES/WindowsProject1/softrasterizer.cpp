@@ -0,0 +1,388 @@
+#include "stdafx.h"
+#include <math.h>
+#include <string.h>
+#include "softrasterizer.h"
+#include "jobsystem.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SOFT_RASTERIZER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+#define VERTEX_ARRAY	0
+#define TEXCOORD_ARRAY	1
+
+namespace {
+	//Floats per transformed vertex: window x, y, w and u, v
+	const int VERTEX_FLOATS = 5;
+
+	unsigned int packColor(const GLfloat* color) {
+		unsigned int packed = 0;
+		for (int c = 0; c < 4; c++) {
+			float value = color[c] <= 0.0f ? 0.0f : (color[c] >= 1.0f ? 1.0f : color[c]);
+			packed |= (unsigned int)(value * 255.0f + 0.5f) << (8 * c);
+		}
+		return packed;
+	}
+
+	//a + (b - a) * weight / 256 on all four bytes at once
+	unsigned int lerpTexels(unsigned int a, unsigned int b, unsigned int weight) {
+		unsigned int rb = (((a & 0xff00ff) * (256 - weight) + (b & 0xff00ff) * weight) >> 8) & 0xff00ff;
+		unsigned int ga = (((a >> 8) & 0xff00ff) * (256 - weight) + ((b >> 8) & 0xff00ff) * weight) & 0xff00ff00;
+		return rb | ga;
+	}
+
+	int clampTexel(int value, int size) {
+		return value < 0 ? 0 : (value >= size ? size - 1 : value);
+	}
+}
+
+//Bilinear lookup at texel coordinates s, r, clamping to the edge texels
+unsigned int SoftwareBackend::sampleBilinear(const Texture& texture, float s, float r) {
+	float floorS = floorf(s), floorR = floorf(r);
+	int x = (int)floorS, y = (int)floorR;
+	int x0 = clampTexel(x, texture.width), x1 = clampTexel(x + 1, texture.width);
+	const unsigned int* row0 = &texture.texels[clampTexel(y, texture.height) * texture.width];
+	const unsigned int* row1 = &texture.texels[clampTexel(y + 1, texture.height) * texture.width];
+	unsigned int weightX = (unsigned int)((s - floorS) * 256.0f);
+	unsigned int weightY = (unsigned int)((r - floorR) * 256.0f);
+	return lerpTexels(lerpTexels(row0[x0], row0[x1], weightX),
+					  lerpTexels(row1[x0], row1[x1], weightX), weightY);
+}
+
+SoftwareBackend::SoftwareBackend(int width, int height, int tileSize_) {
+	viewWidth = width;
+	viewHeight = height;
+	pitch = (width + 3) & ~3;
+	tileSize = tileSize_ < 4 ? 4 : (tileSize_ + 3) & ~3;
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+	framebuffer.assign(pitch * height, 0);
+	bins.resize(tilesX * tilesY);
+
+	program = NULL;
+	texture = NULL;
+	memset(arrays, 0, sizeof(arrays));
+	arrayBuffer = 0;
+	elementBuffer = 0;
+}
+
+void SoftwareBackend::defineProgram(GLuint name, const SoftProgram& shading) {
+	ProgramState& state = programs[name];
+	state.shading = shading;
+	memset(state.matrix, 0, sizeof(state.matrix));
+	state.matrix[0] = state.matrix[5] = state.matrix[10] = state.matrix[15] = 1.0f;
+	memcpy(state.color, shading.color, sizeof(state.color));
+}
+
+void SoftwareBackend::defineTexture(GLuint name, const Image* image) {
+	Texture& target = textures[name];
+	target.width = image->width;
+	target.height = image->height;
+	target.texels.resize(image->width * image->height);
+	const unsigned char* rgb = (const unsigned char*)image->pixels;
+	for (int i = 0; i < image->width * image->height; i++)
+		target.texels[i] = rgb[3 * i] | rgb[3 * i + 1] << 8 | rgb[3 * i + 2] << 16 | 0xff000000;
+}
+
+void SoftwareBackend::clear(float red, float green, float blue, float alpha) {
+	GLfloat color[] = { red, green, blue, alpha };
+	framebuffer.assign(framebuffer.size(), packColor(color));
+	pending.clear();
+	for (size_t i = 0; i < bins.size(); i++)
+		bins[i].clear();
+}
+
+void SoftwareBackend::flush() {
+	if (pending.empty())
+		return;
+	parallelRanges(tilesX * tilesY, 0, [this](int first, int last) {
+		for (int tile = first; tile < last; tile++)
+			rasterizeTile(tile);
+	});
+	pending.clear();
+	for (size_t i = 0; i < bins.size(); i++)
+		bins[i].clear();
+}
+
+Image* SoftwareBackend::readPixels() const {
+	char* rgb = new char[viewWidth * viewHeight * 3];
+	for (int y = 0; y < viewHeight; y++) {
+		const unsigned int* row = &framebuffer[y * pitch];
+		char* target = rgb + 3 * viewWidth * y;
+		for (int x = 0; x < viewWidth; x++) {
+			target[3 * x] = (char)row[x];
+			target[3 * x + 1] = (char)(row[x] >> 8);
+			target[3 * x + 2] = (char)(row[x] >> 16);
+		}
+	}
+	return new Image(rgb, viewWidth, viewHeight);
+}
+
+void SoftwareBackend::useProgram(GLuint name) {
+	map<GLuint, ProgramState>::iterator found = programs.find(name);
+	program = found != programs.end() ? &found->second : NULL;
+}
+
+void SoftwareBackend::uniformMatrix4(GLint location, const GLfloat* matrix) {
+	if (program && location == program->shading.matrixLocation)
+		memcpy(program->matrix, matrix, sizeof(program->matrix));
+}
+
+void SoftwareBackend::uniform4(GLint location, const GLfloat* value) {
+	if (program && location >= 0 && location == program->shading.colorLocation)
+		memcpy(program->color, value, sizeof(program->color));
+}
+
+void SoftwareBackend::bindTexture(int unit, GLuint name) {
+	if (unit != 0)
+		return;
+	map<GLuint, Texture>::const_iterator found = textures.find(name);
+	texture = found != textures.end() ? &found->second : NULL;
+}
+
+void SoftwareBackend::bindBuffer(GLenum target, GLuint buffer) {
+	if (target == GL_ARRAY_BUFFER)
+		arrayBuffer = buffer;
+	else if (target == GL_ELEMENT_ARRAY_BUFFER)
+		elementBuffer = buffer;
+}
+
+void SoftwareBackend::vertexArray(GLuint index, int size, GLenum type, bool /*normalized*/,
+								  int stride, const void* pointer) {
+	if (index != VERTEX_ARRAY && index != TEXCOORD_ARRAY)
+		return;
+	Array& array = arrays[index];
+	array.size = size;
+	array.stride = stride ? stride : size * (int)sizeof(GLfloat);
+	//Only float client arrays can be read
+	array.pointer = type == GL_FLOAT && !arrayBuffer ? (const GLfloat*)pointer : NULL;
+}
+
+void SoftwareBackend::disableVertexArray(GLuint index) {
+	if (index == VERTEX_ARRAY || index == TEXCOORD_ARRAY)
+		arrays[index].pointer = NULL;
+}
+
+void SoftwareBackend::drawArrays(GLenum mode, int first, int count) {
+	assemble(mode, count, first, NULL);
+}
+
+void SoftwareBackend::drawElements(GLenum mode, int count, GLenum type, const void* source) {
+	if (elementBuffer || (type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_BYTE))
+		return;
+	indices.resize(count);
+	for (int i = 0; i < count; i++) {
+		indices[i] = type == GL_UNSIGNED_SHORT ? ((const GLushort*)source)[i]
+											   : ((const GLubyte*)source)[i];
+	}
+	assemble(mode, count, 0, &indices[0]);
+}
+
+void SoftwareBackend::fetchVertex(int index, float* out) const {
+	const GLfloat* position = (const GLfloat*)((const char*)arrays[VERTEX_ARRAY].pointer +
+		index * arrays[VERTEX_ARRAY].stride);
+	float p[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	for (int i = 0; i < arrays[VERTEX_ARRAY].size && i < 4; i++)
+		p[i] = position[i];
+
+	//Column-major, as glUniformMatrix4fv takes it
+	const GLfloat* m = program->matrix;
+	float x = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12] * p[3];
+	float y = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13] * p[3];
+	float w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15] * p[3];
+	out[2] = w;
+	if (w > 0.0f) {
+		out[0] = (x / w * 0.5f + 0.5f) * viewWidth;
+		out[1] = (y / w * 0.5f + 0.5f) * viewHeight;
+	}
+
+	out[3] = out[4] = 0.0f;
+	if (arrays[TEXCOORD_ARRAY].pointer) {
+		const GLfloat* uv = (const GLfloat*)((const char*)arrays[TEXCOORD_ARRAY].pointer +
+			index * arrays[TEXCOORD_ARRAY].stride);
+		out[3] = uv[0];
+		out[4] = arrays[TEXCOORD_ARRAY].size > 1 ? uv[1] : 0.0f;
+	}
+}
+
+void SoftwareBackend::assemble(GLenum mode, int count, int first, const int* source) {
+	if (!program || !arrays[VERTEX_ARRAY].pointer || count < 3)
+		return;
+	if (program->shading.textured && (!texture || !arrays[TEXCOORD_ARRAY].pointer))
+		return;
+
+	float a[VERTEX_FLOATS], b[VERTEX_FLOATS], c[VERTEX_FLOATS];
+	switch (mode) {
+		case GL_TRIANGLES:
+			for (int i = 0; i + 2 < count; i += 3) {
+				fetchVertex(source ? source[i] : first + i, a);
+				fetchVertex(source ? source[i + 1] : first + i + 1, b);
+				fetchVertex(source ? source[i + 2] : first + i + 2, c);
+				setupTriangle(a, b, c);
+			}
+			break;
+		case GL_TRIANGLE_STRIP:
+			fetchVertex(source ? source[0] : first, a);
+			fetchVertex(source ? source[1] : first + 1, b);
+			for (int i = 2; i < count; i++) {
+				fetchVertex(source ? source[i] : first + i, c);
+				setupTriangle(a, b, c);
+				memcpy(a, b, sizeof(a));
+				memcpy(b, c, sizeof(b));
+			}
+			break;
+		case GL_TRIANGLE_FAN:
+			fetchVertex(source ? source[0] : first, a);
+			fetchVertex(source ? source[1] : first + 1, b);
+			for (int i = 2; i < count; i++) {
+				fetchVertex(source ? source[i] : first + i, c);
+				setupTriangle(a, b, c);
+				memcpy(b, c, sizeof(b));
+			}
+			break;
+	}
+}
+
+void SoftwareBackend::setupTriangle(const float* a, const float* b, const float* c) {
+	//Nothing is clipped against the near plane; such triangles are dropped
+	if (a[2] <= 0.0f || b[2] <= 0.0f || c[2] <= 0.0f)
+		return;
+
+	//Both windings are drawn, so order the vertices counter-clockwise
+	float area = (b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1]);
+	if (area == 0.0f)
+		return;
+	if (area < 0.0f) {
+		const float* swap = b;
+		b = c;
+		c = swap;
+	}
+
+	Triangle triangle;
+	const float* vertices[] = { a, b, c };
+	for (int i = 0; i < 3; i++) {
+		triangle.x[i] = vertices[i][0];
+		triangle.y[i] = vertices[i][1];
+		triangle.u[i] = vertices[i][3];
+		triangle.v[i] = vertices[i][4];
+	}
+
+	float minX = a[0] < b[0] ? (a[0] < c[0] ? a[0] : c[0]) : (b[0] < c[0] ? b[0] : c[0]);
+	float maxX = a[0] > b[0] ? (a[0] > c[0] ? a[0] : c[0]) : (b[0] > c[0] ? b[0] : c[0]);
+	float minY = a[1] < b[1] ? (a[1] < c[1] ? a[1] : c[1]) : (b[1] < c[1] ? b[1] : c[1]);
+	float maxY = a[1] > b[1] ? (a[1] > c[1] ? a[1] : c[1]) : (b[1] > c[1] ? b[1] : c[1]);
+	if (maxX < 0.0f || maxY < 0.0f || minX >= viewWidth || minY >= viewHeight)
+		return;
+	triangle.minX = minX < 0.0f ? 0 : (int)minX;
+	triangle.minY = minY < 0.0f ? 0 : (int)minY;
+	triangle.maxX = maxX >= viewWidth ? viewWidth - 1 : (int)maxX;
+	triangle.maxY = maxY >= viewHeight ? viewHeight - 1 : (int)maxY;
+
+	triangle.texture = program->shading.textured ? texture : NULL;
+	triangle.color = packColor(program->shading.colorLocation >= 0 ? program->color
+																	: program->shading.color);
+
+	int index = (int)pending.size();
+	pending.push_back(triangle);
+	for (int ty = triangle.minY / tileSize; ty <= triangle.maxY / tileSize; ty++) {
+		for (int tx = triangle.minX / tileSize; tx <= triangle.maxX / tileSize; tx++)
+			bins[ty * tilesX + tx].push_back(index);
+	}
+}
+
+void SoftwareBackend::rasterizeTile(int tile) {
+	const vector<int>& bin = bins[tile];
+	int tileX = tile % tilesX * tileSize;
+	int tileY = tile / tilesX * tileSize;
+	//Tiles and the pitch are multiples of 4 pixels, so a 4-pixel group never
+	//straddles two tiles and the group past the right edge is in the padding
+	int tileRight = tileX + tileSize < pitch ? tileX + tileSize : pitch;
+	int tileTop = tileY + tileSize < viewHeight ? tileY + tileSize : viewHeight;
+
+	for (size_t i = 0; i < bin.size(); i++) {
+		const Triangle& t = pending[bin[i]];
+		int left = (t.minX > tileX ? t.minX : tileX) & ~3;
+		int right = t.maxX + 1 < tileRight ? t.maxX + 1 : tileRight;
+		int bottom = t.minY > tileY ? t.minY : tileY;
+		int top = t.maxY + 1 < tileTop ? t.maxY + 1 : tileTop;
+
+		//Edge e runs from vertex e to vertex e + 1 and is positive inside; it
+		//is the barycentric weight of the vertex opposite, scaled by the area
+		float stepX[3], stepY[3], rowStart[3];
+		for (int e = 0; e < 3; e++) {
+			int n = e == 2 ? 0 : e + 1;
+			float dx = t.x[n] - t.x[e];
+			float dy = t.y[n] - t.y[e];
+			stepX[e] = -dy;
+			stepY[e] = dx;
+			rowStart[e] = dx * (bottom + 0.5f - t.y[e]) - dy * (left + 0.5f - t.x[e]);
+		}
+		//The edges sum to twice the area anywhere; texture coordinates are
+		//planes in them, in texels relative to texel centres
+		float invArea = 1.0f / (rowStart[0] + rowStart[1] + rowStart[2]);
+		float uPlane[3] = { 0.0f, 0.0f, 0.0f }, vPlane[3] = { 0.0f, 0.0f, 0.0f };
+		if (t.texture) {
+			for (int e = 0; e < 3; e++) {
+				int opposite = e == 0 ? 2 : e - 1;
+				uPlane[e] = t.u[opposite] * t.texture->width * invArea;
+				vPlane[e] = t.v[opposite] * t.texture->height * invArea;
+			}
+		}
+
+		for (int y = bottom; y < top; y++) {
+			unsigned int* row = &framebuffer[y * pitch];
+#ifdef SOFT_RASTERIZER_USE_SSE2
+			__m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+			__m128 zero = _mm_setzero_ps();
+			__m128 edge0 = _mm_add_ps(_mm_set1_ps(rowStart[0]), _mm_mul_ps(lanes, _mm_set1_ps(stepX[0])));
+			__m128 edge1 = _mm_add_ps(_mm_set1_ps(rowStart[1]), _mm_mul_ps(lanes, _mm_set1_ps(stepX[1])));
+			__m128 edge2 = _mm_add_ps(_mm_set1_ps(rowStart[2]), _mm_mul_ps(lanes, _mm_set1_ps(stepX[2])));
+			__m128 step0 = _mm_set1_ps(4.0f * stepX[0]);
+			__m128 step1 = _mm_set1_ps(4.0f * stepX[1]);
+			__m128 step2 = _mm_set1_ps(4.0f * stepX[2]);
+			__m128i color = _mm_set1_epi32((int)t.color);
+			for (int x = left; x < right; x += 4) {
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)),
+										   _mm_cmpge_ps(edge2, zero));
+				int covered = _mm_movemask_ps(inside);
+				if (covered && !t.texture) {
+					__m128i mask = _mm_castps_si128(inside);
+					__m128i* target = (__m128i*)(row + x);
+					__m128i old = _mm_loadu_si128(target);
+					_mm_storeu_si128(target, _mm_or_si128(_mm_and_si128(mask, color), _mm_andnot_si128(mask, old)));
+				} else if (covered) {
+					float w0[4], w1[4], w2[4];
+					_mm_storeu_ps(w0, edge0);
+					_mm_storeu_ps(w1, edge1);
+					_mm_storeu_ps(w2, edge2);
+					for (int lane = 0; lane < 4; lane++) {
+						if (covered & (1 << lane)) {
+							row[x + lane] = sampleBilinear(*t.texture,
+								uPlane[0] * w0[lane] + uPlane[1] * w1[lane] + uPlane[2] * w2[lane] - 0.5f,
+								vPlane[0] * w0[lane] + vPlane[1] * w1[lane] + vPlane[2] * w2[lane] - 0.5f);
+						}
+					}
+				}
+				edge0 = _mm_add_ps(edge0, step0);
+				edge1 = _mm_add_ps(edge1, step1);
+				edge2 = _mm_add_ps(edge2, step2);
+			}
+#else
+			float e0 = rowStart[0], e1 = rowStart[1], e2 = rowStart[2];
+			for (int x = left; x < right; x++, e0 += stepX[0], e1 += stepX[1], e2 += stepX[2]) {
+				if (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f)
+					continue;
+				row[x] = !t.texture ? t.color : sampleBilinear(*t.texture,
+					uPlane[0] * e0 + uPlane[1] * e1 + uPlane[2] * e2 - 0.5f,
+					vPlane[0] * e0 + vPlane[1] * e1 + vPlane[2] * e2 - 0.5f);
+			}
+#endif
+			rowStart[0] += stepY[0];
+			rowStart[1] += stepY[1];
+			rowStart[2] += stepY[2];
+		}
+	}
+}
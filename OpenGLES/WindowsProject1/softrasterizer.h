@@ -0,0 +1,130 @@
+#ifndef SOFT_RASTERIZER_H_INCLUDED
+#define SOFT_RASTERIZER_H_INCLUDED
+
+#include <map>
+#include <vector>
+#include <GLES2/gl2.h>
+#include "commandlist.h"
+#include "imageloader.h"
+
+//How the software backend shades the draws of one GL program, since it
+//can't run the GLSL
+struct SoftProgram {
+	GLint matrixLocation;	//Location of the mat4 applied to the positions
+	GLint colorLocation;	//vec4 uniform giving the colour, -1 to use color
+	GLfloat color[4];		//Colour when colorLocation is -1
+	bool textured;			//Sample the texture of unit 0 with TEXCOORD_ARRAY
+};
+
+/* Renders command lists on the CPU, for hosts without a GLES driver.
+ *
+ * Supports what the demos draw: client-side float vertex arrays drawn as
+ * triangles, strips or fans, positions through a 4x4 matrix, and either a
+ * flat colour or a bilinear, clamp-to-edge texture lookup (affine, no
+ * perspective correction).  Draws sourcing vertices or indices from buffer
+ * objects are skipped.  There is no depth test, blending or clipping beyond
+ * the viewport; later draws cover earlier ones as with the demos' GL
+ * state.  GL program and texture names are mapped to shading with
+ * defineProgram() and defineTexture().
+ *
+ * Draws are only transformed and binned into tiles as they arrive;
+ * flush() rasterizes the tiles in parallel on the job system, each tile
+ * walking its triangles in submission order.  Edge functions are evaluated
+ * four pixels at a time with SSE2 where available.
+ */
+class SoftwareBackend : public CommandBackend {
+	public:
+		//tileSize is rounded up to a multiple of 4
+		SoftwareBackend(int width, int height, int tileSize = 64);
+
+		void defineProgram(GLuint program, const SoftProgram& shading);
+		//Copies image as the texels of texture
+		void defineTexture(GLuint texture, const Image* image);
+
+		//Fills the framebuffer, dropping any unflushed draws
+		void clear(float red, float green, float blue, float alpha);
+
+		//Rasterizes everything drawn since the last flush
+		void flush();
+
+		//RGBA pixels, 4 bytes each, rows bottom to top like glReadPixels
+		const unsigned char* pixels() const { return (const unsigned char*)&framebuffer[0]; }
+		int stride() const { return pitch; }	//Pixels per row
+		int width() const { return viewWidth; }
+		int height() const { return viewHeight; }
+
+		//Copies the framebuffer into an RGB image, the layout of loadBMP
+		Image* readPixels() const;
+
+		void useProgram(GLuint program);
+		void uniformMatrix4(GLint location, const GLfloat* matrix);
+		void uniform4(GLint location, const GLfloat* value);
+		void bindTexture(int unit, GLuint texture);
+		void bindBuffer(GLenum target, GLuint buffer);
+		void vertexArray(GLuint index, int size, GLenum type, bool normalized,
+						 int stride, const void* pointer);
+		void disableVertexArray(GLuint index);
+		void drawArrays(GLenum mode, int first, int count);
+		void drawElements(GLenum mode, int count, GLenum type, const void* indices);
+
+	private:
+		//Texels of a defined texture, RGBA
+		struct Texture {
+			int width;
+			int height;
+			std::vector<unsigned int> texels;
+		};
+
+		//A triangle set up for rasterization
+		struct Triangle {
+			float x[3], y[3];	//Window coordinates, counter-clockwise
+			float u[3], v[3];
+			int minX, minY, maxX, maxY;
+			unsigned int color;
+			const Texture* texture;	//NULL for flat colour
+		};
+
+		struct ProgramState {
+			SoftProgram shading;
+			GLfloat matrix[16];
+			GLfloat color[4];
+		};
+
+		struct Array {
+			int size;
+			int stride;
+			const GLfloat* pointer;
+		};
+
+		//Transforms vertex index of the bound arrays to window coordinates
+		//x, y, w and texture coordinates u, v
+		void fetchVertex(int index, float* out) const;
+		//Sets up the triangles of count vertices drawn as mode, vertex i
+		//being indices[i], or first + i without indices
+		void assemble(GLenum mode, int count, int first, const int* indices);
+		void setupTriangle(const float* a, const float* b, const float* c);
+		void rasterizeTile(int tile);
+		static unsigned int sampleBilinear(const Texture& texture, float s, float r);
+
+		int viewWidth;
+		int viewHeight;
+		int pitch;
+		int tileSize;
+		int tilesX;
+		int tilesY;
+		std::vector<unsigned int> framebuffer;
+
+		std::map<GLuint, ProgramState> programs;
+		std::map<GLuint, Texture> textures;
+		ProgramState* program;
+		const Texture* texture;
+		Array arrays[2];	//VERTEX_ARRAY and TEXCOORD_ARRAY
+		GLuint arrayBuffer;
+		GLuint elementBuffer;
+
+		std::vector<Triangle> pending;
+		std::vector<std::vector<int> > bins;	//Triangles touching each tile
+		std::vector<int> indices;		//drawElements indices as ints
+};
+
+#endif
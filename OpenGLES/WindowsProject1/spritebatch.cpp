@@ -0,0 +1,169 @@
+#include "stdafx.h"
+#include <string.h>
+#include <algorithm>
+#include "spritebatch.h"
+#include "glprogram.h"
+
+using namespace std;
+
+// Index to bind the attributes to vertex shaders
+#define VERTEX_ARRAY	0
+#define TEXCOORD_ARRAY	1
+#define COLOR_ARRAY		2
+
+#define MAX_BATCH_SPRITES	16384
+
+namespace {
+	const char* pszVertShader = "\
+		attribute highp vec2	myVertex;\
+		attribute mediump vec2	myUV;\
+		attribute lowp vec4		myColor;\
+		uniform mediump mat4	myPMVMatrix;\
+		varying mediump vec2	myTexCoord;\
+		varying lowp vec4		myTint;\
+		void main(void)\
+		{\
+			gl_Position = myPMVMatrix * vec4(myVertex, 0.0, 1.0);\
+			myTexCoord = myUV;\
+			myTint = myColor;\
+		}";
+	const char* pszFragShader = "\
+		uniform sampler2D sampler2d;\
+		varying mediump vec2	myTexCoord;\
+		varying lowp vec4		myTint;\
+		void main (void)\
+		{\
+			gl_FragColor = texture2D(sampler2d, myTexCoord) * myTint;\
+		}";
+}
+
+SpriteBatch::SpriteBatch(int maxSprites_) :
+	maxSprites(min(max(maxSprites_, 1), MAX_BATCH_SPRITES)), program(0),
+	matrixLocation(-1), vertexBuffer(0), indexBuffer(0), drawCalls(0) {
+	memset(matrix, 0, sizeof(matrix));
+}
+
+SpriteBatch::~SpriteBatch() {
+	glDeleteBuffers(1, &vertexBuffer);
+	glDeleteBuffers(1, &indexBuffer);
+	glDeleteProgram(program);
+}
+
+bool SpriteBatch::init() {
+	const char* attribs[] = { "myVertex", "myUV", "myColor" };
+	program = buildProgram(pszVertShader, pszFragShader, attribs, 3);
+	if (!program)
+		return false;
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "sampler2d"), 0);
+	matrixLocation = glGetUniformLocation(program, "myPMVMatrix");
+
+	//Every quad is two triangles over its four vertices, so the indices
+	//never change and are uploaded once
+	vector<GLushort> indices(maxSprites * 6);
+	for (int i = 0; i < maxSprites; i++) {
+		GLushort base = (GLushort)(i * 4);
+		indices[i * 6 + 0] = base;
+		indices[i * 6 + 1] = base + 1;
+		indices[i * 6 + 2] = base + 2;
+		indices[i * 6 + 3] = base;
+		indices[i * 6 + 4] = base + 2;
+		indices[i * 6 + 5] = base + 3;
+	}
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+
+	glGenBuffers(1, &vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, maxSprites * 4 * sizeof(SpriteVertex), NULL, GL_STREAM_DRAW);
+	vertices.reserve(maxSprites * 4);
+	return true;
+}
+
+void SpriteBatch::begin(const GLfloat* pmvMatrix) {
+	memcpy(matrix, pmvMatrix, sizeof(matrix));
+	sprites.clear();
+	drawCalls = 0;
+}
+
+void SpriteBatch::draw(GLuint texture, const AtlasRegion& region,
+					   float x, float y, float width, float height, GLuint color) {
+	Sprite sprite;
+	sprite.texture = texture;
+	const float px[4] = { x, x, x + width, x + width };
+	const float py[4] = { y + height, y, y, y + height };
+	const float pu[4] = { region.u0, region.u0, region.u1, region.u1 };
+	const float pv[4] = { region.v1, region.v0, region.v0, region.v1 };
+	for (int i = 0; i < 4; i++) {
+		SpriteVertex& v = sprite.vertices[i];
+		v.x = px[i];
+		v.y = py[i];
+		v.u = pu[i];
+		v.v = pv[i];
+		v.r = (GLubyte)(color & 0xff);
+		v.g = (GLubyte)((color >> 8) & 0xff);
+		v.b = (GLubyte)((color >> 16) & 0xff);
+		v.a = (GLubyte)(color >> 24);
+	}
+	sprites.push_back(sprite);
+}
+
+void SpriteBatch::draw(const TextureAtlas& atlas, int region,
+					   float x, float y, float width, float height, GLuint color) {
+	const AtlasRegion& r = atlas.region(region);
+	draw(atlas.pageTexture(r.page), r, x, y, width, height, color);
+}
+
+bool SpriteBatch::byTexture(const Sprite& a, const Sprite& b) {
+	return a.texture < b.texture;
+}
+
+int SpriteBatch::end() {
+	if (sprites.empty())
+		return 0;
+
+	//Stable, so sprites of one page keep their painter's order
+	stable_sort(sprites.begin(), sprites.end(), byTexture);
+
+	glUseProgram(program);
+	glUniformMatrix4fv(matrixLocation, 1, GL_FALSE, matrix);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glEnableVertexAttribArray(VERTEX_ARRAY);
+	glEnableVertexAttribArray(TEXCOORD_ARRAY);
+	glEnableVertexAttribArray(COLOR_ARRAY);
+	glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)0);
+	glVertexAttribPointer(TEXCOORD_ARRAY, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)(2 * sizeof(GLfloat)));
+	glVertexAttribPointer(COLOR_ARRAY, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex), (void*)(4 * sizeof(GLfloat)));
+
+	for (size_t first = 0; first < sprites.size(); first += maxSprites)
+		flush(first, min(sprites.size() - first, (size_t)maxSprites));
+
+	glDisableVertexAttribArray(COLOR_ARRAY);
+	sprites.clear();
+	return drawCalls;
+}
+
+//Uploads up to maxSprites sorted sprites and draws each run of one texture
+void SpriteBatch::flush(size_t first, size_t count) {
+	vertices.clear();
+	for (size_t i = first; i < first + count; i++)
+		vertices.insert(vertices.end(), sprites[i].vertices, sprites[i].vertices + 4);
+
+	//Orphan the previous contents so the driver does not wait for the GPU
+	glBufferData(GL_ARRAY_BUFFER, maxSprites * 4 * sizeof(SpriteVertex), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(SpriteVertex), &vertices[0]);
+
+	size_t run = first;
+	while (run < first + count) {
+		size_t next = run;
+		while (next < first + count && sprites[next].texture == sprites[run].texture)
+			next++;
+		glBindTexture(GL_TEXTURE_2D, sprites[run].texture);
+		glDrawElements(GL_TRIANGLES, (GLsizei)(next - run) * 6, GL_UNSIGNED_SHORT,
+			(void*)((run - first) * 6 * sizeof(GLushort)));
+		drawCalls++;
+		run = next;
+	}
+}
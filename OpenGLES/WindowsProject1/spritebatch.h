@@ -0,0 +1,64 @@
+#ifndef SPRITE_BATCH_H_INCLUDED
+#define SPRITE_BATCH_H_INCLUDED
+
+#include <vector>
+#include <GLES2/gl2.h>
+#include "atlas.h"
+
+//Interleaved vertex of a sprite quad, 20 bytes
+struct SpriteVertex {
+	GLfloat x, y;
+	GLfloat u, v;
+	GLubyte r, g, b, a;
+};
+
+/* Collects textured quads between begin() and end() and draws them sorted by
+ * texture, with one glDrawElements per texture (per atlas page).  Sprites that
+ * share a texture keep their submission order, so overlapping sprites of the
+ * same page still blend back to front.
+ *
+ * Colours are packed as 0xAABBGGRR and multiply the texel.
+ */
+class SpriteBatch {
+	public:
+		//At most 16384 sprites fit the 16-bit index buffer of one flush
+		explicit SpriteBatch(int maxSprites = 4096);
+		~SpriteBatch();
+
+		//Creates the program and buffers; needs a current context
+		bool init();
+
+		void begin(const GLfloat* pmvMatrix);
+		void draw(GLuint texture, const AtlasRegion& region,
+				  float x, float y, float width, float height,
+				  GLuint color = 0xffffffff);
+		void draw(const TextureAtlas& atlas, int region,
+				  float x, float y, float width, float height,
+				  GLuint color = 0xffffffff);
+
+		//Submits everything queued since begin() and returns the draw calls
+		//issued.  Leaves the batch program and buffers bound.
+		int end();
+
+	private:
+		struct Sprite {
+			GLuint texture;
+			SpriteVertex vertices[4];
+		};
+
+		static bool byTexture(const Sprite& a, const Sprite& b);
+		void flush(size_t first, size_t count);
+
+		int maxSprites;
+		GLuint program;
+		GLint matrixLocation;
+		GLuint vertexBuffer;
+		GLuint indexBuffer;
+		GLfloat matrix[16];
+		int drawCalls;
+
+		std::vector<Sprite> sprites;
+		std::vector<SpriteVertex> vertices;
+};
+
+#endif
@@ -0,0 +1,224 @@
+#include "stdafx.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "textbatch.h"
+#include "glprogram.h"
+
+using namespace std;
+
+// Index to bind the attributes to vertex shaders
+#define VERTEX_ARRAY	0
+#define TEXCOORD_ARRAY	1
+#define COLOR_ARRAY		2
+#define SOFTNESS_ARRAY	3
+
+#define MAX_BATCH_GLYPHS	16384
+
+namespace {
+	const char* pszVertShader = "\
+		attribute highp vec2	myVertex;\
+		attribute mediump vec2	myUV;\
+		attribute lowp vec4		myColor;\
+		attribute mediump float	mySoftness;\
+		uniform mediump mat4	myPMVMatrix;\
+		varying mediump vec2	myTexCoord;\
+		varying lowp vec4		myTint;\
+		varying mediump float	myRamp;\
+		void main(void)\
+		{\
+			gl_Position = myPMVMatrix * vec4(myVertex, 0.0, 1.0);\
+			myTexCoord = myUV;\
+			myTint = myColor;\
+			myRamp = mySoftness;\
+		}";
+	const char* pszFragShader = "\
+		uniform sampler2D sampler2d;\
+		varying mediump vec2	myTexCoord;\
+		varying lowp vec4		myTint;\
+		varying mediump float	myRamp;\
+		void main (void)\
+		{\
+			mediump float distance = texture2D(sampler2d, myTexCoord).r;\
+			lowp float coverage = smoothstep(0.5 - myRamp, 0.5 + myRamp, distance);\
+			gl_FragColor = vec4(myTint.rgb, myTint.a * coverage);\
+		}";
+
+	float length(float x, float y) {
+		return sqrtf(x * x + y * y);
+	}
+}
+
+TextBatch::TextBatch(int maxGlyphs_) :
+	maxGlyphs(min(max(maxGlyphs_, 1), MAX_BATCH_GLYPHS)), program(0),
+	matrixLocation(-1), vertexBuffer(0), indexBuffer(0), pixelsPerUnit(1.0f), drawCalls(0) {
+	memset(matrix, 0, sizeof(matrix));
+}
+
+TextBatch::~TextBatch() {
+	glDeleteBuffers(1, &vertexBuffer);
+	glDeleteBuffers(1, &indexBuffer);
+	glDeleteProgram(program);
+}
+
+bool TextBatch::init() {
+	const char* attribs[] = { "myVertex", "myUV", "myColor", "mySoftness" };
+	program = buildProgram(pszVertShader, pszFragShader, attribs, 4);
+	if (!program)
+		return false;
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "sampler2d"), 0);
+	matrixLocation = glGetUniformLocation(program, "myPMVMatrix");
+
+	//Same quad layout as SpriteBatch: two triangles over four vertices
+	vector<GLushort> indices(maxGlyphs * 6);
+	for (int i = 0; i < maxGlyphs; i++) {
+		GLushort base = (GLushort)(i * 4);
+		indices[i * 6 + 0] = base;
+		indices[i * 6 + 1] = base + 1;
+		indices[i * 6 + 2] = base + 2;
+		indices[i * 6 + 3] = base;
+		indices[i * 6 + 4] = base + 2;
+		indices[i * 6 + 5] = base + 3;
+	}
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+
+	glGenBuffers(1, &vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, maxGlyphs * 4 * sizeof(TextVertex), NULL, GL_STREAM_DRAW);
+	vertices.reserve(maxGlyphs * 4);
+	return true;
+}
+
+void TextBatch::begin(const GLfloat* pmvMatrix, int viewportWidth, int viewportHeight) {
+	memcpy(matrix, pmvMatrix, sizeof(matrix));
+	float scaleX = length(matrix[0], matrix[1]) * viewportWidth * 0.5f;
+	float scaleY = length(matrix[4], matrix[5]) * viewportHeight * 0.5f;
+	pixelsPerUnit = scaleX > scaleY ? scaleX : scaleY;
+	glyphs.clear();
+	drawCalls = 0;
+}
+
+float TextBatch::draw(const SdfFont& font, const char* text, float x, float y, float size, GLuint color) {
+	//The field changes by 0.5 / spread per atlas texel; ramp over one pixel
+	float pixelsPerTexel = size * pixelsPerUnit / font.glyphSize();
+	float softness = 0.25f / (font.spread() * (pixelsPerTexel > 0.0f ? pixelsPerTexel : 1.0f));
+	softness = softness < 0.5f ? softness : 0.5f;
+
+	const TextureAtlas& atlas = font.atlas();
+	float penX = x, penY = y, widest = 0.0f;
+	for (const char* c = text; *c; c++) {
+		if (*c == '\n') {
+			widest = max(widest, penX - x);
+			penX = x;
+			penY -= font.lineHeight() * size;
+			continue;
+		}
+		const SdfGlyph* glyph = font.glyph((unsigned char)*c);
+		if (!glyph)
+			continue;
+		if (glyph->region >= 0) {
+			const AtlasRegion& r = atlas.region(glyph->region);
+			Glyph quad;
+			quad.texture = atlas.pageTexture(r.page);
+			float x0 = penX + glyph->x0 * size, x1 = penX + glyph->x1 * size;
+			float y0 = penY + glyph->y0 * size, y1 = penY + glyph->y1 * size;
+			const float px[4] = { x0, x0, x1, x1 };
+			const float py[4] = { y1, y0, y0, y1 };
+			const float pu[4] = { r.u0, r.u0, r.u1, r.u1 };
+			const float pv[4] = { r.v1, r.v0, r.v0, r.v1 };
+			for (int i = 0; i < 4; i++) {
+				TextVertex& v = quad.vertices[i];
+				v.x = px[i];
+				v.y = py[i];
+				v.u = pu[i];
+				v.v = pv[i];
+				v.r = (GLubyte)(color & 0xff);
+				v.g = (GLubyte)((color >> 8) & 0xff);
+				v.b = (GLubyte)((color >> 16) & 0xff);
+				v.a = (GLubyte)(color >> 24);
+				v.softness = softness;
+			}
+			glyphs.push_back(quad);
+		}
+		penX += glyph->advance * size;
+	}
+	return max(widest, penX - x);
+}
+
+float TextBatch::measure(const SdfFont& font, const char* text, float size) {
+	float width = 0.0f, widest = 0.0f;
+	for (const char* c = text; *c; c++) {
+		if (*c == '\n') {
+			widest = max(widest, width);
+			width = 0.0f;
+			continue;
+		}
+		const SdfGlyph* glyph = font.glyph((unsigned char)*c);
+		if (glyph)
+			width += glyph->advance * size;
+	}
+	return max(widest, width);
+}
+
+bool TextBatch::byTexture(const Glyph& a, const Glyph& b) {
+	return a.texture < b.texture;
+}
+
+int TextBatch::end() {
+	if (glyphs.empty())
+		return 0;
+
+	//Glyphs only overlap within a string, so painter's order matters less
+	//than for sprites, but a stable sort keeps it anyway
+	stable_sort(glyphs.begin(), glyphs.end(), byTexture);
+
+	glUseProgram(program);
+	glUniformMatrix4fv(matrixLocation, 1, GL_FALSE, matrix);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glEnableVertexAttribArray(VERTEX_ARRAY);
+	glEnableVertexAttribArray(TEXCOORD_ARRAY);
+	glEnableVertexAttribArray(COLOR_ARRAY);
+	glEnableVertexAttribArray(SOFTNESS_ARRAY);
+	glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)0);
+	glVertexAttribPointer(TEXCOORD_ARRAY, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)(2 * sizeof(GLfloat)));
+	glVertexAttribPointer(COLOR_ARRAY, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextVertex), (void*)(4 * sizeof(GLfloat)));
+	glVertexAttribPointer(SOFTNESS_ARRAY, 1, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)(5 * sizeof(GLfloat)));
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	for (size_t first = 0; first < glyphs.size(); first += maxGlyphs)
+		flush(first, min(glyphs.size() - first, (size_t)maxGlyphs));
+
+	glDisable(GL_BLEND);
+	glDisableVertexAttribArray(COLOR_ARRAY);
+	glDisableVertexAttribArray(SOFTNESS_ARRAY);
+	glyphs.clear();
+	return drawCalls;
+}
+
+//Uploads up to maxGlyphs sorted glyphs and draws each run of one page
+void TextBatch::flush(size_t first, size_t count) {
+	vertices.clear();
+	for (size_t i = first; i < first + count; i++)
+		vertices.insert(vertices.end(), glyphs[i].vertices, glyphs[i].vertices + 4);
+
+	//Orphan the previous contents so the driver does not wait for the GPU
+	glBufferData(GL_ARRAY_BUFFER, maxGlyphs * 4 * sizeof(TextVertex), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(TextVertex), &vertices[0]);
+
+	size_t run = first;
+	while (run < first + count) {
+		size_t next = run;
+		while (next < first + count && glyphs[next].texture == glyphs[run].texture)
+			next++;
+		glBindTexture(GL_TEXTURE_2D, glyphs[run].texture);
+		glDrawElements(GL_TRIANGLES, (GLsizei)(next - run) * 6, GL_UNSIGNED_SHORT,
+			(void*)((run - first) * 6 * sizeof(GLushort)));
+		drawCalls++;
+		run = next;
+	}
+}
@@ -0,0 +1,71 @@
+#ifndef TEXT_BATCH_H_INCLUDED
+#define TEXT_BATCH_H_INCLUDED
+
+#include <vector>
+#include <GLES2/gl2.h>
+#include "sdffont.h"
+
+//Interleaved vertex of a glyph quad, 24 bytes
+struct TextVertex {
+	GLfloat x, y;
+	GLfloat u, v;
+	GLubyte r, g, b, a;
+	GLfloat softness;	//Half the width of the edge ramp, in field units
+};
+
+/* Lays out strings of SdfFont glyphs between begin() and end() and draws
+ * them with one glDrawElements per atlas page.
+ *
+ * The fragment shader thresholds the distance field at the outline and
+ * ramps alpha over about one screen pixel, which draw() works out from the
+ * matrix, the viewport and the text size, so every size stays sharp from
+ * the same atlas.  Colours are packed as 0xAABBGGRR.
+ */
+class TextBatch {
+	public:
+		//At most 16384 glyphs fit the 16-bit index buffer of one flush
+		explicit TextBatch(int maxGlyphs = 16384);
+		~TextBatch();
+
+		//Creates the program and buffers; needs a current context
+		bool init();
+
+		void begin(const GLfloat* pmvMatrix, int viewportWidth, int viewportHeight);
+
+		//Queues text with the baseline of its first line starting at x, y,
+		//size units per em; '\n' starts a new line.  Returns the width of
+		//the longest line.
+		float draw(const SdfFont& font, const char* text, float x, float y, float size,
+				   GLuint color = 0xffffffff);
+
+		//Submits everything queued since begin() with blending on and
+		//returns the draw calls issued.  Leaves blending disabled and the
+		//batch program and buffers bound.
+		int end();
+
+		//Width of the longest line of text, without drawing it
+		static float measure(const SdfFont& font, const char* text, float size);
+
+	private:
+		struct Glyph {
+			GLuint texture;
+			TextVertex vertices[4];
+		};
+
+		static bool byTexture(const Glyph& a, const Glyph& b);
+		void flush(size_t first, size_t count);
+
+		int maxGlyphs;
+		GLuint program;
+		GLint matrixLocation;
+		GLuint vertexBuffer;
+		GLuint indexBuffer;
+		GLfloat matrix[16];
+		float pixelsPerUnit;
+		int drawCalls;
+
+		std::vector<Glyph> glyphs;
+		std::vector<TextVertex> vertices;
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "stdafx.h"
+#include <string.h>
+#include "textureloader.h"
+#include "mipmap.h"
+#include "glprogram.h"
+
+//Makes the image into a texture, and returns the id of the texture
+GLuint loadTexture(Image* image) {
+	GLuint textureId;
+	glGenTextures(1, &textureId); //Make room for our texture
+	glBindTexture(GL_TEXTURE_2D, textureId); //Tell OpenGL which texture to edit
+											 //Map the image to the texture
+	glTexImage2D(GL_TEXTURE_2D,                //Always GL_TEXTURE_2D
+		0,                            //0 for now
+		GL_RGB,                       //Format OpenGL uses for image
+		image->width, image->height,  //Width and height
+		0,                            //The border of the image
+		GL_RGB, //GL_RGB, because pixels are stored in RGB format
+		GL_UNSIGNED_BYTE, //GL_UNSIGNED_BYTE, because pixels are stored
+						  //as unsigned numbers
+		image->pixels);               //The actual pixel data
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return textureId; //Returns the id of the texture
+}
+
+namespace {
+	bool isListedFormat(GLenum internalFormat) {
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+		if (count <= 0)
+			return false;
+		GLint* formats = new GLint[count];
+		glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats);
+		bool listed = false;
+		for (GLint i = 0; i < count && !listed; i++)
+			listed = (GLenum)formats[i] == internalFormat;
+		delete[] formats;
+		return listed;
+	}
+
+	bool isPowerOfTwo(int value) {
+		return value > 0 && (value & (value - 1)) == 0;
+	}
+
+	bool isASTC(GLenum internalFormat) {
+		return (internalFormat >= GL_COMPRESSED_RGBA_ASTC_4x4_KHR &&
+				internalFormat <= GL_COMPRESSED_RGBA_ASTC_12x12_KHR) ||
+			   (internalFormat >= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR &&
+				internalFormat <= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12_KHR);
+	}
+}
+
+bool supportsMipmaps(int width, int height) {
+	if (isPowerOfTwo(width) && isPowerOfTwo(height))
+		return true;
+	const char* version = (const char*)glGetString(GL_VERSION);
+	if (version && strncmp(version, "OpenGL ES ", 10) == 0 && version[10] >= '3')
+		return true;
+	return hasExtension("GL_OES_texture_npot");
+}
+
+bool fitsInTexture(int width, int height) {
+	GLint maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	return width <= maxTextureSize && height <= maxTextureSize;
+}
+
+bool isCompressedFormatSupported(GLenum internalFormat) {
+	if (internalFormat == GL_ETC1_RGB8_OES) {
+		return hasExtension("GL_OES_compressed_ETC1_RGB8_texture") ||
+			   isListedFormat(GL_ETC1_RGB8_OES) ||
+			   isListedFormat(GL_COMPRESSED_RGB8_ETC2);
+	}
+	if (isASTC(internalFormat) && hasExtension("GL_KHR_texture_compression_astc_ldr"))
+		return true;
+	return isListedFormat(internalFormat);
+}
+
+size_t uploadedLevels(const KTXTexture* ktx) {
+	//NPOT textures without mip support are incomplete with more than level 0
+	if (ktx->levels.size() > 1 && !supportsMipmaps(ktx->width, ktx->height))
+		return 1;
+	return ktx->levels.size();
+}
+
+GLuint loadTexture(const KTXTexture* ktx) {
+	GLenum internalFormat = ktx->glInternalFormat;
+	if (ktx->isCompressed()) {
+		if (!isCompressedFormatSupported(internalFormat))
+			return 0;
+		//ETC2 decoders read ETC1 blocks unchanged
+		if (internalFormat == GL_ETC1_RGB8_OES &&
+			!hasExtension("GL_OES_compressed_ETC1_RGB8_texture") &&
+			!isListedFormat(GL_ETC1_RGB8_OES))
+			internalFormat = GL_COMPRESSED_RGB8_ETC2;
+	}
+
+	GLuint textureId;
+	glGenTextures(1, &textureId);
+	glBindTexture(GL_TEXTURE_2D, textureId);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);	//KTX rows are padded to 4 bytes
+	size_t levelCount = uploadedLevels(ktx);
+	for (size_t level = 0; level < levelCount; level++) {
+		GLsizei width = ktx->width >> level ? ktx->width >> level : 1;
+		GLsizei height = ktx->height >> level ? ktx->height >> level : 1;
+		const std::vector<char>& bytes = ktx->levels[level];
+		if (ktx->isCompressed()) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, internalFormat,
+				width, height, 0, (GLsizei)bytes.size(), bytes.empty() ? NULL : &bytes[0]);
+		}
+		else {
+			glTexImage2D(GL_TEXTURE_2D, (GLint)level, ktx->glFormat, width, height, 0,
+				ktx->glFormat, ktx->glType, bytes.empty() ? NULL : &bytes[0]);
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+		levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return textureId;
+}
+
+namespace {
+	//Uploads one level of image in the given format
+	void uploadLevel(GLint level, const Image* image, PixelFormat format, bool dither) {
+		if (format == PIXEL_RGB888) {
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);	//RGB rows of odd levels aren't 4-byte aligned
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, image->width, image->height,
+				0, GL_RGB, GL_UNSIGNED_BYTE, image->pixels);
+		}
+		else {
+			unsigned short* texels = convertImage(image, format, dither);
+			GLenum glFormat = pixelFormatGLFormat(format);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+			glTexImage2D(GL_TEXTURE_2D, level, glFormat, image->width, image->height,
+				0, glFormat, pixelFormatGLType(format), texels);
+			delete[] texels;
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	//Level 0 in the given format, then the mip chain the mode asks for.  CPU
+	//levels are filtered at 8 bits and converted one by one.
+	GLuint createTexture(Image* image, PixelFormat format, bool dither,
+						 MipmapMode mode, bool srgbFilter) {
+		GLuint textureId;
+		glGenTextures(1, &textureId);
+		glBindTexture(GL_TEXTURE_2D, textureId);
+		uploadLevel(0, image, format, dither);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		if (mode == MIPMAP_NONE || !supportsMipmaps(image->width, image->height))
+			return textureId;
+
+		if (mode == MIPMAP_GENERATE) {
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+		else {
+			std::vector<Image*> levels = generateMipChain(image,
+				mode == MIPMAP_KAISER ? MIP_FILTER_KAISER : MIP_FILTER_BOX, srgbFilter);
+			for (size_t i = 0; i < levels.size(); i++) {
+				uploadLevel((GLint)(i + 1), levels[i], format, dither);
+				delete levels[i];
+			}
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		return textureId;
+	}
+}
+
+GLuint loadTexture(Image* image, MipmapMode mode, bool srgbFilter) {
+	return createTexture(image, PIXEL_RGB888, false, mode, srgbFilter);
+}
+
+GLuint loadTexture(Image* image, PixelFormat format, bool dither, MipmapMode mode, bool srgbFilter) {
+	return createTexture(image, format, dither, mode, srgbFilter);
+}
@@ -0,0 +1,55 @@
+#ifndef TEXTURE_LOADER_H_INCLUDED
+#define TEXTURE_LOADER_H_INCLUDED
+
+#include <GLES2/gl2.h>
+#include "imageloader.h"
+#include "ktx.h"
+#include "pixelformat.h"
+
+//Makes the image into a texture, and returns the id of the texture
+GLuint loadTexture(Image* image);
+
+//How loadTexture builds the mip levels of an image
+enum MipmapMode {
+	MIPMAP_NONE,		//Level 0 only, GL_LINEAR minification
+	MIPMAP_GENERATE,	//glGenerateMipmap on the driver
+	MIPMAP_BOX,			//CPU 2x2 box filter, see mipmap.h
+	MIPMAP_KAISER		//CPU Kaiser filter, sharper than the box
+};
+
+//Makes the image into a texture with a full mip chain and trilinear
+//minification.  srgbFilter averages the CPU levels in linear light.  On ES
+//2.0 contexts without GL_OES_texture_npot a non power of two image can't
+//have mips; it is uploaded without them as with MIPMAP_NONE.
+GLuint loadTexture(Image* image, MipmapMode mode, bool srgbFilter = false);
+
+//Makes the image into a texture stored in the given format, converting it
+//with convertRGB; see pixelformat.h for what each format saves.  Assets pick
+//their own format: RGB565 for opaque UI and gradients with dither on,
+//RGB888 where banding can't be tolerated.
+GLuint loadTexture(Image* image, PixelFormat format, bool dither = true,
+				   MipmapMode mode = MIPMAP_NONE, bool srgbFilter = false);
+
+//Returns true if a texture of the given size can have mips: always for power
+//of two sizes, otherwise only on ES 3.0 or with GL_OES_texture_npot
+bool supportsMipmaps(int width, int height);
+
+//Returns true if a single texture of the given size fits GL_MAX_TEXTURE_SIZE;
+//larger images have to be drawn through a VirtualTexture
+bool fitsInTexture(int width, int height);
+
+//Returns true if the current context can sample the compressed format.  ETC1
+//also counts as supported on contexts that only list ETC2.
+bool isCompressedFormatSupported(GLenum internalFormat);
+
+//Makes a texture out of every level of a KTX texture.  Compressed levels are
+//uploaded with glCompressedTexImage2D.  Where supportsMipmaps() is false only
+//level 0 is, sampled with GL_LINEAR.  Returns 0 if the context can't sample
+//the format, so the caller can fall back to an uncompressed asset.
+GLuint loadTexture(const KTXTexture* ktx);
+
+//Levels of ktx that loadTexture uploads: all of them, or only level 0 where
+//supportsMipmaps() is false.  Needs a current context.
+size_t uploadedLevels(const KTXTexture* ktx);
+
+#endif
@@ -0,0 +1,272 @@
+#include "stdafx.h"
+#include <string.h>
+#include <fstream>
+#include "texturemanager.h"
+#include "imageloader.h"
+#include "ktx.h"
+
+using namespace std;
+
+namespace {
+	//Bytes of a texture with texelBytes per texel, with or without a full chain
+	size_t textureBytes(int width, int height, int texelBytes, bool mipmapped) {
+		size_t bytes = 0;
+		for (;;) {
+			bytes += (size_t)width * height * texelBytes;
+			if (!mipmapped || (width == 1 && height == 1))
+				return bytes;
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+	}
+
+	//What loadTexture leaves of ktx on the GPU: the levels it uploads,
+	//uncompressed texels at the size the driver stores them
+	size_t ktxBytes(const KTXTexture* ktx) {
+		size_t levelCount = uploadedLevels(ktx);
+		int texelBytes = 2;	//Packed 16-bit types
+		if (ktx->glType == GL_UNSIGNED_BYTE) {
+			if (ktx->glFormat == GL_RGB || ktx->glFormat == GL_RGBA)
+				texelBytes = 4;
+			else
+				texelBytes = ktx->glFormat == GL_LUMINANCE_ALPHA ? 2 : 1;
+		}
+		size_t bytes = 0;
+		for (size_t level = 0; level < levelCount; level++) {
+			if (ktx->isCompressed()) {
+				bytes += ktx->levels[level].size();
+			}
+			else {
+				int width = ktx->width >> level ? ktx->width >> level : 1;
+				int height = ktx->height >> level ? ktx->height >> level : 1;
+				bytes += (size_t)width * height * texelBytes;
+			}
+		}
+		return bytes;
+	}
+
+	bool isKTX(const string& path) {
+		return path.size() > 4 && _stricmp(path.c_str() + path.size() - 4, ".ktx") == 0;
+	}
+
+	//loadBMP asserts on a missing file, so look before calling it
+	bool fileExists(const char* path) {
+		ifstream input(path, ifstream::binary);
+		return input.is_open();
+	}
+}
+
+TextureManager::TextureManager(size_t budgetBytes_) :
+	budgetBytes(budgetBytes_), current(0), peak(0), evicted(0), evictions(0), reloads(0), frame(0) {
+}
+
+TextureManager::~TextureManager() {
+	clear();
+}
+
+TextureHandle TextureManager::allocate() {
+	if (!freeHandles.empty()) {
+		TextureHandle handle = freeHandles.back();
+		freeHandles.pop_back();
+		return handle;
+	}
+	entries.push_back(Entry());
+	return (TextureHandle)entries.size() - 1;
+}
+
+TextureHandle TextureManager::load(const char* path, PixelFormat format, MipmapMode mode, bool srgbFilter) {
+	return add(path, NULL, format, mode, srgbFilter);
+}
+
+TextureHandle TextureManager::load(const AssetPack& pack, const char* name) {
+	return add(name, &pack, PIXEL_RGB888, MIPMAP_NONE, false);
+}
+
+TextureHandle TextureManager::add(const char* path, const AssetPack* pack, PixelFormat format,
+								  MipmapMode mode, bool srgbFilter) {
+	TextureHandle handle = allocate();
+	Entry& entry = entries[handle];
+	entry.live = true;
+	entry.path = path;
+	entry.pack = pack;
+	entry.format = format;
+	entry.mode = mode;
+	entry.srgbFilter = srgbFilter;
+	entry.id = 0;
+	entry.owned = true;
+	entry.originBottom = true;
+	entry.bytes = 0;
+	if (!upload(entry)) {
+		entry.live = false;
+		freeHandles.push_back(handle);
+		return INVALID_TEXTURE;
+	}
+	makeResident(handle, entry.bytes);
+	return handle;
+}
+
+TextureHandle TextureManager::createRenderTarget(int width, int height, bool mipmapped) {
+	TextureHandle handle = allocate();
+	Entry& entry = entries[handle];
+	entry.live = true;
+	entry.path.clear();
+	entry.pack = NULL;
+	entry.format = PIXEL_RGB888;
+	entry.mode = mipmapped ? MIPMAP_GENERATE : MIPMAP_NONE;
+	entry.srgbFilter = false;
+	entry.bytes = textureBytes(width, height, 4, mipmapped);
+	entry.owned = true;
+	entry.originBottom = true;
+
+	glGenTextures(1, &entry.id);
+	glBindTexture(GL_TEXTURE_2D, entry.id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	makeResident(handle, entry.bytes);
+	return handle;
+}
+
+TextureHandle TextureManager::track(GLuint texture, int width, int height, int texelBytes) {
+	TextureHandle handle = allocate();
+	Entry& entry = entries[handle];
+	entry.live = true;
+	entry.path.clear();
+	entry.pack = NULL;
+	entry.format = PIXEL_RGB888;
+	entry.mode = MIPMAP_NONE;
+	entry.srgbFilter = false;
+	entry.bytes = textureBytes(width, height, texelBytes, false);
+	entry.owned = false;
+	entry.originBottom = true;
+	entry.id = texture;
+	makeResident(handle, entry.bytes);
+	return handle;
+}
+
+bool TextureManager::upload(Entry& entry) {
+	if (entry.pack) {
+		PackAsset asset;
+		if (!entry.pack->find(entry.path.c_str(), &asset) || asset.type != PACK_TEXTURE_KTX)
+			return false;
+		KTXTexture* ktx = loadKTX(asset.data, asset.size);
+		if (!ktx)
+			return false;
+		entry.id = loadTexture(ktx);
+		entry.bytes = ktxBytes(ktx);
+		entry.originBottom = ktx->originBottom;
+		delete ktx;
+		return entry.id != 0;
+	}
+	if (isKTX(entry.path)) {
+		KTXTexture* ktx = loadKTX(entry.path.c_str());
+		if (!ktx)
+			return false;
+		entry.id = loadTexture(ktx);
+		entry.bytes = ktxBytes(ktx);
+		entry.originBottom = ktx->originBottom;
+		delete ktx;
+		return entry.id != 0;
+	}
+
+	if (!fileExists(entry.path.c_str()))
+		return false;
+	Image* image = loadBMP(entry.path.c_str());
+	entry.id = loadTexture(image, entry.format, true, entry.mode, entry.srgbFilter);
+	entry.bytes = textureBytes(image->width, image->height, entry.format == PIXEL_RGB888 ? 4 : 2,
+		entry.mode != MIPMAP_NONE && supportsMipmaps(image->width, image->height));
+	delete image;
+	return entry.id != 0;
+}
+
+void TextureManager::makeResident(TextureHandle handle, size_t bytes) {
+	Entry& entry = entries[handle];
+	entry.frame = frame;
+	current += bytes;
+	if (current > peak)
+		peak = current;
+	if (!entry.path.empty()) {
+		lru.push_front(handle);
+		entry.lruPosition = lru.begin();
+	}
+	enforceBudget();
+}
+
+GLuint TextureManager::texture(TextureHandle handle) {
+	if (handle < 0 || handle >= (TextureHandle)entries.size() || !entries[handle].live)
+		return 0;
+	Entry& entry = entries[handle];
+	if (!entry.id) {
+		if (!upload(entry))
+			return 0;
+		reloads++;
+		makeResident(handle, entry.bytes);
+		return entry.id;
+	}
+	entry.frame = frame;
+	if (!entry.path.empty())
+		lru.splice(lru.begin(), lru, entry.lruPosition);
+	return entry.id;
+}
+
+void TextureManager::bind(TextureHandle handle) {
+	glBindTexture(GL_TEXTURE_2D, texture(handle));
+}
+
+bool TextureManager::originBottom(TextureHandle handle) const {
+	if (handle < 0 || handle >= (TextureHandle)entries.size() || !entries[handle].live)
+		return true;
+	return entries[handle].originBottom;
+}
+
+void TextureManager::evict(TextureHandle handle) {
+	Entry& entry = entries[handle];
+	glDeleteTextures(1, &entry.id);
+	entry.id = 0;
+	current -= entry.bytes;
+	evicted += entry.bytes;
+	evictions++;
+	lru.erase(entry.lruPosition);
+}
+
+void TextureManager::enforceBudget() {
+	while (current > budgetBytes && !lru.empty()) {
+		TextureHandle victim = lru.back();
+		if (entries[victim].frame == frame)
+			break;
+		evict(victim);
+	}
+}
+
+void TextureManager::release(TextureHandle handle) {
+	if (handle < 0 || handle >= (TextureHandle)entries.size() || !entries[handle].live)
+		return;
+	Entry& entry = entries[handle];
+	if (entry.id) {
+		if (entry.owned)
+			glDeleteTextures(1, &entry.id);
+		current -= entry.bytes;
+		if (!entry.path.empty())
+			lru.erase(entry.lruPosition);
+	}
+	entry.id = 0;
+	entry.live = false;
+	freeHandles.push_back(handle);
+}
+
+void TextureManager::clear() {
+	for (size_t i = 0; i < entries.size(); i++)
+		release((TextureHandle)i);
+}
+
+void TextureManager::beginFrame() {
+	frame++;
+	enforceBudget();
+}
+
+void TextureManager::setBudget(size_t budgetBytes_) {
+	budgetBytes = budgetBytes_;
+	enforceBudget();
+}
@@ -0,0 +1,122 @@
+#ifndef TEXTURE_MANAGER_H_INCLUDED
+#define TEXTURE_MANAGER_H_INCLUDED
+
+#include <stddef.h>
+#include <list>
+#include <string>
+#include <vector>
+#include <GLES2/gl2.h>
+#include "textureloader.h"
+#include "assetpack.h"
+
+//Index of a texture in a TextureManager, stable across evictions
+typedef int TextureHandle;
+#define INVALID_TEXTURE -1
+
+/* Owns textures and keeps their total size under a budget.
+ *
+ * Every texture is accounted at the size the GPU keeps it: 32 bits per
+ * texel for GL_RGB and GL_RGBA (drivers pad RGB), 16 for the packed
+ * formats, the block size for compressed KTX levels, plus a third more for
+ * a mip chain.  When a load pushes the total over the budget the least
+ * recently used textures are deleted until it fits again.  An evicted
+ * texture keeps its handle and is reloaded from its file the next time
+ * texture() or bind() asks for it, so callers never see the eviction.
+ * Reloading from a mapped AssetPack costs no file system calls at all.
+ *
+ * Textures used since the last beginFrame() are never evicted; if the
+ * frame needs more than the budget the total goes over it instead of
+ * thrashing.  Render targets can't be reloaded and are never evicted, but
+ * still count against the budget.
+ */
+class TextureManager {
+	public:
+		explicit TextureManager(size_t budgetBytes = 64 << 20);
+		~TextureManager();
+
+		//Loads a .ktx or .bmp file.  format, mode and srgbFilter apply to BMP
+		//files as in loadTexture; KTX files keep the levels they carry.
+		//Returns INVALID_TEXTURE if the file can't be read or sampled.
+		TextureHandle load(const char* path, PixelFormat format = PIXEL_RGB888,
+						   MipmapMode mode = MIPMAP_NONE, bool srgbFilter = false);
+
+		//Loads a texture stored in a pack by "AssetTools pack".  The pack must
+		//stay open while the manager may reload the texture.
+		TextureHandle load(const AssetPack& pack, const char* name);
+
+		//Creates an empty RGBA texture to attach to a framebuffer.  With
+		//mipmapped the caller is expected to glGenerateMipmap it.
+		TextureHandle createRenderTarget(int width, int height, bool mipmapped = false);
+
+		//Accounts a texture created elsewhere, such as an atlas page, so
+		//currentBytes() covers it too; texelBytes is 4 for RGB and RGBA.
+		//Its creator keeps owning it: it is never evicted, and release()
+		//only stops counting it.
+		TextureHandle track(GLuint texture, int width, int height, int texelBytes = 4);
+
+		//Returns the GL texture, reloading it if it was evicted, and marks
+		//it used this frame.  Returns 0 if the handle is invalid or the
+		//reload fails.
+		GLuint texture(TextureHandle handle);
+		void bind(TextureHandle handle);
+
+		//False for a compressed KTX stored top-down, which loads with row 0
+		//at the top: sample it with t inverted.  See KTXTexture.
+		bool originBottom(TextureHandle handle) const;
+
+		//Deletes one texture, or all of them
+		void release(TextureHandle handle);
+		void clear();
+
+		//Starts a new frame; textures used in earlier frames become evictable
+		void beginFrame();
+
+		void setBudget(size_t budgetBytes);
+		size_t budget() const { return budgetBytes; }
+
+		//Bytes of resident textures now, the most there ever were, and the
+		//total evicted so far
+		size_t currentBytes() const { return current; }
+		size_t peakBytes() const { return peak; }
+		size_t evictedBytes() const { return evicted; }
+		int evictionCount() const { return evictions; }
+		int reloadCount() const { return reloads; }
+
+	private:
+		struct Entry {
+			bool live;
+			std::string path;	//File, or name in pack; empty for render targets
+			const AssetPack* pack;
+			PixelFormat format;
+			MipmapMode mode;
+			bool srgbFilter;
+			GLuint id;			//0 while evicted
+			bool owned;			//False for track()ed textures
+			bool originBottom;	//Row 0 is t = 0
+			size_t bytes;
+			unsigned int frame;
+			std::list<TextureHandle>::iterator lruPosition;
+		};
+
+		TextureHandle allocate();
+		TextureHandle add(const char* path, const AssetPack* pack, PixelFormat format,
+						  MipmapMode mode, bool srgbFilter);
+		bool upload(Entry& entry);
+		void makeResident(TextureHandle handle, size_t bytes);
+		void evict(TextureHandle handle);
+		void enforceBudget();
+
+		size_t budgetBytes;
+		size_t current;
+		size_t peak;
+		size_t evicted;
+		int evictions;
+		int reloads;
+		unsigned int frame;
+
+		std::vector<Entry> entries;
+		std::vector<TextureHandle> freeHandles;
+		std::list<TextureHandle> lru;	//Evictable resident textures, most recent first
+};
+
+#endif
@@ -0,0 +1,34 @@
+#include "stdafx.h"
+#include <math.h>
+#include "transform.h"
+#include "jobsystem.h"
+
+#define PI 3.14159f
+
+void transformMatrix(const Transform2D& transform, GLfloat* matrix) {
+	float c = transform.scale * cosf(transform.angle * PI / 180.0f);
+	float s = transform.scale * sinf(transform.angle * PI / 180.0f);
+	matrix[0] = c;
+	matrix[1] = -s;
+	matrix[2] = 0.0f;
+	matrix[3] = 0.0f;
+	matrix[4] = s;
+	matrix[5] = c;
+	matrix[6] = 0.0f;
+	matrix[7] = 0.0f;
+	matrix[8] = 0.0f;
+	matrix[9] = 0.0f;
+	matrix[10] = transform.scale;
+	matrix[11] = 0.0f;
+	matrix[12] = transform.x;
+	matrix[13] = transform.y;
+	matrix[14] = 0.0f;
+	matrix[15] = 1.0f;
+}
+
+void computeTransforms(const Transform2D* transforms, int count, GLfloat* matrices, int threads) {
+	parallelRanges(count, threads, [&](int first, int last) {
+		for (int i = first; i < last; i++)
+			transformMatrix(transforms[i], matrices + 16 * i);
+	});
+}
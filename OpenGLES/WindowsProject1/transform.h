@@ -0,0 +1,21 @@
+#ifndef TRANSFORM_H_INCLUDED
+#define TRANSFORM_H_INCLUDED
+
+#include <GLES2/gl2.h>
+
+//Placement of one object of the 2D demo scenes
+struct Transform2D {
+	float x, y;		//Translation
+	float angle;	//Rotation in degrees, clockwise like the angle of Heart.cpp
+	float scale;
+};
+
+//Writes the column-major matrix of transform for glUniformMatrix4fv: the
+//rotation and scale of Heart.cpp, then the translation
+void transformMatrix(const Transform2D& transform, GLfloat* matrix);
+
+//Writes count matrices of 16 floats, one per transform, split into threads
+//jobs, threads <= 0 letting the job system choose
+void computeTransforms(const Transform2D* transforms, int count, GLfloat* matrices, int threads = 0);
+
+#endif
@@ -0,0 +1,322 @@
+#include "stdafx.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "triangulator.h"
+
+using namespace std;
+
+namespace {
+	//Polygon as a circular doubly linked list of nodes.  Bridging a hole
+	//duplicates two nodes, so several nodes may share one vertex.
+	struct Ring {
+		const GLfloat* xy;
+		vector<int> vertex;
+		vector<int> prev;
+		vector<int> next;
+
+		float x(int node) const { return xy[2 * vertex[node]]; }
+		float y(int node) const { return xy[2 * vertex[node] + 1]; }
+
+		int add(int v, int after) {
+			int node = (int)vertex.size();
+			vertex.push_back(v);
+			if (after < 0) {
+				prev.push_back(node);
+				next.push_back(node);
+			} else {
+				prev.push_back(after);
+				next.push_back(next[after]);
+				prev[next[after]] = node;
+				next[after] = node;
+			}
+			return node;
+		}
+
+		void remove(int node) {
+			next[prev[node]] = next[node];
+			prev[next[node]] = prev[node];
+		}
+
+		bool same(int a, int b) const {
+			return x(a) == x(b) && y(a) == y(b);
+		}
+
+		//Twice the signed area of a, b, c; positive when counter-clockwise
+		float cross(int a, int b, int c) const {
+			return (x(b) - x(a)) * (y(c) - y(a)) - (y(b) - y(a)) * (x(c) - x(a));
+		}
+
+		bool reflex(int node) const {
+			return cross(prev[node], node, next[node]) <= 0.0f;
+		}
+
+		//Whether p lies inside or on the counter-clockwise triangle a, b, c
+		bool inTriangle(int a, int b, int c, int p) const {
+			return cross(a, b, p) >= 0.0f && cross(b, c, p) >= 0.0f && cross(c, a, p) >= 0.0f;
+		}
+	};
+
+	//Whether (x, y) lies inside or on the triangle a, b, c of either winding
+	bool inTriangle(float ax, float ay, float bx, float by, float cx, float cy, float x, float y) {
+		float d0 = (bx - ax) * (y - ay) - (by - ay) * (x - ax);
+		float d1 = (cx - bx) * (y - by) - (cy - by) * (x - bx);
+		float d2 = (ax - cx) * (y - cy) - (ay - cy) * (x - cx);
+		return (d0 >= 0.0f && d1 >= 0.0f && d2 >= 0.0f) || (d0 <= 0.0f && d1 <= 0.0f && d2 <= 0.0f);
+	}
+
+	float signedArea(const GLfloat* xy, int first, int last) {
+		float area = 0.0f;
+		for (int i = first, j = last - 1; i < last; j = i++)
+			area += (xy[2 * j] - xy[2 * i]) * (xy[2 * i + 1] + xy[2 * j + 1]);
+		return area;
+	}
+
+	//Links a contour into the ring counter-clockwise (or clockwise for holes),
+	//skipping repeated vertices.  Returns a node of it, or -1 if it has fewer
+	//than three distinct vertices.
+	int linkContour(Ring& ring, int first, int last, bool clockwise) {
+		bool reverse = (signedArea(ring.xy, first, last) > 0.0f) == clockwise;
+		int node = -1;
+		int count = 0;
+		for (int k = 0; k < last - first; k++) {
+			int v = reverse ? last - 1 - k : first + k;
+			if (node >= 0 && ring.xy[2 * v] == ring.x(node) && ring.xy[2 * v + 1] == ring.y(node))
+				continue;
+			node = ring.add(v, node);
+			count++;
+		}
+		if (count > 1 && ring.same(node, ring.next[node])) {
+			ring.remove(node);
+			node = ring.next[node];
+			count--;
+		}
+		return count >= 3 ? node : -1;
+	}
+
+	//Joins the hole containing node hole to the outer ring through outer
+	int bridgeHole(Ring& ring, int hole, int outer) {
+		//The rightmost vertex of the hole sees the outer ring along +x
+		int m = hole;
+		for (int n = ring.next[hole]; n != hole; n = ring.next[n]) {
+			if (ring.x(n) > ring.x(m) || (ring.x(n) == ring.x(m) && ring.y(n) < ring.y(m)))
+				m = n;
+		}
+		float mx = ring.x(m), my = ring.y(m);
+
+		//Nearest edge crossed by the ray, and its end furthest along x
+		int p = -1;
+		float hitX = 0.0f;
+		int n = outer;
+		do {
+			int b = ring.next[n];
+			float ay = ring.y(n), by = ring.y(b);
+			if ((ay <= my && my <= by) || (by <= my && my <= ay)) {
+				if (ay != by) {
+					float x = ring.x(n) + (my - ay) * (ring.x(b) - ring.x(n)) / (by - ay);
+					if (x >= mx && (p < 0 || x < hitX)) {
+						hitX = x;
+						p = ring.x(n) > ring.x(b) ? n : b;
+						if (x == mx)
+							break;
+					}
+				}
+			}
+			n = b;
+		} while (n != outer);
+		if (p < 0)
+			return outer;
+
+		//A reflex vertex inside the triangle m, hit, p would block the
+		//bridge; take the one closest in angle to the ray instead
+		if (hitX != mx) {
+			float px = ring.x(p), py = ring.y(p);
+			float best = -1.0f;
+			int start = p;
+			n = ring.next[p];
+			do {
+				float nx = ring.x(n), ny = ring.y(n);
+				if (nx >= mx && nx <= px && n != p && !(nx == mx && ny == my) && ring.reflex(n)) {
+					if (inTriangle(mx, my, hitX, my, px, py, nx, ny)) {
+						float tangent = fabsf(ny - my) / (nx - mx + 1e-20f);
+						if (best < 0.0f || tangent < best) {
+							best = tangent;
+							p = n;
+						}
+					}
+				}
+				n = ring.next[n];
+			} while (n != start);
+		}
+
+		//p -> m -> ...hole... -> m' -> p' -> rest of the outer ring
+		int m2 = ring.add(ring.vertex[m], ring.prev[m]);
+		int p2 = ring.add(ring.vertex[p], p);
+		int pn = ring.next[p2];
+		int mp = ring.prev[m2];
+		ring.next[p] = m;
+		ring.prev[m] = p;
+		ring.next[mp] = m2;
+		ring.prev[m2] = mp;
+		ring.next[m2] = p2;
+		ring.prev[p2] = m2;
+		ring.next[p2] = pn;
+		ring.prev[pn] = p2;
+		return outer;
+	}
+
+	bool isEar(const Ring& ring, int ear) {
+		int a = ring.prev[ear], c = ring.next[ear];
+		if (ring.cross(a, ear, c) <= 0.0f)
+			return false;
+		for (int n = ring.next[c]; n != a; n = ring.next[n]) {
+			if (ring.same(n, a) || ring.same(n, ear) || ring.same(n, c))
+				continue;
+			if (ring.reflex(n) && ring.inTriangle(a, ear, c, n))
+				return false;
+		}
+		return true;
+	}
+
+	bool rightmostFirst(const pair<float, int>& a, const pair<float, int>& b) {
+		return a.first > b.first;
+	}
+}
+
+int triangulate(const GLfloat* vertices, const int* contours, int contourCount,
+				vector<GLushort>& indices) {
+	indices.clear();
+	if (contourCount < 1 || contours[contourCount] > 65536)
+		return 0;
+
+	Ring ring;
+	ring.xy = vertices;
+	int outer = linkContour(ring, contours[0], contours[1], false);
+	if (outer < 0)
+		return 0;
+
+	//Holes are bridged from the rightmost in, so later bridges can't cross
+	//earlier ones
+	vector<pair<float, int> > holes;
+	for (int h = 1; h < contourCount; h++) {
+		int node = linkContour(ring, contours[h], contours[h + 1], true);
+		if (node < 0)
+			continue;
+		float right = ring.x(node);
+		for (int n = ring.next[node]; n != node; n = ring.next[n])
+			right = ring.x(n) > right ? ring.x(n) : right;
+		holes.push_back(make_pair(right, node));
+	}
+	sort(holes.begin(), holes.end(), rightmostFirst);
+	for (size_t h = 0; h < holes.size(); h++)
+		outer = bridgeHole(ring, holes[h].second, outer);
+
+	int remaining = 1;
+	for (int n = ring.next[outer]; n != outer; n = ring.next[n])
+		remaining++;
+
+	//Pass 0 clips proper ears, pass 1 drops collinear vertices, pass 2
+	//clips any convex vertex and pass 3 any vertex at all
+	int pass = 0;
+	int node = outer;
+	int stop = node;
+	while (remaining > 3) {
+		int a = ring.prev[node], c = ring.next[node];
+		bool clip = false;
+		bool drop = false;
+		switch (pass) {
+			case 0:
+				clip = isEar(ring, node);
+				break;
+			case 1:
+				drop = ring.cross(a, node, c) == 0.0f;
+				break;
+			case 2:
+				clip = ring.cross(a, node, c) > 0.0f;
+				break;
+			default:
+				clip = true;
+				break;
+		}
+		if (clip || drop) {
+			if (clip) {
+				indices.push_back((GLushort)ring.vertex[a]);
+				indices.push_back((GLushort)ring.vertex[node]);
+				indices.push_back((GLushort)ring.vertex[c]);
+			}
+			ring.remove(node);
+			remaining--;
+			//Back to strict ears as soon as anything changed
+			pass = 0;
+			node = c;
+			stop = c;
+			continue;
+		}
+		node = c;
+		if (node == stop)
+			pass++;
+	}
+	int a = ring.prev[node], c = ring.next[node];
+	if (ring.cross(a, node, c) != 0.0f) {
+		indices.push_back((GLushort)ring.vertex[a]);
+		indices.push_back((GLushort)ring.vertex[node]);
+		indices.push_back((GLushort)ring.vertex[c]);
+	}
+	return (int)indices.size() / 3;
+}
+
+TessellationCache::TessellationCache(size_t maxEntries_) :
+	maxEntries(maxEntries_ > 0 ? maxEntries_ : 1), hits(0), misses(0) {
+}
+
+const Tessellation& TessellationCache::get(const GLfloat* vertices, const int* contours, int contourCount) {
+	int floats = 2 * contours[contourCount];
+
+	//FNV-1a over the vertex bytes and the contour starts
+	unsigned long long hash = 14695981039346656037ULL;
+	const unsigned char* bytes = (const unsigned char*)vertices;
+	for (size_t i = 0; i < floats * sizeof(GLfloat); i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	bytes = (const unsigned char*)contours;
+	for (size_t i = 0; i < (contourCount + 1) * sizeof(int); i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	map<unsigned long long, EntryIterator>::iterator found = index.find(hash);
+	if (found != index.end()) {
+		Entry& entry = *found->second;
+		bool same = (int)entry.contours.size() == contourCount + 1 &&
+			(int)entry.tessellation.vertices.size() == floats &&
+			memcmp(&entry.contours[0], contours, (contourCount + 1) * sizeof(int)) == 0 &&
+			(floats == 0 || memcmp(&entry.tessellation.vertices[0], vertices, floats * sizeof(GLfloat)) == 0);
+		entries.splice(entries.begin(), entries, found->second);
+		if (same) {
+			hits++;
+			return entry.tessellation;
+		}
+	} else {
+		if (entries.size() >= maxEntries) {
+			index.erase(entries.back().hash);
+			entries.pop_back();
+		}
+		entries.push_front(Entry());
+		index[hash] = entries.begin();
+	}
+
+	//New shape, or a collision that takes over the entry
+	misses++;
+	Entry& entry = entries.front();
+	entry.hash = hash;
+	entry.contours.assign(contours, contours + contourCount + 1);
+	entry.tessellation.vertices.assign(vertices, vertices + floats);
+	triangulate(vertices, contours, contourCount, entry.tessellation.indices);
+	return entry.tessellation;
+}
+
+void TessellationCache::clear() {
+	entries.clear();
+	index.clear();
+}
@@ -0,0 +1,71 @@
+#ifndef TRIANGULATOR_H_INCLUDED
+#define TRIANGULATOR_H_INCLUDED
+
+#include <stddef.h>
+#include <list>
+#include <map>
+#include <vector>
+#include <GLES2/gl2.h>
+
+/* Triangulates a polygon with holes by ear clipping.
+ *
+ * vertices holds (x, y) pairs, one contour after another; contours holds
+ * the first vertex of each of the contourCount contours followed by the
+ * total vertex count, the layout of PathOutline.  The first contour is the
+ * outline, the others holes; either winding is accepted for both.  Holes
+ * are joined to the outline by bridge edges, then ears are clipped off.
+ * Concave and collinear vertices are handled, collinear ones dropped
+ * without a triangle.  Where the outline crosses itself and no proper ear
+ * remains, convex and then any vertices are clipped, so a bad outline
+ * still terminates with a best effort result.
+ *
+ * indices receives the triangles, counter-clockwise, as indices into
+ * vertices.  Returns the triangle count, 0 for fewer than three vertices
+ * or more than 65536, which GLushort indices can't address.
+ */
+int triangulate(const GLfloat* vertices, const int* contours, int contourCount,
+				std::vector<GLushort>& indices);
+
+//A triangulated shape, ready for glDrawElements(GL_TRIANGLES, ...)
+struct Tessellation {
+	std::vector<GLfloat> vertices;	//(x, y) pairs
+	std::vector<GLushort> indices;
+};
+
+/* Triangulations keyed by the contents of their outline, so a shape drawn
+ * again in a later frame, or by another instance, is only triangulated once.
+ * The key is an FNV-1a hash of the vertex and contour data; hits are
+ * compared in full, so a collision only costs a triangulation.
+ *
+ * Holds at most maxEntries shapes, dropping the least recently used.
+ */
+class TessellationCache {
+	public:
+		explicit TessellationCache(size_t maxEntries = 256);
+
+		//Returns the triangulation of the outline, triangulating it if it
+		//isn't cached.  The reference stays valid until the entry is dropped.
+		const Tessellation& get(const GLfloat* vertices, const int* contours, int contourCount);
+
+		void clear();
+
+		size_t size() const { return entries.size(); }
+		int hitCount() const { return hits; }
+		int missCount() const { return misses; }
+
+	private:
+		struct Entry {
+			unsigned long long hash;
+			std::vector<int> contours;
+			Tessellation tessellation;
+		};
+		typedef std::list<Entry>::iterator EntryIterator;
+
+		size_t maxEntries;
+		std::list<Entry> entries;	//Most recently used first
+		std::map<unsigned long long, EntryIterator> index;
+		int hits;
+		int misses;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef TRIPLE_BUFFER_H_INCLUDED
+#define TRIPLE_BUFFER_H_INCLUDED
+
+#include <atomic>
+
+/* Hands the latest value from one producer thread to one consumer thread
+ * without locks or waiting on either side.
+ *
+ * The producer fills back() and publish()es it; the consumer acquire()s and
+ * reads front().  Of the three slots one belongs to each side and the third
+ * is swapped with a single atomic exchange, so the producer can publish as
+ * often as it likes while the consumer is busy (intermediate values are
+ * dropped) and the consumer keeps its front() until it asks for a newer one.
+ */
+template<class T>
+class TripleBuffer {
+	public:
+		TripleBuffer() : writeIndex(0), readIndex(1), shared(2) {}
+
+		//Producer side
+		T& back() { return slots[writeIndex]; }
+		void publish() {
+			writeIndex = shared.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+
+		//Consumer side: moves to the latest published value and returns
+		//true, or returns false if nothing was published since the last call
+		bool acquire() {
+			if (!(shared.load(std::memory_order_relaxed) & FRESH))
+				return false;
+			readIndex = shared.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+			return true;
+		}
+		const T& front() const { return slots[readIndex]; }
+
+	private:
+		enum { INDEX_MASK = 3, FRESH = 4 };
+
+		T slots[3];
+		int writeIndex;
+		int readIndex;
+		std::atomic<int> shared;	//Index of the middle slot, FRESH if unread
+};
+
+#endif
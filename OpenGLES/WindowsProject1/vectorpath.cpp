@@ -0,0 +1,251 @@
+#include "stdafx.h"
+#include <math.h>
+#include "vectorpath.h"
+#include "glprogram.h"
+
+using namespace std;
+
+// Index to bind the attributes to vertex shaders
+#define VERTEX_ARRAY	0
+
+// Largest distance, in pixels, between a flattened curve and the real one
+#define PATH_TOLERANCE_PIXELS	0.25f
+// Bound on the segments of one curve, for degenerate tolerances
+#define MAX_CURVE_SEGMENTS		1024
+
+namespace {
+	const char* pszVertShader = "\
+		attribute highp vec2	myVertex;\
+		uniform mediump mat4	myPMVMatrix;\
+		void main(void)\
+		{\
+			gl_Position = myPMVMatrix * vec4(myVertex, 0.0, 1.0);\
+		}";
+	const char* pszFragShader = "\
+		uniform lowp vec4	myColor;\
+		void main (void)\
+		{\
+			gl_FragColor = myColor;\
+		}";
+
+	//Segments a curve needs by Wang's formula: n = sqrt(d(d-1)/8 * M / tolerance),
+	//M being the largest second difference of the control points
+	int curveSegments(float secondDifference, float degreeFactor, float tolerance) {
+		float n = ceilf(sqrtf(degreeFactor * secondDifference / tolerance));
+		return n < 1.0f ? 1 : (n > MAX_CURVE_SEGMENTS ? MAX_CURVE_SEGMENTS : (int)n);
+	}
+
+	float length(float x, float y) {
+		return sqrtf(x * x + y * y);
+	}
+}
+
+Path::Path() : outlineTolerance(0.0f), flattens(0) {
+}
+
+void Path::clear() {
+	verbs.clear();
+	points.clear();
+	outlineTolerance = 0.0f;
+}
+
+void Path::moveTo(float x, float y) {
+	verbs.push_back(MOVE);
+	points.push_back(x);
+	points.push_back(y);
+	outlineTolerance = 0.0f;
+}
+
+void Path::lineTo(float x, float y) {
+	verbs.push_back(LINE);
+	points.push_back(x);
+	points.push_back(y);
+	outlineTolerance = 0.0f;
+}
+
+void Path::quadTo(float cx, float cy, float x, float y) {
+	verbs.push_back(QUAD);
+	float p[] = { cx, cy, x, y };
+	points.insert(points.end(), p, p + 4);
+	outlineTolerance = 0.0f;
+}
+
+void Path::cubicTo(float c1x, float c1y, float c2x, float c2y, float x, float y) {
+	verbs.push_back(CUBIC);
+	float p[] = { c1x, c1y, c2x, c2y, x, y };
+	points.insert(points.end(), p, p + 6);
+	outlineTolerance = 0.0f;
+}
+
+void Path::close() {
+	verbs.push_back(CLOSE);
+	outlineTolerance = 0.0f;
+}
+
+const PathOutline& Path::flatten(float tolerance) const {
+	//Round down to a power of two, so nearby scales share the outline
+	int exponent;
+	frexpf(tolerance > 0.0f ? tolerance : 1e-6f, &exponent);
+	tolerance = ldexpf(0.5f, exponent);
+	if (tolerance == outlineTolerance)
+		return outline;
+	outlineTolerance = tolerance;
+	flattens++;
+
+	vector<GLfloat>& out = outline.vertices;
+	out.clear();
+	outline.contours.clear();
+
+	//A command after close() or at the very start opens a contour where
+	//the pen is
+	float x = 0.0f, y = 0.0f, startX = 0.0f, startY = 0.0f;
+	bool open = false;
+	const float* p = points.empty() ? NULL : &points[0];
+	for (size_t i = 0; i < verbs.size(); i++) {
+		if (verbs[i] == MOVE || verbs[i] == CLOSE) {
+			if (verbs[i] == MOVE) {
+				x = startX = p[0];
+				y = startY = p[1];
+				p += 2;
+			} else {
+				x = startX;
+				y = startY;
+			}
+			open = false;
+			continue;
+		}
+		if (!open) {
+			outline.contours.push_back((int)out.size() / 2);
+			out.push_back(x);
+			out.push_back(y);
+			startX = x;
+			startY = y;
+			open = true;
+		}
+
+		switch (verbs[i]) {
+			case LINE:
+				out.push_back(p[0]);
+				out.push_back(p[1]);
+				p += 2;
+				break;
+			case QUAD: {
+				float m = length(x - 2 * p[0] + p[2], y - 2 * p[1] + p[3]);
+				int n = curveSegments(m, 0.25f, tolerance);
+				for (int k = 1; k <= n; k++) {
+					float t = (float)k / n, s = 1.0f - t;
+					out.push_back(s * s * x + 2 * s * t * p[0] + t * t * p[2]);
+					out.push_back(s * s * y + 2 * s * t * p[1] + t * t * p[3]);
+				}
+				p += 4;
+				break;
+			}
+			case CUBIC: {
+				float m0 = length(x - 2 * p[0] + p[2], y - 2 * p[1] + p[3]);
+				float m1 = length(p[0] - 2 * p[2] + p[4], p[1] - 2 * p[3] + p[5]);
+				int n = curveSegments(m0 > m1 ? m0 : m1, 0.75f, tolerance);
+				for (int k = 1; k <= n; k++) {
+					float t = (float)k / n, s = 1.0f - t;
+					float b0 = s * s * s, b1 = 3 * s * s * t, b2 = 3 * s * t * t, b3 = t * t * t;
+					out.push_back(b0 * x + b1 * p[0] + b2 * p[2] + b3 * p[4]);
+					out.push_back(b0 * y + b1 * p[1] + b2 * p[3] + b3 * p[5]);
+				}
+				p += 6;
+				break;
+			}
+		}
+		x = out[out.size() - 2];
+		y = out[out.size() - 1];
+	}
+	outline.contours.push_back((int)out.size() / 2);
+
+	outline.bounds[0] = outline.bounds[1] = outline.bounds[2] = outline.bounds[3] = 0.0f;
+	for (size_t v = 0; v < out.size(); v += 2) {
+		if (v == 0 || out[v] < outline.bounds[0])
+			outline.bounds[0] = out[v];
+		if (v == 0 || out[v + 1] < outline.bounds[1])
+			outline.bounds[1] = out[v + 1];
+		if (v == 0 || out[v] > outline.bounds[2])
+			outline.bounds[2] = out[v];
+		if (v == 0 || out[v + 1] > outline.bounds[3])
+			outline.bounds[3] = out[v + 1];
+	}
+	return outline;
+}
+
+PathRenderer::PathRenderer() : program(0), matrixLocation(-1), colorLocation(-1),
+	viewportWidth(1), viewportHeight(1) {
+}
+
+PathRenderer::~PathRenderer() {
+	glDeleteProgram(program);
+}
+
+bool PathRenderer::init() {
+	const char* attribs[] = { "myVertex" };
+	program = buildProgram(pszVertShader, pszFragShader, attribs, 1);
+	if (!program)
+		return false;
+	matrixLocation = glGetUniformLocation(program, "myPMVMatrix");
+	colorLocation = glGetUniformLocation(program, "myColor");
+	return true;
+}
+
+void PathRenderer::begin(int width, int height) {
+	viewportWidth = width;
+	viewportHeight = height;
+	glUseProgram(program);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glEnableVertexAttribArray(VERTEX_ARRAY);
+	//Back facing fan triangles count windings down, so they must not be culled
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_STENCIL_TEST);
+	glStencilMask(0xff);
+}
+
+int PathRenderer::fill(const Path& path, const GLfloat* pmvMatrix, const GLfloat* color,
+					   FillRule rule) {
+	//Pixels covered by one path unit along x and y
+	float scaleX = length(pmvMatrix[0], pmvMatrix[1]) * viewportWidth * 0.5f;
+	float scaleY = length(pmvMatrix[4], pmvMatrix[5]) * viewportHeight * 0.5f;
+	float scale = scaleX > scaleY ? scaleX : scaleY;
+	const PathOutline& outline = path.flatten(PATH_TOLERANCE_PIXELS / (scale > 0.0f ? scale : 1.0f));
+	if (outline.contours.size() < 2)
+		return 0;
+
+	glUniformMatrix4fv(matrixLocation, 1, GL_FALSE, pmvMatrix);
+	glUniform4fv(colorLocation, 1, color);
+
+	//Stencil: the winding number (or its parity) of every pixel
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glStencilFunc(GL_ALWAYS, 0, 0xff);
+	if (rule == FILL_NONZERO) {
+		glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP);
+		glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
+	} else {
+		glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT);
+	}
+	glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 0, &outline.vertices[0]);
+	for (size_t i = 0; i + 1 < outline.contours.size(); i++) {
+		int count = outline.contours[i + 1] - outline.contours[i];
+		if (count >= 3)
+			glDrawArrays(GL_TRIANGLE_FAN, outline.contours[i], count);
+	}
+
+	//Cover: colour the box where the stencil is set, clearing it on the way
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glStencilFunc(GL_NOTEQUAL, 0, 0xff);
+	glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
+	const GLfloat* b = outline.bounds;
+	GLfloat box[] = { b[0], b[1], b[2], b[1], b[2], b[3], b[0], b[3] };
+	glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 0, box);
+	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	return (int)outline.vertices.size() / 2;
+}
+
+void PathRenderer::end() {
+	glDisable(GL_STENCIL_TEST);
+	glStencilFunc(GL_ALWAYS, 0, 0xff);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
@@ -0,0 +1,89 @@
+#ifndef VECTOR_PATH_H_INCLUDED
+#define VECTOR_PATH_H_INCLUDED
+
+#include <vector>
+#include <GLES2/gl2.h>
+
+enum FillRule {
+	FILL_NONZERO,
+	FILL_EVEN_ODD
+};
+
+//A path flattened to line segments
+struct PathOutline {
+	std::vector<GLfloat> vertices;	//(x, y) pairs, one contour after another
+	std::vector<int> contours;		//First vertex of each contour, then the vertex count
+	GLfloat bounds[4];				//minX, minY, maxX, maxY
+};
+
+/* An outline of move/line/quad/cubic commands, like an SVG path.  Contours
+ * are closed implicitly when filled.
+ *
+ * flatten() turns the curves into line segments, each curve getting as many
+ * as Wang's formula says keep it within the tolerance.  The result is
+ * cached in the path.  The tolerance is rounded down to a power of two
+ * first, so the cache survives small changes of scale from frame to frame.
+ */
+class Path {
+	public:
+		Path();
+
+		void clear();
+		void moveTo(float x, float y);
+		void lineTo(float x, float y);
+		void quadTo(float cx, float cy, float x, float y);
+		void cubicTo(float c1x, float c1y, float c2x, float c2y, float x, float y);
+		void close();
+
+		//The outline with no point further than tolerance from the curves
+		const PathOutline& flatten(float tolerance) const;
+
+		//Times the outline was rebuilt rather than taken from the cache
+		int flattenCount() const { return flattens; }
+
+	private:
+		enum Verb { MOVE, LINE, QUAD, CUBIC, CLOSE };
+
+		std::vector<unsigned char> verbs;
+		std::vector<float> points;	//Control and end points of the verbs
+
+		mutable PathOutline outline;
+		mutable float outlineTolerance;	//0 when outline is stale
+		mutable int flattens;
+};
+
+/* Fills paths with stencil-then-cover.  Every contour is drawn as a fan into
+ * the stencil buffer with colour writes off, counting windings up for front
+ * facing and down for back facing triangles (or inverting for even-odd);
+ * then the bounding box is drawn where the stencil is not zero, zeroing it
+ * again for the next path.  Any outline fills correctly, concave or with
+ * holes, without triangulating it on the CPU.
+ *
+ * Needs a surface with a stencil buffer.  Curves are flattened to a quarter
+ * of a pixel, from the matrix and the viewport given to begin().
+ */
+class PathRenderer {
+	public:
+		PathRenderer();
+		~PathRenderer();
+
+		//Creates the program; needs a current context
+		bool init();
+
+		//Sets up the stencil state for a run of fills
+		void begin(int viewportWidth, int viewportHeight);
+		//Returns the vertices the outline was flattened to
+		int fill(const Path& path, const GLfloat* pmvMatrix, const GLfloat* color,
+				 FillRule rule = FILL_NONZERO);
+		//Restores the stencil test and colour writes to their defaults
+		void end();
+
+	private:
+		GLuint program;
+		GLint matrixLocation;
+		GLint colorLocation;
+		int viewportWidth;
+		int viewportHeight;
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "stdafx.h"
+#include <math.h>
+#include <string.h>
+#include "vertexformat.h"
+#include "glprogram.h"
+
+namespace {
+	float clampf(float value, float low, float high) {
+		return value < low ? low : (value > high ? high : value);
+	}
+
+	//Offset of a normalized range: -1..1 for signed formats, 0..1 otherwise
+	float rangeLow(AttribFormat format) {
+		return format == ATTRIB_SHORT_NORM ? -1.0f : 0.0f;
+	}
+
+	bool normalized(AttribFormat format) {
+		return format == ATTRIB_SHORT_NORM || format == ATTRIB_UNSIGNED_BYTE_NORM;
+	}
+
+	void writeComponent(unsigned char* out, AttribFormat format, float value) {
+		switch (format) {
+			case ATTRIB_FLOAT:
+				memcpy(out, &value, sizeof(value));
+				break;
+			case ATTRIB_HALF: {
+				unsigned short half = floatToHalf(value);
+				memcpy(out, &half, sizeof(half));
+				break;
+			}
+			case ATTRIB_SHORT_NORM: {
+				//c / 32767 as ES 3.0 decodes it; ES 2.0's (2c + 1) / 65535
+				//is off by at most half a step
+				short s = (short)floorf(clampf(value, -1.0f, 1.0f) * 32767.0f + 0.5f);
+				memcpy(out, &s, sizeof(s));
+				break;
+			}
+			case ATTRIB_UNSIGNED_BYTE_NORM:
+				*out = (unsigned char)floorf(clampf(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+				break;
+		}
+	}
+}
+
+int attribFormatSize(AttribFormat format) {
+	switch (format) {
+		case ATTRIB_HALF:
+		case ATTRIB_SHORT_NORM:
+			return 2;
+		case ATTRIB_UNSIGNED_BYTE_NORM:
+			return 1;
+		default:
+			return 4;
+	}
+}
+
+GLenum attribFormatGLType(AttribFormat format) {
+	switch (format) {
+		case ATTRIB_HALF:
+			return GL_HALF_FLOAT_OES;
+		case ATTRIB_SHORT_NORM:
+			return GL_SHORT;
+		case ATTRIB_UNSIGNED_BYTE_NORM:
+			return GL_UNSIGNED_BYTE;
+		default:
+			return GL_FLOAT;
+	}
+}
+
+bool attribFormatSupported(AttribFormat format) {
+	return format != ATTRIB_HALF || hasExtension("GL_OES_vertex_half_float");
+}
+
+unsigned short floatToHalf(float value) {
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	unsigned short sign = (unsigned short)((bits >> 16) & 0x8000);
+	int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+	unsigned int mantissa = bits & 0x7fffff;
+
+	if (exponent >= 31) {
+		//NaN stays NaN, everything else too large saturates
+		if (((bits >> 23) & 0xff) == 0xff && mantissa)
+			return sign | 0x7e00;
+		return sign | 0x7bff;
+	}
+	if (exponent <= 0) {
+		//Denormal, or 0 below half the smallest one
+		if (exponent < -10)
+			return sign;
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		unsigned int half = mantissa >> shift;
+		unsigned int rest = mantissa & ((1u << shift) - 1);
+		unsigned int halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1)))
+			half++;
+		return sign | (unsigned short)half;
+	}
+	//Round to nearest even; a carry out of the mantissa bumps the exponent
+	unsigned int half = ((unsigned int)exponent << 10) | (mantissa >> 13);
+	unsigned int rest = mantissa & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++;
+	if (half >= 0x7c00)
+		half = 0x7bff;
+	return sign | (unsigned short)half;
+}
+
+float halfToFloat(unsigned short half) {
+	int exponent = (half >> 10) & 0x1f;
+	int mantissa = half & 0x3ff;
+	float value;
+	if (exponent == 0)
+		value = ldexpf((float)mantissa, -24);
+	else if (exponent == 31)
+		value = mantissa ? NAN : INFINITY;
+	else
+		value = ldexpf((float)(mantissa | 0x400), exponent - 25);
+	return half & 0x8000 ? -value : value;
+}
+
+VertexLayout::VertexLayout() : attribCount(0), vertexStride(0) {
+}
+
+VertexLayout& VertexLayout::add(GLuint index, int components, AttribFormat format, bool fitBounds) {
+	if (attribCount == MAX_ATTRIBS || components < 1 || components > 4)
+		return *this;
+	VertexAttrib& attrib = attribs[attribCount++];
+	attrib.index = index;
+	attrib.components = components;
+	attrib.format = format;
+	attrib.offset = vertexStride;
+	attrib.fitBounds = fitBounds && normalized(format);
+	vertexStride += (components * attribFormatSize(format) + 3) & ~3;
+	return *this;
+}
+
+const VertexAttrib* VertexLayout::find(GLuint index) const {
+	for (int i = 0; i < attribCount; i++) {
+		if (attribs[i].index == index)
+			return &attribs[i];
+	}
+	return NULL;
+}
+
+void VertexLayout::apply(const void* base) const {
+	for (int i = 0; i < attribCount; i++) {
+		const VertexAttrib& attrib = attribs[i];
+		glEnableVertexAttribArray(attrib.index);
+		glVertexAttribPointer(attrib.index, attrib.components, attribFormatGLType(attrib.format),
+							  normalized(attrib.format) ? GL_TRUE : GL_FALSE, vertexStride,
+							  (const char*)base + attrib.offset);
+	}
+}
+
+void VertexLayout::disable() const {
+	for (int i = 0; i < attribCount; i++)
+		glDisableVertexAttribArray(attribs[i].index);
+}
+
+void PackedMesh::decodeMatrix(int attrib, const GLfloat* matrix, GLfloat* out) const {
+	const Decode& d = decode[attrib];
+	//out = matrix * (translate(offset) * scale(scale))
+	for (int row = 0; row < 4; row++) {
+		GLfloat translated = matrix[12 + row];
+		for (int column = 0; column < 3; column++) {
+			out[column * 4 + row] = matrix[column * 4 + row] * d.scale[column];
+			translated += matrix[column * 4 + row] * d.offset[column];
+		}
+		out[12 + row] = translated;
+	}
+}
+
+void packMesh(const void* vertices, int count, const VertexLayout& source,
+			  const VertexLayout& target, PackedMesh* out) {
+	out->layout = target;
+	out->vertexCount = count;
+	out->sourceBytes = (size_t)count * source.stride();
+	out->data.assign((size_t)count * target.stride(), 0);
+	out->decode.resize(target.count());
+
+	const unsigned char* in = (const unsigned char*)vertices;
+	for (int a = 0; a < target.count(); a++) {
+		const VertexAttrib& to = target.attrib(a);
+		const VertexAttrib* from = source.find(to.index);
+		int components = from ? (from->components < to.components ? from->components : to.components) : 0;
+		PackedMesh::Decode& decode = out->decode[a];
+		for (int c = 0; c < 4; c++) {
+			decode.scale[c] = 1.0f;
+			decode.offset[c] = 0.0f;
+		}
+
+		//Bounds of each component, mapped onto the range of the format
+		if (to.fitBounds && count > 0) {
+			for (int c = 0; c < components; c++) {
+				float low, high;
+				memcpy(&low, in + from->offset + c * sizeof(GLfloat), sizeof(low));
+				high = low;
+				for (int v = 1; v < count; v++) {
+					float value;
+					memcpy(&value, in + (size_t)v * source.stride() + from->offset + c * sizeof(GLfloat), sizeof(value));
+					low = value < low ? value : low;
+					high = value > high ? value : high;
+				}
+				float lowOfRange = rangeLow(to.format);
+				float scale = (high - low) / (1.0f - lowOfRange);
+				decode.scale[c] = scale > 0.0f ? scale : 1.0f;
+				decode.offset[c] = low - lowOfRange * decode.scale[c];
+			}
+		}
+
+		int size = attribFormatSize(to.format);
+		for (int v = 0; v < count; v++) {
+			const unsigned char* src = in + (size_t)v * source.stride();
+			unsigned char* dst = &out->data[(size_t)v * target.stride() + to.offset];
+			for (int c = 0; c < to.components; c++) {
+				float value = 0.0f;
+				if (c < components)
+					memcpy(&value, src + from->offset + c * sizeof(GLfloat), sizeof(value));
+				value = (value - decode.offset[c]) / decode.scale[c];
+				writeComponent(dst + c * size, to.format, value);
+			}
+		}
+	}
+}
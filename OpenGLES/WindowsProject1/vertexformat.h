@@ -0,0 +1,125 @@
+#ifndef VERTEX_FORMAT_H_INCLUDED
+#define VERTEX_FORMAT_H_INCLUDED
+
+#include <vector>
+#include <GLES2/gl2.h>
+
+#ifndef GL_HALF_FLOAT_OES
+#define GL_HALF_FLOAT_OES 0x8D61
+#endif
+
+/* Types a vertex attribute can be stored as.
+ *
+ * Vertex fetch reads every byte of every vertex each time it is drawn, so
+ * smaller attributes save bandwidth on every draw, not just memory:
+ *
+ *   format           bytes/component  range
+ *   FLOAT            4                any
+ *   HALF             2                11-bit mantissa, up to 65504
+ *                                     (needs GL_OES_vertex_half_float)
+ *   SHORT_NORM       2                -1..1 in 65535 steps
+ *   UNSIGNED_BYTE    1                0..1 in 255 steps
+ *
+ * A Heart.cpp vertex shrinks from 12 bytes (x, y and a z that is always 0)
+ * to 4 as two normalized shorts, and a SourceCode.cpp quad vertex from 20 to
+ * 8 with the position in shorts and the texture coordinates in halves.
+ */
+enum AttribFormat {
+	ATTRIB_FLOAT,
+	ATTRIB_HALF,
+	ATTRIB_SHORT_NORM,
+	ATTRIB_UNSIGNED_BYTE_NORM
+};
+
+//Bytes of one component in the format
+int attribFormatSize(AttribFormat format);
+
+//The type argument of glVertexAttribPointer for the format
+GLenum attribFormatGLType(AttribFormat format);
+
+//False for ATTRIB_HALF without GL_OES_vertex_half_float; needs a current context
+bool attribFormatSupported(AttribFormat format);
+
+//IEEE half float nearest to value, saturating at 65504
+unsigned short floatToHalf(float value);
+float halfToFloat(unsigned short half);
+
+struct VertexAttrib {
+	GLuint index;			//Attribute location
+	int components;
+	AttribFormat format;
+	int offset;				//Bytes from the start of the vertex
+	bool fitBounds;			//Normalized to the mesh bounds, see packMesh()
+};
+
+/* The attributes of an interleaved vertex.  Each attribute starts on a
+ * multiple of 4 bytes, which some GPUs fetch faster and ES requires of
+ * strides in buffers anyway.
+ *
+ *	VertexLayout packed;
+ *	packed.add(VERTEX_ARRAY, 2, ATTRIB_SHORT_NORM, true)
+ *		  .add(TEXCOORD_ARRAY, 2, ATTRIB_HALF);
+ */
+class VertexLayout {
+	public:
+		VertexLayout();
+
+		//Appends an attribute.  Positions fitted to the bounds keep all the
+		//precision of a normalized format whatever the size of the mesh, at
+		//the cost of a decode the vertex transform has to apply.
+		VertexLayout& add(GLuint index, int components, AttribFormat format, bool fitBounds = false);
+
+		int stride() const { return vertexStride; }
+		int count() const { return attribCount; }
+		const VertexAttrib& attrib(int i) const { return attribs[i]; }
+		//The attribute bound to location index, or NULL
+		const VertexAttrib* find(GLuint index) const;
+
+		//Enables every attribute and points it at vertices starting at base,
+		//a client pointer or an offset into the bound GL_ARRAY_BUFFER
+		void apply(const void* base) const;
+		void disable() const;
+
+	private:
+		enum { MAX_ATTRIBS = 8 };
+
+		VertexAttrib attribs[MAX_ATTRIBS];
+		int attribCount;
+		int vertexStride;
+};
+
+/* Vertices quantized into a compact layout.
+ *
+ * Attributes fitted to the bounds store (value - offset) / scale, so the
+ * shader sees values in the range of the format; decodeMatrix() folds the
+ * scale and offset of a position into the matrix that transforms it.
+ */
+struct PackedMesh {
+	struct Decode {
+		GLfloat scale[4];
+		GLfloat offset[4];
+	};
+
+	VertexLayout layout;
+	std::vector<unsigned char> data;
+	int vertexCount;
+	size_t sourceBytes;			//Size of the vertices packMesh() read
+	std::vector<Decode> decode;	//One per attribute of layout
+
+	size_t bytes() const { return data.size(); }
+	size_t savedBytes() const { return sourceBytes > data.size() ? sourceBytes - data.size() : 0; }
+
+	//matrix * the decode of attribute attrib (the index in layout, not the
+	//location), both column-major 4x4
+	void decodeMatrix(int attrib, const GLfloat* matrix, GLfloat* out) const;
+};
+
+//Quantizes count vertices laid out as source, whose attributes must all be
+//ATTRIB_FLOAT, into target.  Each target attribute reads the source one of
+//the same location: extra source components are dropped (a z that is always
+//0 goes when the target has 2), missing ones read as 0.  Values outside the
+//range of a normalized format are clamped unless it fits the bounds.
+void packMesh(const void* vertices, int count, const VertexLayout& source,
+			  const VertexLayout& target, PackedMesh* out);
+
+#endif
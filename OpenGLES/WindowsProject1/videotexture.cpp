@@ -0,0 +1,235 @@
+#include "stdafx.h"
+#include <string>
+#include <string.h>
+#include "videotexture.h"
+#include "glprogram.h"
+
+using namespace std;
+
+// Index to bind the attributes to vertex shaders
+#define VERTEX_ARRAY	0
+#define TEXCOORD_ARRAY	1
+
+// Texture units of the planes
+#define Y_UNIT			0
+#define U_UNIT			1
+#define V_UNIT			2
+
+namespace {
+	const char* pszVertShader = "\
+		attribute highp vec2	myVertex;\
+		attribute mediump vec2	myUV;\
+		uniform mediump mat4	myPMVMatrix;\
+		varying mediump vec2	myTexCoord;\
+		void main(void)\
+		{\
+			gl_Position = myPMVMatrix * vec4(myVertex, 0.0, 1.0);\
+			myTexCoord = myUV;\
+		}";
+
+	//Compiled once per layout, with NV12 defined for the interleaved chroma
+	const char* pszFragShader = "\
+		uniform sampler2D yPlane;\n\
+		uniform sampler2D uPlane;\n\
+		uniform sampler2D vPlane;\n\
+		uniform mediump mat3 yuvToRgb;\n\
+		varying mediump vec2 myTexCoord;\n\
+		void main (void)\n\
+		{\n\
+			mediump vec3 yuv;\n\
+			yuv.x = texture2D(yPlane, myTexCoord).r;\n\
+		#ifdef NV12\n\
+			yuv.yz = texture2D(uPlane, myTexCoord).ra;\n\
+		#else\n\
+			yuv.y = texture2D(uPlane, myTexCoord).r;\n\
+			yuv.z = texture2D(vPlane, myTexCoord).r;\n\
+		#endif\n\
+			yuv -= vec3(16.0 / 255.0, 0.5, 0.5);\n\
+			gl_FragColor = vec4(yuvToRgb * yuv, 1.0);\n\
+		}";
+
+	//Limited range YUV to RGB, column major for glUniformMatrix3fv
+	const GLfloat BT601[9] = {
+		1.164f, 1.164f, 1.164f,
+		0.0f, -0.392f, 2.017f,
+		1.596f, -0.813f, 0.0f
+	};
+	const GLfloat BT709[9] = {
+		1.164f, 1.164f, 1.164f,
+		0.0f, -0.213f, 2.112f,
+		1.793f, -0.533f, 0.0f
+	};
+
+	GLuint createPlane(GLenum format, int width, int height) {
+		GLuint textureId;
+		glGenTextures(1, &textureId);
+		glBindTexture(GL_TEXTURE_2D, textureId);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+		return textureId;
+	}
+}
+
+int yuvFrameSize(int width, int height) {
+	return width * height + 2 * ((width + 1) / 2) * ((height + 1) / 2);
+}
+
+VideoTexture::VideoTexture(int width_, int height_, YuvLayout layout_, int ringSize_) :
+	frameWidth(width_), frameHeight(height_), layout(layout_), ringSize(max(ringSize_, 1)),
+	current(-1), frames(0), program(0), matrixLocation(-1) {
+}
+
+VideoTexture::~VideoTexture() {
+	for (size_t i = 0; i < ring.size(); i++) {
+		glDeleteTextures(1, &ring[i].y);
+		glDeleteTextures(1, &ring[i].u);
+		if (ring[i].v)
+			glDeleteTextures(1, &ring[i].v);
+	}
+	glDeleteProgram(program);
+}
+
+bool VideoTexture::init() {
+	string fragSrc = layout == YUV_NV12 ? string("#define NV12\n") + pszFragShader : pszFragShader;
+	const char* attribs[] = { "myVertex", "myUV" };
+	program = buildProgram(pszVertShader, fragSrc.c_str(), attribs, 2);
+	if (!program)
+		return false;
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "yPlane"), Y_UNIT);
+	glUniform1i(glGetUniformLocation(program, "uPlane"), U_UNIT);
+	glUniform1i(glGetUniformLocation(program, "vPlane"), V_UNIT);
+	glUniformMatrix3fv(glGetUniformLocation(program, "yuvToRgb"), 1, GL_FALSE,
+		frameHeight >= 720 ? BT709 : BT601);
+	matrixLocation = glGetUniformLocation(program, "myPMVMatrix");
+
+	int chromaWidth = (frameWidth + 1) / 2;
+	int chromaHeight = (frameHeight + 1) / 2;
+	ring.resize(ringSize);
+	for (int i = 0; i < ringSize; i++) {
+		ring[i].y = createPlane(GL_LUMINANCE, frameWidth, frameHeight);
+		if (layout == YUV_NV12) {
+			ring[i].u = createPlane(GL_LUMINANCE_ALPHA, chromaWidth, chromaHeight);
+			ring[i].v = 0;
+		}
+		else {
+			ring[i].u = createPlane(GL_LUMINANCE, chromaWidth, chromaHeight);
+			ring[i].v = createPlane(GL_LUMINANCE, chromaWidth, chromaHeight);
+		}
+	}
+	return true;
+}
+
+void VideoTexture::upload(const unsigned char* frame) {
+	int chromaWidth = (frameWidth + 1) / 2;
+	int chromaHeight = (frameHeight + 1) / 2;
+	const unsigned char* u = frame + frameWidth * frameHeight;
+	if (layout == YUV_NV12)
+		upload(frame, frameWidth, u, NULL, chromaWidth * 2);
+	else
+		upload(frame, frameWidth, u, u + chromaWidth * chromaHeight, chromaWidth);
+}
+
+void VideoTexture::upload(const unsigned char* y, int yStride, const unsigned char* u,
+						  const unsigned char* v, int uvStride) {
+	int chromaWidth = (frameWidth + 1) / 2;
+	int chromaHeight = (frameHeight + 1) / 2;
+	int next = (current + 1) % ringSize;
+	const PlaneSet& planes = ring[next];
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	uploadPlane(planes.y, GL_LUMINANCE, frameWidth, frameHeight, y, yStride, 1);
+	if (layout == YUV_NV12) {
+		uploadPlane(planes.u, GL_LUMINANCE_ALPHA, chromaWidth, chromaHeight, u, uvStride, 2);
+	}
+	else {
+		uploadPlane(planes.u, GL_LUMINANCE, chromaWidth, chromaHeight, u, uvStride, 1);
+		uploadPlane(planes.v, GL_LUMINANCE, chromaWidth, chromaHeight, v, uvStride, 1);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	current = next;
+	frames++;
+}
+
+void VideoTexture::uploadPlane(GLuint texture, GLenum format, int width, int height,
+							   const unsigned char* data, int stride, int texelBytes) {
+	//ES 2.0 can't skip row padding on upload, so padded planes are packed first
+	int rowBytes = width * texelBytes;
+	if (stride != rowBytes) {
+		scratch.resize(rowBytes * height);
+		for (int row = 0; row < height; row++)
+			memcpy(&scratch[rowBytes * row], data + stride * row, rowBytes);
+		data = &scratch[0];
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
+}
+
+void VideoTexture::draw(const GLfloat* pmvMatrix, float x, float y, float width, float height) {
+	if (current < 0)
+		return;
+
+	//Decoders store the top row first, so v = 0 is the top of the frame
+	GLfloat afQuad[] = {
+		x, y + height, 0.0f, 0.0f,
+		x, y, 0.0f, 1.0f,
+		x + width, y, 1.0f, 1.0f,
+		x + width, y + height, 1.0f, 0.0f
+	};
+
+	const PlaneSet& planes = ring[current];
+	glUseProgram(program);
+	glUniformMatrix4fv(matrixLocation, 1, GL_FALSE, pmvMatrix);
+	if (planes.v) {
+		glActiveTexture(GL_TEXTURE0 + V_UNIT);
+		glBindTexture(GL_TEXTURE_2D, planes.v);
+	}
+	glActiveTexture(GL_TEXTURE0 + U_UNIT);
+	glBindTexture(GL_TEXTURE_2D, planes.u);
+	glActiveTexture(GL_TEXTURE0 + Y_UNIT);
+	glBindTexture(GL_TEXTURE_2D, planes.y);
+
+	glEnableVertexAttribArray(VERTEX_ARRAY);
+	glEnableVertexAttribArray(TEXCOORD_ARRAY);
+	glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), afQuad);
+	glVertexAttribPointer(TEXCOORD_ARRAY, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), &afQuad[2]);
+	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	glDisableVertexAttribArray(TEXCOORD_ARRAY);
+}
+
+RawVideoFile::RawVideoFile() {
+}
+
+RawVideoFile::~RawVideoFile() {
+	close();
+}
+
+bool RawVideoFile::open(const char* filename, int width, int height) {
+	close();
+	file.open(filename, ifstream::binary);
+	frame.resize(yuvFrameSize(width, height));
+	return file.is_open();
+}
+
+void RawVideoFile::close() {
+	if (file.is_open())
+		file.close();
+	file.clear();
+}
+
+const unsigned char* RawVideoFile::nextFrame() {
+	if (!file.is_open())
+		return NULL;
+	if (file.read((char*)&frame[0], frame.size()))
+		return &frame[0];
+
+	//Loop back to the first frame; the short read set eof and fail
+	file.clear();
+	file.seekg(0, ifstream::beg);
+	if (file.read((char*)&frame[0], frame.size()))
+		return &frame[0];
+	return NULL;
+}
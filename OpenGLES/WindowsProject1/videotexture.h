@@ -0,0 +1,101 @@
+#ifndef VIDEO_TEXTURE_H_INCLUDED
+#define VIDEO_TEXTURE_H_INCLUDED
+
+#include <fstream>
+#include <vector>
+#include <GLES2/gl2.h>
+
+//Plane layouts decoders hand out, both 4:2:0 with 12 bits per pixel
+enum YuvLayout {
+	YUV_I420,	//Y plane, then U, then V, each chroma plane a quarter of Y
+	YUV_NV12	//Y plane, then one plane of interleaved U,V pairs
+};
+
+//Bytes of one frame: width * height luma plus half as much chroma
+int yuvFrameSize(int width, int height);
+
+/* Shows decoded video frames without converting them on the CPU.
+ *
+ * Every plane goes into its own texture as decoders produce it: Y and the
+ * I420 chroma planes as GL_LUMINANCE, the NV12 UV plane as
+ * GL_LUMINANCE_ALPHA (ES 2.0 has no two-channel format), so a frame uploads
+ * 1.5 bytes per pixel instead of the 3 of RGB.  The fragment shader does
+ * the YUV to RGB conversion with the BT.709 matrix for HD sizes and BT.601
+ * below 720 lines, both limited range.
+ *
+ * The textures form a ring of ringSize frames.  upload() fills the next
+ * set with glTexSubImage2D while the previous frames may still be read by
+ * queued draws, so the driver doesn't have to stall or copy the texture to
+ * honour the update.  draw() shows the most recently uploaded frame.
+ */
+class VideoTexture {
+	public:
+		VideoTexture(int width, int height, YuvLayout layout, int ringSize = 3);
+		~VideoTexture();
+
+		//Creates the textures and program; needs a current context
+		bool init();
+
+		//Uploads a frame stored contiguously in the layout's plane order
+		void upload(const unsigned char* frame);
+
+		//Uploads a frame from separate planes with their row strides in
+		//bytes; v is ignored for NV12
+		void upload(const unsigned char* y, int yStride, const unsigned char* u,
+					const unsigned char* v, int uvStride);
+
+		//Draws the latest frame into the rectangle (x, y, width, height).
+		//Leaves the video program bound.
+		void draw(const GLfloat* pmvMatrix, float x, float y, float width, float height);
+
+		int width() const { return frameWidth; }
+		int height() const { return frameHeight; }
+		int uploadedFrames() const { return frames; }
+
+	private:
+		//Textures of one frame; v is unused for NV12
+		struct PlaneSet {
+			GLuint y;
+			GLuint u;
+			GLuint v;
+		};
+
+		void uploadPlane(GLuint texture, GLenum format, int width, int height,
+						 const unsigned char* data, int stride, int texelBytes);
+
+		int frameWidth;
+		int frameHeight;
+		YuvLayout layout;
+		int ringSize;
+		int current;	//Set shown by draw(), -1 before the first upload
+		int frames;
+
+		GLuint program;
+		GLint matrixLocation;
+		std::vector<PlaneSet> ring;
+		std::vector<unsigned char> scratch;	//Tightly packed copy of strided planes
+};
+
+/* Reads raw frames from a file, standing in for a hardware decoder.  The
+ * file is headerless planes frame after frame, as written by
+ * "ffmpeg -i in.mp4 -pix_fmt nv12 -f rawvideo out.yuv".  Playback loops at
+ * the end of the file.
+ */
+class RawVideoFile {
+	public:
+		RawVideoFile();
+		~RawVideoFile();
+
+		bool open(const char* filename, int width, int height);
+		void close();
+
+		//Returns the next frame, valid until the next call, or NULL if the
+		//file holds no complete frame
+		const unsigned char* nextFrame();
+
+	private:
+		std::ifstream file;
+		std::vector<unsigned char> frame;
+};
+
+#endif
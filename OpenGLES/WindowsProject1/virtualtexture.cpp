@@ -0,0 +1,278 @@
+#include "stdafx.h"
+#include <math.h>
+#include <string.h>
+#include "virtualtexture.h"
+#include "glprogram.h"
+#include "mipmap.h"
+#include "textureloader.h"
+
+using namespace std;
+
+// Index to bind the attributes to vertex shaders
+#define VERTEX_ARRAY	0
+#define TEXCOORD_ARRAY	1
+
+// Texture units the shader samples
+#define CACHE_UNIT		0
+#define TABLE_UNIT		1
+#define FALLBACK_UNIT	2
+
+// Largest side of the always resident low resolution copy
+#define FALLBACK_SIZE	256
+
+// Slot coordinates are stored in the bytes of the page table
+#define MAX_SLOTS_PER_ROW	255
+
+namespace {
+	const char* pszVertShader = "\
+		attribute highp vec2	myVertex;\
+		attribute mediump vec2	myUV;\
+		uniform mediump mat4	myPMVMatrix;\
+		varying highp vec2		myTexCoord;\
+		void main(void)\
+		{\
+			gl_Position = myPMVMatrix * vec4(myVertex, 0.0, 1.0);\
+			myTexCoord = myUV;\
+		}";
+
+	/* vtPages.xy is the image size in pages (fractional for partial pages at
+	 * the right and top), vtPages.zw the page table size.  vtCache.xy is the
+	 * size of one slot and vtCache.zw of one texel, both in cache texture
+	 * coordinates, and vtPayload the image texels per page.
+	 */
+	const char* pszFragShader = "\
+		#ifdef GL_FRAGMENT_PRECISION_HIGH\n\
+		precision highp float;\n\
+		#else\n\
+		precision mediump float;\n\
+		#endif\n\
+		uniform sampler2D pageCache;\
+		uniform sampler2D pageTable;\
+		uniform sampler2D fallback;\
+		uniform vec4 vtPages;\
+		uniform vec4 vtCache;\
+		uniform float vtPayload;\
+		varying vec2 myTexCoord;\
+		void main (void)\
+		{\
+			vec2 page = myTexCoord * vtPages.xy;\
+			vec2 cell = floor(min(page, vtPages.zw - 0.5));\
+			vec4 entry = texture2D(pageTable, (cell + 0.5) / vtPages.zw);\
+			if (entry.a < 0.5)\
+			{\
+				gl_FragColor = texture2D(fallback, myTexCoord);\
+				return;\
+			}\
+			vec2 slot = floor(entry.xy * 255.0 + 0.5);\
+			vec2 texel = (page - cell) * vtPayload + 1.0;\
+			gl_FragColor = texture2D(pageCache, slot * vtCache.xy + texel * vtCache.zw);\
+		}";
+
+	GLuint createTexture(GLenum filter) {
+		GLuint textureId;
+		glGenTextures(1, &textureId);
+		glBindTexture(GL_TEXTURE_2D, textureId);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		return textureId;
+	}
+
+	int clampIndex(int value, int count) {
+		return value < 0 ? 0 : (value >= count ? count - 1 : value);
+	}
+}
+
+VirtualTexture::VirtualTexture(int pageSize_, size_t budgetBytes_, int maxUploads_) :
+	pageSize(max(pageSize_, 4)), payload(max(pageSize_, 4) - 2), budgetBytes(budgetBytes_),
+	maxUploads(max(maxUploads_, 1)), image(NULL), pagesX(0), pagesY(0), slotsX(0), slotsY(0),
+	frame(0), uploads(0), program(0), cacheTexture(0), tableTexture(0), fallbackTexture(0),
+	matrixLocation(-1), tableDirty(false) {
+}
+
+VirtualTexture::~VirtualTexture() {
+	glDeleteTextures(1, &cacheTexture);
+	glDeleteTextures(1, &tableTexture);
+	glDeleteTextures(1, &fallbackTexture);
+	glDeleteProgram(program);
+}
+
+bool VirtualTexture::init(const Image* image_) {
+	image = image_;
+	pagesX = (image->width + payload - 1) / payload;
+	pagesY = (image->height + payload - 1) / payload;
+
+	GLint maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	if (pagesX > maxTextureSize || pagesY > maxTextureSize || pageSize > maxTextureSize)
+		return false;
+
+	//As many slots as the budget pays for, but never more than pages
+	int slotCount = (int)(budgetBytes / ((size_t)pageSize * pageSize * 4));
+	slotCount = max(min(slotCount, pagesX * pagesY), 1);
+	int maxPerRow = min(maxTextureSize / pageSize, MAX_SLOTS_PER_ROW);
+	slotsX = min((int)ceil(sqrt((double)slotCount)), maxPerRow);
+	slotsY = min((slotCount + slotsX - 1) / slotsX, maxPerRow);
+
+	const char* attribs[] = { "myVertex", "myUV" };
+	program = buildProgram(pszVertShader, pszFragShader, attribs, 2);
+	if (!program)
+		return false;
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "pageCache"), CACHE_UNIT);
+	glUniform1i(glGetUniformLocation(program, "pageTable"), TABLE_UNIT);
+	glUniform1i(glGetUniformLocation(program, "fallback"), FALLBACK_UNIT);
+	glUniform4f(glGetUniformLocation(program, "vtPages"),
+		(float)image->width / payload, (float)image->height / payload, (float)pagesX, (float)pagesY);
+	glUniform4f(glGetUniformLocation(program, "vtCache"),
+		1.0f / slotsX, 1.0f / slotsY, 1.0f / (slotsX * pageSize), 1.0f / (slotsY * pageSize));
+	glUniform1f(glGetUniformLocation(program, "vtPayload"), (float)payload);
+	matrixLocation = glGetUniformLocation(program, "myPMVMatrix");
+
+	cacheTexture = createTexture(GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, slotsX * pageSize, slotsY * pageSize, 0,
+		GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+	//The page table is addressed per texel, so it must not be filtered
+	table.assign(pagesX * pagesY * 4, 0);
+	tableTexture = createTexture(GL_NEAREST);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, pagesX, pagesY, 0, GL_RGBA, GL_UNSIGNED_BYTE, &table[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	Image* small = NULL;
+	while ((small ? small : image)->width > FALLBACK_SIZE || (small ? small : image)->height > FALLBACK_SIZE) {
+		Image* next = downsampleImage(small ? small : image, MIP_FILTER_BOX, false);
+		delete small;
+		small = next;
+	}
+	fallbackTexture = loadTexture(small ? small : (Image*)image, MIPMAP_NONE);
+	delete small;
+
+	slots.resize(slotsX * slotsY);
+	pageSlots.assign(pagesX * pagesY, -1);
+	lru.clear();
+	freeSlots.clear();
+	for (int i = (int)slots.size() - 1; i >= 0; i--)
+		freeSlots.push_back(i);
+	scratch.resize(pageSize * pageSize * 3);
+	return true;
+}
+
+int VirtualTexture::update(float u0, float v0, float u1, float v1) {
+	frame++;
+	int firstX = clampIndex((int)floor(min(u0, u1) * image->width / payload), pagesX);
+	int lastX = clampIndex((int)floor(max(u0, u1) * image->width / payload), pagesX);
+	int firstY = clampIndex((int)floor(min(v0, v1) * image->height / payload), pagesY);
+	int lastY = clampIndex((int)floor(max(v0, v1) * image->height / payload), pagesY);
+
+	//Mark every visible resident page first so none of them is evicted to
+	//make room for another visible page
+	for (int y = firstY; y <= lastY; y++) {
+		for (int x = firstX; x <= lastX; x++) {
+			int slot = pageSlots[y * pagesX + x];
+			if (slot >= 0) {
+				slots[slot].frame = frame;
+				lru.splice(lru.begin(), lru, slots[slot].lruPosition);
+			}
+		}
+	}
+
+	int uploaded = 0;
+	for (int y = firstY; y <= lastY && uploaded < maxUploads; y++) {
+		for (int x = firstX; x <= lastX && uploaded < maxUploads; x++) {
+			int page = y * pagesX + x;
+			if (pageSlots[page] >= 0)
+				continue;
+
+			int slot;
+			if (!freeSlots.empty()) {
+				slot = freeSlots.back();
+				freeSlots.pop_back();
+				lru.push_front(slot);
+				slots[slot].lruPosition = lru.begin();
+			}
+			else {
+				//The view needs more pages than fit; the rest stay on the fallback
+				slot = lru.back();
+				if (slots[slot].frame == frame)
+					break;
+				pageSlots[slots[slot].page] = -1;
+				setEntry(slots[slot].page, -1);
+				lru.splice(lru.begin(), lru, slots[slot].lruPosition);
+			}
+			loadPage(page, slot);
+			uploaded++;
+		}
+	}
+
+	if (tableDirty) {
+		glBindTexture(GL_TEXTURE_2D, tableTexture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pagesX, pagesY, GL_RGBA, GL_UNSIGNED_BYTE, &table[0]);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		tableDirty = false;
+	}
+	uploads += uploaded;
+	return uploaded;
+}
+
+void VirtualTexture::loadPage(int page, int slot) {
+	//Copy the payload plus a 1 texel border, clamped at the image edges
+	int originX = (page % pagesX) * payload - 1;
+	int originY = (page / pagesX) * payload - 1;
+	const char* pixels = image->pixels;
+	for (int y = 0; y < pageSize; y++) {
+		const char* row = pixels + 3 * image->width * clampIndex(originY + y, image->height);
+		char* target = &scratch[3 * pageSize * y];
+		for (int x = 0; x < pageSize; x++)
+			memcpy(target + 3 * x, row + 3 * clampIndex(originX + x, image->width), 3);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, cacheTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % slotsX) * pageSize, (slot / slotsX) * pageSize,
+		pageSize, pageSize, GL_RGB, GL_UNSIGNED_BYTE, &scratch[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	slots[slot].page = page;
+	slots[slot].frame = frame;
+	pageSlots[page] = slot;
+	setEntry(page, slot);
+}
+
+void VirtualTexture::setEntry(int page, int slot) {
+	GLubyte* entry = &table[page * 4];
+	entry[0] = (GLubyte)(slot >= 0 ? slot % slotsX : 0);
+	entry[1] = (GLubyte)(slot >= 0 ? slot / slotsX : 0);
+	entry[2] = 0;
+	entry[3] = (GLubyte)(slot >= 0 ? 255 : 0);
+	tableDirty = true;
+}
+
+void VirtualTexture::draw(const GLfloat* pmvMatrix, float x, float y, float width, float height,
+						  float u0, float v0, float u1, float v1) {
+	GLfloat afQuad[] = {
+		x, y + height, u0, v1,
+		x, y, u0, v0,
+		x + width, y, u1, v0,
+		x + width, y + height, u1, v1
+	};
+
+	glUseProgram(program);
+	glUniformMatrix4fv(matrixLocation, 1, GL_FALSE, pmvMatrix);
+	glActiveTexture(GL_TEXTURE0 + FALLBACK_UNIT);
+	glBindTexture(GL_TEXTURE_2D, fallbackTexture);
+	glActiveTexture(GL_TEXTURE0 + TABLE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, tableTexture);
+	glActiveTexture(GL_TEXTURE0 + CACHE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, cacheTexture);
+
+	glEnableVertexAttribArray(VERTEX_ARRAY);
+	glEnableVertexAttribArray(TEXCOORD_ARRAY);
+	glVertexAttribPointer(VERTEX_ARRAY, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), afQuad);
+	glVertexAttribPointer(TEXCOORD_ARRAY, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), &afQuad[2]);
+	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	glDisableVertexAttribArray(TEXCOORD_ARRAY);
+}
@@ -0,0 +1,92 @@
+#ifndef VIRTUAL_TEXTURE_H_INCLUDED
+#define VIRTUAL_TEXTURE_H_INCLUDED
+
+#include <stddef.h>
+#include <list>
+#include <vector>
+#include <GLES2/gl2.h>
+#include "imageloader.h"
+
+/* Draws an image of any size through a fixed amount of texture memory.
+ *
+ * The image is cut into square pages.  A page cache texture holds as many
+ * pages as the memory budget allows, each with a 1 texel border copied from
+ * its neighbours so bilinear filtering doesn't bleed between cache slots.
+ * A page table texture with one texel per page records which slot holds
+ * the page, and the fragment shader looks the page up and samples the cache.
+ * Pages that aren't resident fall back to a small downsampled copy of the
+ * whole image, so nothing ever draws black while tiles stream in.
+ *
+ * update() is given the part of the image the view samples, in texture
+ * coordinates, and uploads the missing pages it covers, evicting the least
+ * recently used ones that the view no longer needs.  At most maxUploads
+ * pages are uploaded per call so a fast pan spreads its cost over frames.
+ *
+ * Neither the cache nor the page table exceed GL_MAX_TEXTURE_SIZE, so this
+ * also draws images that a single glTexImage2D would reject.  The image
+ * must stay alive for as long as the VirtualTexture streams from it.
+ */
+class VirtualTexture {
+	public:
+		//pageSize includes the border; budgetBytes is the page cache size
+		//counted at 4 bytes per texel, as drivers store GL_RGB
+		explicit VirtualTexture(int pageSize = 128, size_t budgetBytes = 8 << 20,
+								int maxUploads = 8);
+		~VirtualTexture();
+
+		//Creates the textures and program; needs a current context
+		bool init(const Image* image);
+
+		//Streams in the pages under [u0, u1] x [v0, v1] and returns how many
+		//were uploaded
+		int update(float u0, float v0, float u1, float v1);
+
+		//Draws the rectangle (x, y, width, height) showing the image region
+		//[u0, u1] x [v0, v1].  Leaves the virtual texture program bound.
+		void draw(const GLfloat* pmvMatrix, float x, float y, float width, float height,
+				  float u0 = 0.0f, float v0 = 0.0f, float u1 = 1.0f, float v1 = 1.0f);
+
+		int pageCount() const { return pagesX * pagesY; }
+		int residentPages() const { return (int)lru.size(); }
+		int slotCount() const { return slotsX * slotsY; }
+		int uploadedPages() const { return uploads; }
+
+	private:
+		struct Slot {
+			int page;
+			unsigned int frame;	//Last update() that needed the page
+			std::list<int>::iterator lruPosition;
+		};
+
+		void loadPage(int page, int slot);
+		void setEntry(int page, int slot);
+
+		int pageSize;
+		int payload;		//Image texels per page, pageSize minus the borders
+		size_t budgetBytes;
+		int maxUploads;
+
+		const Image* image;
+		int pagesX;
+		int pagesY;
+		int slotsX;
+		int slotsY;
+		unsigned int frame;
+		int uploads;
+
+		GLuint program;
+		GLuint cacheTexture;
+		GLuint tableTexture;
+		GLuint fallbackTexture;
+		GLint matrixLocation;
+		bool tableDirty;
+
+		std::vector<Slot> slots;
+		std::vector<int> pageSlots;		//Slot of every page, -1 if not resident
+		std::vector<GLubyte> table;		//RGBA page table, mirrored to tableTexture
+		std::list<int> lru;				//Occupied slots, most recently used first
+		std::vector<int> freeSlots;
+		std::vector<char> scratch;
+};
+
+#endif